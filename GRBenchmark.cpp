@@ -0,0 +1,811 @@
+/* GRBenchmark.cpp */
+#include "GRBenchmark.h"
+
+#if defined(GODOTREMOTE_BENCHMARK) && !defined(NO_GODOTREMOTE_SERVER)
+
+#include "GodotRemote.h"
+#include "core/engine.h"
+#include "core/io/json.h"
+#include "core/os/file_access.h"
+#include "core/os/os.h"
+
+using namespace GRUtils;
+
+void GRBenchmark::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_resolutions", "resolutions"), &GRBenchmark::set_resolutions);
+	ClassDB::bind_method(D_METHOD("get_resolutions"), &GRBenchmark::get_resolutions);
+	ClassDB::bind_method(D_METHOD("set_patterns", "patterns"), &GRBenchmark::set_patterns);
+	ClassDB::bind_method(D_METHOD("get_patterns"), &GRBenchmark::get_patterns);
+	ClassDB::bind_method(D_METHOD("set_compression_types", "types"), &GRBenchmark::set_compression_types);
+	ClassDB::bind_method(D_METHOD("get_compression_types"), &GRBenchmark::get_compression_types);
+	ClassDB::bind_method(D_METHOD("set_jpg_qualities", "qualities"), &GRBenchmark::set_jpg_qualities);
+	ClassDB::bind_method(D_METHOD("get_jpg_qualities"), &GRBenchmark::get_jpg_qualities);
+	ClassDB::bind_method(D_METHOD("set_jpg_subsamplings", "subsamplings"), &GRBenchmark::set_jpg_subsamplings);
+	ClassDB::bind_method(D_METHOD("get_jpg_subsamplings"), &GRBenchmark::get_jpg_subsamplings);
+	ClassDB::bind_method(D_METHOD("set_frames_count", "count"), &GRBenchmark::set_frames_count);
+	ClassDB::bind_method(D_METHOD("get_frames_count"), &GRBenchmark::get_frames_count);
+	ClassDB::bind_method(D_METHOD("set_warmup_frames_count", "count"), &GRBenchmark::set_warmup_frames_count);
+	ClassDB::bind_method(D_METHOD("get_warmup_frames_count"), &GRBenchmark::get_warmup_frames_count);
+
+	ClassDB::bind_method(D_METHOD("generate_frame", "pattern", "width", "height", "frame"), &GRBenchmark::generate_frame);
+	ClassDB::bind_method(D_METHOD("run"), &GRBenchmark::run);
+	ClassDB::bind_method(D_METHOD("save_results", "path", "results", "meta"), &GRBenchmark::save_results, DEFVAL(Dictionary()));
+
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "resolutions"), "set_resolutions", "get_resolutions");
+	ADD_PROPERTY(PropertyInfo(Variant::POOL_INT_ARRAY, "patterns"), "set_patterns", "get_patterns");
+	ADD_PROPERTY(PropertyInfo(Variant::POOL_INT_ARRAY, "compression_types"), "set_compression_types", "get_compression_types");
+	ADD_PROPERTY(PropertyInfo(Variant::POOL_INT_ARRAY, "jpg_qualities"), "set_jpg_qualities", "get_jpg_qualities");
+	ADD_PROPERTY(PropertyInfo(Variant::POOL_INT_ARRAY, "jpg_subsamplings"), "set_jpg_subsamplings", "get_jpg_subsamplings");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "frames_count", PROPERTY_HINT_RANGE, "1,100000"), "set_frames_count", "get_frames_count");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "warmup_frames_count", PROPERTY_HINT_RANGE, "0,1000"), "set_warmup_frames_count", "get_warmup_frames_count");
+
+	BIND_ENUM_CONSTANT(PATTERN_STATIC_UI);
+	BIND_ENUM_CONSTANT(PATTERN_SCROLLING);
+	BIND_ENUM_CONSTANT(PATTERN_NOISE);
+	BIND_ENUM_CONSTANT(PATTERN_GRADIENT);
+}
+
+void GRBenchmark::_notification(int p_notification) {
+	switch (p_notification) {
+		case NOTIFICATION_POSTINITIALIZE:
+			_init();
+			break;
+		case NOTIFICATION_PREDELETE:
+			_deinit();
+			break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FRAMES
+
+static _FORCE_INLINE_ uint32_t _bench_hash(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+static _FORCE_INLINE_ void _bench_set(uint8_t *p, uint8_t r, uint8_t g, uint8_t b) {
+	p[0] = r;
+	p[1] = g;
+	p[2] = b;
+	p[3] = 255;
+}
+
+// editor-like layout: title bar, side panel, buttons and lines of "text".
+// content_offset scrolls only the content area
+static void _bench_ui_pixel(uint8_t *p, int x, int y, int width, int height, int content_offset) {
+	const int bar_h = max(height / 12, 8);
+	const int side_w = max(width / 5, 8);
+
+	if (y < bar_h) {
+		// buttons on the title bar
+		int bx = x % 96;
+		if (bx > 8 && bx < 80 && y > bar_h / 4 && y < bar_h * 3 / 4)
+			_bench_set(p, 78, 84, 96);
+		else
+			_bench_set(p, 60, 63, 70);
+		return;
+	}
+
+	if (x < side_w) {
+		// tree items
+		int row = (y - bar_h) / 20;
+		int ry = (y - bar_h) % 20;
+		int indent = 8 + (_bench_hash(row) % 4) * 12;
+		int len = 40 + _bench_hash(row * 31 + 7) % max(side_w - 60, 1);
+		if (ry > 5 && ry < 15 && x > indent && x < indent + len && (_bench_hash(row * 977 + x / 5) & 3))
+			_bench_set(p, 200, 204, 210);
+		else
+			_bench_set(p, 50, 54, 62);
+		return;
+	}
+
+	// content
+	int cy = y - bar_h + content_offset;
+	int cx = x - side_w;
+	int row = cy / 18;
+	int ry = cy % 18;
+	if (ry < 0) {
+		ry += 18;
+		row--;
+	}
+
+	if (row % 12 == 0 && cx > 16 && cx < 176 && ry > 2) {
+		// button with a border
+		if (cx < 18 || cx > 173 || ry < 4 || ry > 16)
+			_bench_set(p, 110, 150, 220);
+		else
+			_bench_set(p, 70, 90, 130);
+		return;
+	}
+
+	int word = cx / 7;
+	int len = 20 + _bench_hash(row) % 80;
+	if (ry > 4 && ry < 14 && word < len && (_bench_hash(row * 8191 + word / 6) % 7) && (_bench_hash(row * 131 + cx) & 1))
+		_bench_set(p, 220, 224, 230);
+	else
+		_bench_set(p, 40, 44, 52);
+}
+
+void GRBenchmark::_generate_frame(PoolByteArray &r_data, FramePattern pattern, int width, int height, int frame) {
+	r_data.resize(width * height * 4);
+	auto w = r_data.write();
+	uint8_t *p = w.ptr();
+
+	switch (pattern) {
+		case PATTERN_STATIC_UI:
+		case PATTERN_SCROLLING: {
+			const int offset = pattern == PATTERN_SCROLLING ? frame * 6 : 0;
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++, p += 4) {
+					_bench_ui_pixel(p, x, y, width, height, offset);
+				}
+			}
+			break;
+		}
+		case PATTERN_NOISE: {
+			uint32_t s = _bench_hash(frame + 1);
+			for (int i = 0; i < width * height; i++, p += 4) {
+				// xorshift32
+				s ^= s << 13;
+				s ^= s >> 17;
+				s ^= s << 5;
+				_bench_set(p, s & 0xff, (s >> 8) & 0xff, (s >> 16) & 0xff);
+			}
+			break;
+		}
+		case PATTERN_GRADIENT: {
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++, p += 4) {
+					_bench_set(p, (uint8_t)(x * 255 / max(width - 1, 1)), (uint8_t)(y * 255 / max(height - 1, 1)), (uint8_t)((x + y) / 4 + frame * 2));
+				}
+			}
+			break;
+		}
+		default:
+			memset(p, 0, width * height * 4);
+			break;
+	}
+}
+
+Ref<Image> GRBenchmark::generate_frame(FramePattern pattern, int width, int height, int frame) {
+	ERR_FAIL_COND_V(width <= 0 || height <= 0, Ref<Image>());
+	ERR_FAIL_INDEX_V(pattern, PATTERN_MAX, Ref<Image>());
+
+	PoolByteArray data;
+	_generate_frame(data, pattern, width, height, frame);
+
+	Ref<Image> img = newref(Image);
+	img->create(width, height, false, Image::FORMAT_RGBA8, data);
+	return img;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// RUN
+
+static double _bench_percentile(const std::vector<uint64_t> &sorted, double p) {
+	if (sorted.empty())
+		return 0;
+	int idx = (int)Math::ceil(p * sorted.size()) - 1;
+	return (double)sorted[CLAMP(idx, 0, (int)sorted.size() - 1)];
+}
+
+Dictionary GRBenchmark::_run_case(FramePattern pattern, int width, int height, GRDevice::ImageCompressionType type, int quality, GRDevice::Subsampling subsampling) {
+	OS *os = OS::get_singleton();
+	const uint64_t raw_size = (uint64_t)width * height * 4;
+
+	// enough for jpg of noise at the best quality
+	if ((uint64_t)jpg_buffer.size() < raw_size * 3 / 2 + 64 * 1024)
+		jpg_buffer.resize(raw_size * 3 / 2 + 64 * 1024);
+
+	Dictionary res;
+	res["pattern"] = get_pattern_name(pattern);
+	res["width"] = width;
+	res["height"] = height;
+	res["compression"] = get_compression_name(type);
+	res["quality"] = type == GRDevice::ImageCompressionType::COMPRESSION_JPG ? quality : 0;
+	res["subsampling"] = type == GRDevice::ImageCompressionType::COMPRESSION_JPG ? get_subsampling_name(subsampling) : String();
+
+	GRSViewport::ImgProcessingStorageViewport *ips = memnew(GRSViewport::ImgProcessingStorageViewport);
+	ips->compression_type = type;
+	ips->jpg_quality = quality;
+
+	std::vector<uint64_t> times;
+	times.reserve(frames_count);
+	uint64_t total_time = 0;
+	uint64_t total_bytes = 0;
+	uint64_t min_bytes = 0;
+	uint64_t max_bytes = 0;
+	Error err = Error::OK;
+
+	PoolByteArray data;
+	Ref<Image> img = newref(Image);
+	for (int i = -warmup_frames_count; i < frames_count; i++) {
+		// generation is not measured
+		_generate_frame(data, pattern, width, height, i + warmup_frames_count);
+		img->create(width, height, false, Image::FORMAT_RGBA8, data);
+
+		uint64_t t = os->get_ticks_usec();
+		err = GRSViewport::encode_image(img, ips, subsampling, &jpg_buffer);
+		t = os->get_ticks_usec() - t;
+
+		if (err)
+			break;
+		if (i < 0)
+			continue;
+
+		uint64_t size = ips->ret_data.size();
+		times.push_back(t);
+		total_time += t;
+		total_bytes += size;
+		min_bytes = times.size() == 1 ? size : min(min_bytes, size);
+		max_bytes = max(max_bytes, size);
+	}
+	memdelete(ips);
+
+	if (err) {
+		res["error"] = (int)err;
+		_log("Benchmark case failed with code: " + str(err), LogLevel::LL_ERROR);
+		return res;
+	}
+
+	std::sort(times.begin(), times.end());
+	const double n = (double)max((int)times.size(), 1);
+
+	res["frames"] = (int)times.size();
+	res["mb_per_sec"] = total_time ? (raw_size * times.size() / (1024.0 * 1024.0)) / (total_time / 1000000.0) : 0.0;
+	res["ms_avg"] = total_time / n / 1000.0;
+	res["ms_p50"] = _bench_percentile(times, 0.5) / 1000.0;
+	res["ms_p95"] = _bench_percentile(times, 0.95) / 1000.0;
+	res["ms_p99"] = _bench_percentile(times, 0.99) / 1000.0;
+	res["ms_max"] = times.size() ? times.back() / 1000.0 : 0.0;
+	res["bytes_avg"] = total_bytes / n;
+	res["bytes_min"] = (int64_t)min_bytes;
+	res["bytes_max"] = (int64_t)max_bytes;
+	res["compression_ratio"] = total_bytes ? raw_size * n / total_bytes : 0.0;
+	return res;
+}
+
+Array GRBenchmark::run() {
+	Array results;
+
+	for (int r = 0; r < resolutions.size(); r++) {
+		Vector2 size = resolutions[r];
+		int width = (int)size.x;
+		int height = (int)size.y;
+		ERR_CONTINUE_MSG(width <= 0 || height <= 0, "Incorrect benchmark resolution: " + str(size));
+
+		for (int p = 0; p < patterns.size(); p++) {
+			FramePattern pattern = (FramePattern)patterns[p];
+			ERR_CONTINUE(pattern < 0 || pattern >= PATTERN_MAX);
+
+			for (int c = 0; c < compression_types.size(); c++) {
+				GRDevice::ImageCompressionType type = (GRDevice::ImageCompressionType)compression_types[c];
+
+				if (type != GRDevice::ImageCompressionType::COMPRESSION_JPG) {
+					_log("Benchmark: " + get_pattern_name(pattern) + " " + str(width) + "x" + str(height) + " " + get_compression_name(type), LogLevel::LL_NORMAL);
+					results.append(_run_case(pattern, width, height, type, 0, GRDevice::Subsampling::SUBSAMPLING_H2V2));
+					continue;
+				}
+
+				for (int q = 0; q < jpg_qualities.size(); q++) {
+					for (int s = 0; s < jpg_subsamplings.size(); s++) {
+						GRDevice::Subsampling subsampling = (GRDevice::Subsampling)jpg_subsamplings[s];
+						_log("Benchmark: " + get_pattern_name(pattern) + " " + str(width) + "x" + str(height) + " JPG q" + str(jpg_qualities[q]) + " " + get_subsampling_name(subsampling), LogLevel::LL_NORMAL);
+						results.append(_run_case(pattern, width, height, type, jpg_qualities[q], subsampling));
+					}
+				}
+			}
+		}
+	}
+
+	return results;
+}
+
+Error GRBenchmark::save_results(const String &path, const Array &results, const Dictionary &meta) {
+	OS *os = OS::get_singleton();
+
+	Dictionary env = meta.duplicate();
+	env["godot_remote_version"] = GodotRemote::get_singleton() ? GodotRemote::get_singleton()->get_version() : String();
+	env["engine_version"] = Engine::get_singleton()->get_version_info();
+	env["os"] = os->get_name();
+	env["processor_count"] = os->get_processor_count();
+	env["unix_time"] = (int64_t)os->get_unix_time();
+	env["frames_count"] = frames_count;
+	env["warmup_frames_count"] = warmup_frames_count;
+
+	Dictionary root;
+	root["meta"] = env;
+	root["results"] = results;
+
+	Error err = Error::OK;
+	FileAccess *f = FileAccess::open(path, FileAccess::WRITE, &err);
+	if (err) {
+		_log("Can't open benchmark results file " + path + ". Code: " + str(err), LogLevel::LL_ERROR);
+		return err;
+	}
+	f->store_string(JSON::print(root, "\t", true));
+	f->close();
+	memdelete(f);
+	return Error::OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// NAMES
+
+String GRBenchmark::get_pattern_name(FramePattern pattern) {
+	switch (pattern) {
+		case PATTERN_STATIC_UI:
+			return "static_ui";
+		case PATTERN_SCROLLING:
+			return "scrolling";
+		case PATTERN_NOISE:
+			return "noise";
+		case PATTERN_GRADIENT:
+			return "gradient";
+		default:
+			return str((int)pattern);
+	}
+}
+
+String GRBenchmark::get_compression_name(GRDevice::ImageCompressionType type) {
+	switch (type) {
+		case GRDevice::ImageCompressionType::COMPRESSION_UNCOMPRESSED:
+			return "uncompressed";
+		case GRDevice::ImageCompressionType::COMPRESSION_JPG:
+			return "jpg";
+		case GRDevice::ImageCompressionType::COMPRESSION_PNG:
+			return "png";
+		default:
+			return str((int)type);
+	}
+}
+
+String GRBenchmark::get_subsampling_name(GRDevice::Subsampling subsampling) {
+	switch (subsampling) {
+		case GRDevice::Subsampling::SUBSAMPLING_Y_ONLY:
+			return "Y_ONLY";
+		case GRDevice::Subsampling::SUBSAMPLING_H1V1:
+			return "H1V1";
+		case GRDevice::Subsampling::SUBSAMPLING_H2V1:
+			return "H2V1";
+		case GRDevice::Subsampling::SUBSAMPLING_H2V2:
+			return "H2V2";
+		default:
+			return str((int)subsampling);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// PROPERTIES
+
+void GRBenchmark::set_resolutions(const Array &_resolutions) {
+	resolutions = _resolutions;
+}
+
+Array GRBenchmark::get_resolutions() {
+	return resolutions;
+}
+
+void GRBenchmark::set_patterns(const PoolIntArray &_patterns) {
+	patterns = _patterns;
+}
+
+PoolIntArray GRBenchmark::get_patterns() {
+	return patterns;
+}
+
+void GRBenchmark::set_compression_types(const PoolIntArray &_types) {
+	compression_types = _types;
+}
+
+PoolIntArray GRBenchmark::get_compression_types() {
+	return compression_types;
+}
+
+void GRBenchmark::set_jpg_qualities(const PoolIntArray &_qualities) {
+	jpg_qualities = _qualities;
+}
+
+PoolIntArray GRBenchmark::get_jpg_qualities() {
+	return jpg_qualities;
+}
+
+void GRBenchmark::set_jpg_subsamplings(const PoolIntArray &_subsamplings) {
+	jpg_subsamplings = _subsamplings;
+}
+
+PoolIntArray GRBenchmark::get_jpg_subsamplings() {
+	return jpg_subsamplings;
+}
+
+void GRBenchmark::set_frames_count(int _count) {
+	ERR_FAIL_COND(_count <= 0);
+	frames_count = _count;
+}
+
+int GRBenchmark::get_frames_count() {
+	return frames_count;
+}
+
+void GRBenchmark::set_warmup_frames_count(int _count) {
+	ERR_FAIL_COND(_count < 0);
+	warmup_frames_count = _count;
+}
+
+int GRBenchmark::get_warmup_frames_count() {
+	return warmup_frames_count;
+}
+
+void GRBenchmark::_init() {
+	resolutions.append(Vector2(640, 360));
+	resolutions.append(Vector2(1280, 720));
+	resolutions.append(Vector2(1920, 1080));
+
+	for (int i = 0; i < PATTERN_MAX; i++) {
+		patterns.append(i);
+	}
+
+	compression_types.append(GRDevice::ImageCompressionType::COMPRESSION_JPG);
+
+	jpg_qualities.append(50);
+	jpg_qualities.append(80);
+	jpg_qualities.append(95);
+
+	jpg_subsamplings.append(GRDevice::Subsampling::SUBSAMPLING_H1V1);
+	jpg_subsamplings.append(GRDevice::Subsampling::SUBSAMPLING_H2V2);
+}
+
+void GRBenchmark::_deinit() {
+	jpg_buffer.resize(0);
+}
+
+#ifndef NO_GODOTREMOTE_CLIENT
+//////////////////////////////////////////////////////////////////////////
+// LOOPBACK
+
+void GRLoopbackBenchmark::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("start"), &GRLoopbackBenchmark::start);
+	ClassDB::bind_method(D_METHOD("is_running"), &GRLoopbackBenchmark::is_running);
+
+	ClassDB::bind_method(D_METHOD("set_duration", "seconds"), &GRLoopbackBenchmark::set_duration);
+	ClassDB::bind_method(D_METHOD("get_duration"), &GRLoopbackBenchmark::get_duration);
+	ClassDB::bind_method(D_METHOD("set_warmup", "seconds"), &GRLoopbackBenchmark::set_warmup);
+	ClassDB::bind_method(D_METHOD("get_warmup"), &GRLoopbackBenchmark::get_warmup);
+	ClassDB::bind_method(D_METHOD("set_width", "width"), &GRLoopbackBenchmark::set_width);
+	ClassDB::bind_method(D_METHOD("get_width"), &GRLoopbackBenchmark::get_width);
+	ClassDB::bind_method(D_METHOD("set_height", "height"), &GRLoopbackBenchmark::set_height);
+	ClassDB::bind_method(D_METHOD("get_height"), &GRLoopbackBenchmark::get_height);
+	ClassDB::bind_method(D_METHOD("set_jpg_quality", "quality"), &GRLoopbackBenchmark::set_jpg_quality);
+	ClassDB::bind_method(D_METHOD("get_jpg_quality"), &GRLoopbackBenchmark::get_jpg_quality);
+	ClassDB::bind_method(D_METHOD("set_pattern", "pattern"), &GRLoopbackBenchmark::set_pattern);
+	ClassDB::bind_method(D_METHOD("get_pattern"), &GRLoopbackBenchmark::get_pattern);
+	ClassDB::bind_method(D_METHOD("set_frames_in_loop", "count"), &GRLoopbackBenchmark::set_frames_in_loop);
+	ClassDB::bind_method(D_METHOD("get_frames_in_loop"), &GRLoopbackBenchmark::get_frames_in_loop);
+	ClassDB::bind_method(D_METHOD("set_port", "port"), &GRLoopbackBenchmark::set_port);
+	ClassDB::bind_method(D_METHOD("get_port"), &GRLoopbackBenchmark::get_port);
+
+	ADD_PROPERTY(PropertyInfo(Variant::REAL, "duration", PROPERTY_HINT_RANGE, "1,3600"), "set_duration", "get_duration");
+	ADD_PROPERTY(PropertyInfo(Variant::REAL, "warmup", PROPERTY_HINT_RANGE, "0,60"), "set_warmup", "get_warmup");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "width", PROPERTY_HINT_RANGE, "16,8192"), "set_width", "get_width");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "height", PROPERTY_HINT_RANGE, "16,8192"), "set_height", "get_height");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "jpg_quality", PROPERTY_HINT_RANGE, "0,100"), "set_jpg_quality", "get_jpg_quality");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "pattern", PROPERTY_HINT_ENUM, "StaticUI,Scrolling,Noise,Gradient"), "set_pattern", "get_pattern");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "frames_in_loop", PROPERTY_HINT_RANGE, "1,1000"), "set_frames_in_loop", "get_frames_in_loop");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "port", PROPERTY_HINT_RANGE, "1,65535"), "set_port", "get_port");
+
+	ADD_SIGNAL(MethodInfo("finished", PropertyInfo(Variant::DICTIONARY, "results")));
+}
+
+void GRLoopbackBenchmark::_notification(int p_notification) {
+	switch (p_notification) {
+		case NOTIFICATION_POSTINITIALIZE:
+			_init();
+			break;
+		case NOTIFICATION_PREDELETE:
+			_deinit();
+			break;
+		case NOTIFICATION_PROCESS: {
+			const uint64_t elapsed = OS::get_singleton()->get_ticks_usec() - state_start_time;
+
+			switch (state) {
+				case State::STATE_CONNECTING: {
+					// viewport is created by the deferred start of the server
+					GRSViewport *vp = server->get_gr_viewport();
+					if (!synthetic_frames_set && vp) {
+						Ref<GRBenchmark> gen = newref(GRBenchmark);
+						std::vector<Ref<Image> > frames;
+						for (int i = 0; i < frames_in_loop; i++) {
+							frames.push_back(gen->generate_frame(pattern, width, height, i));
+						}
+						vp->set_synthetic_frames(frames);
+						synthetic_frames_set = true;
+					}
+
+					if (synthetic_frames_set && client->is_connected_to_host()) {
+						// sent the same way as from the client settings menu
+						client->set_server_setting(GRDevice::TypesOfServerSettings::SERVER_SETTINGS_VIDEO_STREAM_ENABLED, true);
+						client->set_server_setting(GRDevice::TypesOfServerSettings::SERVER_SETTINGS_COMPRESSION_TYPE, (int)GRDevice::ImageCompressionType::COMPRESSION_JPG);
+						client->set_server_setting(GRDevice::TypesOfServerSettings::SERVER_SETTINGS_JPG_QUALITY, jpg_quality);
+						client->set_server_setting(GRDevice::TypesOfServerSettings::SERVER_SETTINGS_SKIP_FRAMES, 0);
+						_set_state(State::STATE_WARMUP);
+					} else if (elapsed > connect_timeout * 1000000) {
+						_fail("Client can't connect to the server");
+					}
+					break;
+				}
+				case State::STATE_WARMUP:
+					if (elapsed > warmup * 1000000)
+						_start_measuring();
+					break;
+				case State::STATE_MEASURING:
+					if (!client->is_connected_to_host()) {
+						_fail("Connection lost");
+					} else if (elapsed > duration * 1000000) {
+						_stop_measuring();
+					}
+					break;
+				case State::STATE_STOPPING:
+					if ((server->get_status() == GRDevice::WorkingStatus::STATUS_STOPPED && client->get_status() == GRDevice::WorkingStatus::STATUS_STOPPED) ||
+							elapsed > connect_timeout * 1000000) {
+						// remaining threads are joined when the devices are deleted
+						server->queue_delete();
+						client->queue_delete();
+						client_view->queue_delete();
+						server = nullptr;
+						client = nullptr;
+						client_view = nullptr;
+						_set_state(State::STATE_FINISHING);
+					}
+					break;
+				case State::STATE_FINISHING:
+					_finish();
+					break;
+				default:
+					break;
+			}
+			break;
+		}
+	}
+}
+
+static uint64_t _bench_total_bytes(const GRUtils::traffic_counters &c) {
+	uint64_t res = 0;
+	for (int i = 0; i < GRUtils::traffic_counters::types_count; i++) {
+		res += c.get_bytes(i);
+	}
+	return res;
+}
+
+void GRLoopbackBenchmark::_set_state(State _state) {
+	state = _state;
+	state_start_time = OS::get_singleton()->get_ticks_usec();
+}
+
+void GRLoopbackBenchmark::_start_measuring() {
+	server->reset_stats();
+	client->reset_stats();
+
+	sent_bytes_start = _bench_total_bytes(server->sent_traffic);
+	image_bytes_start = server->sent_traffic.get_bytes(GRPacket::PacketType::ImageData);
+	image_packets_start = server->sent_traffic.get_packets(GRPacket::PacketType::ImageData);
+	server_dropped_start = server->dropped_frames.load();
+	client_dropped_start = client->dropped_frames.load();
+	cpu_start = thread_cpu_get_dictionary();
+	main_cpu_measuring_start = thread_cpu_time();
+
+	_log("Loopback benchmark: measuring for " + str(duration) + " seconds", LogLevel::LL_NORMAL);
+	_set_state(State::STATE_MEASURING);
+}
+
+void GRLoopbackBenchmark::_stop_measuring() {
+	const double seconds = (OS::get_singleton()->get_ticks_usec() - state_start_time) / 1000000.0;
+	const uint64_t frames = client->stage_stats[GRDevice::STAGE_TEXTURE_UPLOAD].get_count();
+	const uint64_t sent_bytes = _bench_total_bytes(server->sent_traffic) - sent_bytes_start;
+	const uint64_t image_bytes = server->sent_traffic.get_bytes(GRPacket::PacketType::ImageData) - image_bytes_start;
+	const uint64_t image_packets = server->sent_traffic.get_packets(GRPacket::PacketType::ImageData) - image_packets_start;
+	Dictionary client_stats = client->get_stats();
+
+	// threads are still running, so only the measured part is counted
+	Dictionary cpu = thread_cpu_get_dictionary();
+	Dictionary main_cpu;
+	main_cpu["cpu"] = (thread_cpu_time() - main_cpu_measuring_start) / 1000.0;
+	main_cpu["wall"] = seconds * 1000.0;
+	main_cpu["threads"] = 1;
+	cpu["main"] = main_cpu;
+
+	Array names = cpu.keys();
+	for (int i = 0; i < names.size(); i++) {
+		Dictionary d = cpu[names[i]];
+		if (cpu_start.has(names[i])) {
+			Dictionary s = cpu_start[names[i]];
+			d["cpu"] = (double)d["cpu"] - (double)s["cpu"];
+			d["wall"] = (double)d["wall"] - (double)s["wall"];
+		}
+		d["percent"] = (double)d["cpu"] / 1000.0 / seconds * 100.0;
+	}
+
+	results["seconds"] = seconds;
+	results["frames"] = (int64_t)frames;
+	results["fps"] = frames / seconds;
+	results["frames_sent"] = (int64_t)image_packets;
+	results["frames_dropped_server"] = (int64_t)(server->dropped_frames.load() - server_dropped_start);
+	results["frames_dropped_client"] = (int64_t)(client->dropped_frames.load() - client_dropped_start);
+	results["bytes_sent"] = (int64_t)sent_bytes;
+	results["mbit_per_sec"] = sent_bytes * 8 / seconds / 1000000.0;
+	results["bytes_per_frame"] = image_packets ? (double)image_bytes / image_packets : 0.0;
+	results["cpu"] = cpu;
+	// capture on the server to present on the client
+	results["latency"] = client_stats.has("frame_latency") ? client_stats["frame_latency"] : Variant(Dictionary());
+	results["server_stats"] = server->get_stats();
+	results["client_stats"] = client_stats;
+
+	server->stop();
+	client->stop();
+	_set_state(State::STATE_STOPPING);
+}
+
+void GRLoopbackBenchmark::_fail(const String &error) {
+	_log("Loopback benchmark failed: " + error, LogLevel::LL_ERROR);
+	results["error"] = error;
+
+	if (server->get_status() == GRDevice::WorkingStatus::STATUS_WORKING)
+		server->stop();
+	if (client->get_status() == GRDevice::WorkingStatus::STATUS_WORKING)
+		client->stop();
+	_set_state(State::STATE_STOPPING);
+}
+
+void GRLoopbackBenchmark::_finish() {
+	OS *os = OS::get_singleton();
+	const uint64_t session_time = os->get_ticks_usec() - session_start_time;
+	thread_cpu_add("main", thread_cpu_time() - main_cpu_start_time, session_time);
+
+	// whole session, including connection and warmup
+	Dictionary cpu = thread_cpu_get_dictionary();
+	Array names = cpu.keys();
+	for (int i = 0; i < names.size(); i++) {
+		Dictionary d = cpu[names[i]];
+		d["percent"] = session_time ? (double)d["cpu"] * 1000.0 / session_time * 100.0 : 0.0;
+	}
+	results["session_cpu"] = cpu;
+	results["session_seconds"] = session_time / 1000000.0;
+
+	set_process(false);
+	_set_state(State::STATE_IDLE);
+	emit_signal("finished", results);
+}
+
+Error GRLoopbackBenchmark::start() {
+	ERR_FAIL_COND_V_MSG(state != State::STATE_IDLE, ERR_BUSY, "Loopback benchmark is already running");
+	ERR_FAIL_COND_V_MSG(!is_inside_tree(), ERR_UNCONFIGURED, "Loopback benchmark must be added to the scene tree");
+
+	results = Dictionary();
+	results["width"] = width;
+	results["height"] = height;
+	results["jpg_quality"] = jpg_quality;
+	results["pattern"] = GRBenchmark::get_pattern_name(pattern);
+	results["duration"] = duration;
+	results["warmup"] = warmup;
+	results["capture_note"] = "server captures prepared synthetic images, the GPU readback of get_texture()->get_data() is not measured";
+
+	thread_cpu_reset();
+	session_start_time = OS::get_singleton()->get_ticks_usec();
+	main_cpu_start_time = thread_cpu_time();
+	synthetic_frames_set = false;
+
+	server = memnew(GRServer);
+	server->set_port(port);
+	add_child(server);
+
+	client_view = memnew(Control);
+	client_view->set_anchors_and_margins_preset(Control::PRESET_WIDE);
+	add_child(client_view);
+
+	client = memnew(GRClient);
+	client->set_address_port("127.0.0.1", port);
+	client->set_control_to_show_in(client_view);
+	add_child(client);
+
+	server->start();
+	client->start();
+
+	_log("Loopback benchmark: " + str(width) + "x" + str(height) + " JPG q" + str(jpg_quality) + " on port " + str(port), LogLevel::LL_NORMAL);
+	set_process(true);
+	_set_state(State::STATE_CONNECTING);
+	return Error::OK;
+}
+
+bool GRLoopbackBenchmark::is_running() {
+	return state != State::STATE_IDLE;
+}
+
+void GRLoopbackBenchmark::set_duration(float _duration) {
+	ERR_FAIL_COND(_duration <= 0);
+	duration = _duration;
+}
+
+float GRLoopbackBenchmark::get_duration() {
+	return duration;
+}
+
+void GRLoopbackBenchmark::set_warmup(float _warmup) {
+	ERR_FAIL_COND(_warmup < 0);
+	warmup = _warmup;
+}
+
+float GRLoopbackBenchmark::get_warmup() {
+	return warmup;
+}
+
+void GRLoopbackBenchmark::set_width(int _width) {
+	ERR_FAIL_COND(_width <= 0);
+	width = _width;
+}
+
+int GRLoopbackBenchmark::get_width() {
+	return width;
+}
+
+void GRLoopbackBenchmark::set_height(int _height) {
+	ERR_FAIL_COND(_height <= 0);
+	height = _height;
+}
+
+int GRLoopbackBenchmark::get_height() {
+	return height;
+}
+
+void GRLoopbackBenchmark::set_jpg_quality(int _quality) {
+	ERR_FAIL_COND(_quality < 0 || _quality > 100);
+	jpg_quality = _quality;
+}
+
+int GRLoopbackBenchmark::get_jpg_quality() {
+	return jpg_quality;
+}
+
+void GRLoopbackBenchmark::set_pattern(GRBenchmark::FramePattern _pattern) {
+	ERR_FAIL_INDEX(_pattern, GRBenchmark::FramePattern::PATTERN_MAX);
+	pattern = _pattern;
+}
+
+GRBenchmark::FramePattern GRLoopbackBenchmark::get_pattern() {
+	return pattern;
+}
+
+void GRLoopbackBenchmark::set_frames_in_loop(int _count) {
+	ERR_FAIL_COND(_count <= 0);
+	frames_in_loop = _count;
+}
+
+int GRLoopbackBenchmark::get_frames_in_loop() {
+	return frames_in_loop;
+}
+
+void GRLoopbackBenchmark::set_port(int _port) {
+	ERR_FAIL_COND(_port <= 0 || _port > 65535);
+	port = _port;
+}
+
+int GRLoopbackBenchmark::get_port() {
+	return port;
+}
+
+void GRLoopbackBenchmark::_init() {
+	set_name("GRLoopbackBenchmark");
+}
+
+void GRLoopbackBenchmark::_deinit() {
+	// devices are children and deleted with this node
+	server = nullptr;
+	client = nullptr;
+	client_view = nullptr;
+}
+#endif // !NO_GODOTREMOTE_CLIENT
+
+#endif // GODOTREMOTE_BENCHMARK && !NO_GODOTREMOTE_SERVER
@@ -0,0 +1,167 @@
+/* GRBenchmark.h */
+#pragma once
+
+#if defined(GODOTREMOTE_BENCHMARK) && !defined(NO_GODOTREMOTE_SERVER)
+
+#include <vector>
+
+#include "GRDevice.h"
+#include "GRServer.h"
+#include "core/image.h"
+#include "core/reference.h"
+
+// Feeds deterministic synthetic frames through the stream encoder (GRSViewport::encode_image)
+// and measures speed and size of the result. Built only with godot_remote_benchmark=yes
+class GRBenchmark : public Reference {
+	GDCLASS(GRBenchmark, Reference);
+
+public:
+	enum FramePattern {
+		PATTERN_STATIC_UI = 0,
+		PATTERN_SCROLLING = 1,
+		PATTERN_NOISE = 2,
+		PATTERN_GRADIENT = 3,
+		PATTERN_MAX,
+	};
+
+private:
+	Array resolutions;
+	PoolIntArray patterns;
+	PoolIntArray compression_types;
+	PoolIntArray jpg_qualities;
+	PoolIntArray jpg_subsamplings;
+	int frames_count = 60;
+	int warmup_frames_count = 5;
+
+	// own jpg output buffer, server utils are not initialized here
+	PoolByteArray jpg_buffer;
+
+	static void _generate_frame(PoolByteArray &r_data, FramePattern pattern, int width, int height, int frame);
+	Dictionary _run_case(FramePattern pattern, int width, int height, GRDevice::ImageCompressionType type, int quality, GRDevice::Subsampling subsampling);
+
+protected:
+	static void _bind_methods();
+	void _notification(int p_notification);
+
+public:
+	static String get_pattern_name(FramePattern pattern);
+	static String get_compression_name(GRDevice::ImageCompressionType type);
+	static String get_subsampling_name(GRDevice::Subsampling subsampling);
+
+	void set_resolutions(const Array &_resolutions);
+	Array get_resolutions();
+	void set_patterns(const PoolIntArray &_patterns);
+	PoolIntArray get_patterns();
+	void set_compression_types(const PoolIntArray &_types);
+	PoolIntArray get_compression_types();
+	void set_jpg_qualities(const PoolIntArray &_qualities);
+	PoolIntArray get_jpg_qualities();
+	void set_jpg_subsamplings(const PoolIntArray &_subsamplings);
+	PoolIntArray get_jpg_subsamplings();
+	void set_frames_count(int _count);
+	int get_frames_count();
+	void set_warmup_frames_count(int _count);
+	int get_warmup_frames_count();
+
+	// one of the synthetic frames in RGBA8, the same for the same arguments
+	Ref<Image> generate_frame(FramePattern pattern, int width, int height, int frame);
+	// array of dictionaries, one per combination of settings
+	Array run();
+	// results with environment info as JSON
+	Error save_results(const String &path, const Array &results, const Dictionary &meta = Dictionary());
+
+	void _init();
+	void _deinit();
+};
+
+VARIANT_ENUM_CAST(GRBenchmark::FramePattern)
+
+#ifndef NO_GODOTREMOTE_CLIENT
+#include "GRClient.h"
+
+// Server and client in one process over 127.0.0.1. The server streams a loop of synthetic
+// frames through the usual capture, encoder and connection threads, the client decodes and shows them.
+// measures for duration seconds after warmup and emits finished with the results
+class GRLoopbackBenchmark : public Node {
+	GDCLASS(GRLoopbackBenchmark, Node);
+
+public:
+	enum State {
+		STATE_IDLE = 0,
+		STATE_CONNECTING = 1,
+		STATE_WARMUP = 2,
+		STATE_MEASURING = 3,
+		STATE_STOPPING = 4,
+		STATE_FINISHING = 5,
+	};
+
+private:
+	State state = State::STATE_IDLE;
+	GRServer *server = nullptr;
+	GRClient *client = nullptr;
+	class Control *client_view = nullptr;
+	bool synthetic_frames_set = false;
+
+	float duration = 10.f;
+	float warmup = 2.f;
+	float connect_timeout = 10.f;
+	int width = 1920;
+	int height = 1080;
+	int jpg_quality = 80;
+	GRBenchmark::FramePattern pattern = GRBenchmark::FramePattern::PATTERN_SCROLLING;
+	int frames_in_loop = 10; // kept uncompressed, 8 MB each in 1080p
+	uint16_t port = 51349;
+
+	uint64_t session_start_time = 0;
+	uint64_t main_cpu_start_time = 0;
+	uint64_t state_start_time = 0;
+
+	// counters at the start of the measurement
+	uint64_t sent_bytes_start = 0;
+	uint64_t image_bytes_start = 0;
+	uint64_t image_packets_start = 0;
+	uint64_t server_dropped_start = 0;
+	uint64_t client_dropped_start = 0;
+	uint64_t main_cpu_measuring_start = 0;
+	Dictionary cpu_start;
+
+	Dictionary results;
+
+	void _set_state(State _state);
+	void _start_measuring();
+	void _stop_measuring();
+	void _fail(const String &error);
+	void _finish();
+
+protected:
+	static void _bind_methods();
+	void _notification(int p_notification);
+
+public:
+	Error start();
+	bool is_running();
+
+	void set_duration(float _duration);
+	float get_duration();
+	void set_warmup(float _warmup);
+	float get_warmup();
+	void set_width(int _width);
+	int get_width();
+	void set_height(int _height);
+	int get_height();
+	void set_jpg_quality(int _quality);
+	int get_jpg_quality();
+	void set_pattern(GRBenchmark::FramePattern _pattern);
+	GRBenchmark::FramePattern get_pattern();
+	void set_frames_in_loop(int _count);
+	int get_frames_in_loop();
+	void set_port(int _port);
+	int get_port();
+
+	void _init();
+	void _deinit();
+};
+
+#endif // !NO_GODOTREMOTE_CLIENT
+
+#endif // GODOTREMOTE_BENCHMARK && !NO_GODOTREMOTE_SERVER
@@ -4,13 +4,17 @@
 
 #include "GodotRemote.h"
 #include "GRClient.h"
+#include "GRMetrics.h"
 #include "GRNotifications.h"
 #include "GRPacket.h"
 #include "GRResources.h"
 #include "core/input_map.h"
+#include "core/io/config_file.h"
 #include "core/io/file_access_pack.h"
+#include "core/io/pck_packer.h"
 #include "core/io/ip.h"
 #include "core/io/resource_loader.h"
+#include "core/resource.h"
 #include "core/io/tcp_server.h"
 #include "core/os/dir_access.h"
 #include "core/os/file_access.h"
@@ -35,11 +39,15 @@ using namespace GRUtils;
 
 void GRClient::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("_update_texture_from_image", "image"), &GRClient::_update_texture_from_image);
+	ClassDB::bind_method(D_METHOD("_present_stream_frame", "image", "frame_times"), &GRClient::_present_stream_frame);
 	ClassDB::bind_method(D_METHOD("_update_stream_texture_state", "state"), &GRClient::_update_stream_texture_state);
 	ClassDB::bind_method(D_METHOD("_force_update_stream_viewport_signals"), &GRClient::_force_update_stream_viewport_signals);
 	ClassDB::bind_method(D_METHOD("_viewport_size_changed"), &GRClient::_viewport_size_changed);
 	ClassDB::bind_method(D_METHOD("_load_custom_input_scene", "_data"), &GRClient::_load_custom_input_scene);
 	ClassDB::bind_method(D_METHOD("_remove_custom_input_scene"), &GRClient::_remove_custom_input_scene);
+	ClassDB::bind_method(D_METHOD("_apply_custom_input_scene_patch", "_data"), &GRClient::_apply_custom_input_scene_patch);
+	ClassDB::bind_method(D_METHOD("_update_cursor", "_data"), &GRClient::_update_cursor);
+	ClassDB::bind_method(D_METHOD("_reset_cursor"), &GRClient::_reset_cursor);
 	ClassDB::bind_method(D_METHOD("_on_node_deleting", "var_name"), &GRClient::_on_node_deleting);
 
 	ClassDB::bind_method(D_METHOD("set_control_to_show_in", "control_node", "position_in_node"), &GRClient::set_control_to_show_in, DEFVAL(0));
@@ -50,6 +58,8 @@ void GRClient::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_address", "ip"), &GRClient::set_address);
 	ClassDB::bind_method(D_METHOD("set_server_setting", "setting", "value"), &GRClient::set_server_setting);
 	ClassDB::bind_method(D_METHOD("disable_overriding_server_settings"), &GRClient::disable_overriding_server_settings);
+	ClassDB::bind_method(D_METHOD("get_input_latency_histogram"), &GRClient::get_input_latency_histogram);
+	ClassDB::bind_method(D_METHOD("reset_input_latency_histogram"), &GRClient::reset_input_latency_histogram);
 
 	ClassDB::bind_method(D_METHOD("get_custom_input_scene"), &GRClient::get_custom_input_scene);
 	ClassDB::bind_method(D_METHOD("get_address"), &GRClient::get_address);
@@ -58,10 +68,12 @@ void GRClient::_bind_methods() {
 
 	ADD_SIGNAL(MethodInfo("custom_input_scene_added"));
 	ADD_SIGNAL(MethodInfo("custom_input_scene_removed"));
+	ADD_SIGNAL(MethodInfo("custom_input_scene_progress", PropertyInfo(Variant::INT, "received"), PropertyInfo(Variant::INT, "total")));
 
 	ADD_SIGNAL(MethodInfo("stream_state_changed", PropertyInfo(Variant::INT, "state", PROPERTY_HINT_ENUM)));
 	ADD_SIGNAL(MethodInfo("connection_state_changed", PropertyInfo(Variant::BOOL, "is_connected")));
 	ADD_SIGNAL(MethodInfo("mouse_mode_changed", PropertyInfo(Variant::INT, "mouse_mode")));
+	ADD_SIGNAL(MethodInfo("cursor_shape_changed", PropertyInfo(Variant::INT, "shape")));
 	ADD_SIGNAL(MethodInfo("server_settings_received", PropertyInfo(Variant::DICTIONARY, "settings")));
 
 	// SETGET
@@ -71,6 +83,9 @@ void GRClient::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_capture_input", "val"), &GRClient::set_capture_input);
 	ClassDB::bind_method(D_METHOD("set_connection_type", "type"), &GRClient::set_connection_type);
 	ClassDB::bind_method(D_METHOD("set_target_send_fps", "fps"), &GRClient::set_target_send_fps);
+	ClassDB::bind_method(D_METHOD("set_input_coalescing_window", "ms"), &GRClient::set_input_coalescing_window);
+	ClassDB::bind_method(D_METHOD("set_sensor_threshold", "sensor", "threshold"), &GRClient::set_sensor_threshold);
+	ClassDB::bind_method(D_METHOD("set_custom_input_scene_cache_size", "mb"), &GRClient::set_custom_input_scene_cache_size);
 	ClassDB::bind_method(D_METHOD("set_stretch_mode", "mode"), &GRClient::set_stretch_mode);
 	ClassDB::bind_method(D_METHOD("set_texture_filtering", "is_filtered"), &GRClient::set_texture_filtering);
 	ClassDB::bind_method(D_METHOD("set_password", "password"), &GRClient::set_password);
@@ -85,6 +100,9 @@ void GRClient::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_capture_input"), &GRClient::is_capture_input);
 	ClassDB::bind_method(D_METHOD("get_connection_type"), &GRClient::get_connection_type);
 	ClassDB::bind_method(D_METHOD("get_target_send_fps"), &GRClient::get_target_send_fps);
+	ClassDB::bind_method(D_METHOD("get_input_coalescing_window"), &GRClient::get_input_coalescing_window);
+	ClassDB::bind_method(D_METHOD("get_sensor_threshold", "sensor"), &GRClient::get_sensor_threshold);
+	ClassDB::bind_method(D_METHOD("get_custom_input_scene_cache_size"), &GRClient::get_custom_input_scene_cache_size);
 	ClassDB::bind_method(D_METHOD("get_stretch_mode"), &GRClient::get_stretch_mode);
 	ClassDB::bind_method(D_METHOD("get_texture_filtering"), &GRClient::get_texture_filtering);
 	ClassDB::bind_method(D_METHOD("get_password"), &GRClient::get_password);
@@ -99,6 +117,12 @@ void GRClient::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "capture_input"), "set_capture_input", "is_capture_input");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "connection_type", PROPERTY_HINT_ENUM, "WiFi,ADB"), "set_connection_type", "get_connection_type");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "target_send_fps", PROPERTY_HINT_RANGE, "1,1000"), "set_target_send_fps", "get_target_send_fps");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "input_coalescing_window", PROPERTY_HINT_RANGE, "0,100"), "set_input_coalescing_window", "get_input_coalescing_window");
+	ADD_PROPERTYI(PropertyInfo(Variant::REAL, "sensors_threshold/accelerometer", PROPERTY_HINT_RANGE, "0,10,0.001"), "set_sensor_threshold", "get_sensor_threshold", SENSOR_ACCELEROMETER);
+	ADD_PROPERTYI(PropertyInfo(Variant::REAL, "sensors_threshold/gravity", PROPERTY_HINT_RANGE, "0,10,0.001"), "set_sensor_threshold", "get_sensor_threshold", SENSOR_GRAVITY);
+	ADD_PROPERTYI(PropertyInfo(Variant::REAL, "sensors_threshold/gyroscope", PROPERTY_HINT_RANGE, "0,10,0.001"), "set_sensor_threshold", "get_sensor_threshold", SENSOR_GYROSCOPE);
+	ADD_PROPERTYI(PropertyInfo(Variant::REAL, "sensors_threshold/magnetometer", PROPERTY_HINT_RANGE, "0,100,0.01"), "set_sensor_threshold", "get_sensor_threshold", SENSOR_MAGNETOMETER);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "custom_input_scene_cache_size_mb", PROPERTY_HINT_RANGE, "0,1024"), "set_custom_input_scene_cache_size", "get_custom_input_scene_cache_size");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "stretch_mode", PROPERTY_HINT_ENUM, "Fill,Keep Aspect"), "set_stretch_mode", "get_stretch_mode");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "texture_filtering"), "set_texture_filtering", "get_texture_filtering");
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "password"), "set_password", "get_password");
@@ -116,6 +140,11 @@ void GRClient::_bind_methods() {
 	BIND_ENUM_CONSTANT(STREAM_NO_SIGNAL);
 	BIND_ENUM_CONSTANT(STREAM_ACTIVE);
 	BIND_ENUM_CONSTANT(STREAM_NO_IMAGE);
+
+	BIND_ENUM_CONSTANT(SENSOR_ACCELEROMETER);
+	BIND_ENUM_CONSTANT(SENSOR_GRAVITY);
+	BIND_ENUM_CONSTANT(SENSOR_GYROSCOPE);
+	BIND_ENUM_CONSTANT(SENSOR_MAGNETOMETER);
 }
 
 void GRClient::_notification(int p_notification) {
@@ -205,6 +234,7 @@ void GRClient::_internal_call_only_deffered_start() {
 
 	call_deferred("_update_stream_texture_state", StreamState::STREAM_NO_SIGNAL);
 	set_status(WorkingStatus::STATUS_WORKING);
+	_start_metrics_server();
 }
 
 void GRClient::_internal_call_only_deffered_stop() {
@@ -221,7 +251,9 @@ void GRClient::_internal_call_only_deffered_stop() {
 
 	_log("Stopping GodotRemote client", LogLevel::LL_DEBUG);
 	set_status(WorkingStatus::STATUS_STOPPING);
+	_stop_metrics_server();
 	_remove_custom_input_scene();
+	_reset_cursor();
 
 	if (thread_connection) {
 		connection_mutex.lock();
@@ -231,7 +263,7 @@ void GRClient::_internal_call_only_deffered_stop() {
 		thread_connection->close_thread();
 		memdelete(thread_connection);
 	}
-	_send_queue_resize(0);
+	_send_queue_clear();
 
 	call_deferred("_update_stream_texture_state", StreamState::STREAM_NO_SIGNAL);
 	set_status(WorkingStatus::STATUS_STOPPED);
@@ -274,6 +306,7 @@ void GRClient::set_control_to_show_in(Control *ctrl, int position_in_node) {
 		tex_shows_stream->set_expand(true);
 		tex_shows_stream->set_anchor(MARGIN_RIGHT, 1.f);
 		tex_shows_stream->set_anchor(MARGIN_BOTTOM, 1.f);
+		tex_shows_stream->set_default_cursor_shape((Control::CursorShape)cursor_shape);
 		tex_shows_stream->this_in_client = &tex_shows_stream;
 
 		control_to_show_in->add_child(tex_shows_stream);
@@ -385,6 +418,26 @@ int GRClient::get_target_send_fps() {
 	return send_data_fps;
 }
 
+void GRClient::set_input_coalescing_window(int ms) {
+	ERR_FAIL_COND(ms < 0);
+	input_coalescing_window_ms = ms;
+}
+
+int GRClient::get_input_coalescing_window() {
+	return input_coalescing_window_ms;
+}
+
+void GRClient::set_sensor_threshold(SensorType sensor, float threshold) {
+	ERR_FAIL_INDEX(sensor, SENSOR_MAX);
+	ERR_FAIL_COND(threshold < 0);
+	sensors_threshold[sensor] = threshold;
+}
+
+float GRClient::get_sensor_threshold(SensorType sensor) {
+	ERR_FAIL_INDEX_V(sensor, SENSOR_MAX, 0);
+	return sensors_threshold[sensor];
+}
+
 void GRClient::set_stretch_mode(StretchMode stretch) {
 	stretch_mode = stretch;
 	call_deferred("_update_stream_texture_state", signal_connection_state);
@@ -456,6 +509,15 @@ void GRClient::set_input_buffer(int mb) {
 	restart();
 }
 
+void GRClient::set_custom_input_scene_cache_size(int mb) {
+	ERR_FAIL_COND(mb < 0);
+	custom_input_scene_cache_size_in_mb = mb;
+}
+
+int GRClient::get_custom_input_scene_cache_size() {
+	return custom_input_scene_cache_size_in_mb;
+}
+
 void GRClient::set_viewport_orientation_syncing(bool is_syncing) {
 	_viewport_orientation_syncing = is_syncing;
 	if (is_syncing) {
@@ -525,11 +587,126 @@ void GRClient::_force_update_stream_viewport_signals() {
 	call_deferred("_viewport_size_changed"); // force update screen aspect ratio
 }
 
+// paths of all files in a pck
+static Error _read_pck_file_list(const String &_path, std::vector<String> &r_files) {
+	r_files.clear();
+
+	Error err = Error::OK;
+	FileAccess *f = FileAccess::open(_path, FileAccess::READ, &err);
+	if (err) {
+		if (f)
+			memdelete(f);
+		return err;
+	}
+
+	if (f->get_32() != PACK_HEADER_MAGIC) {
+		memdelete(f);
+		return Error::ERR_FILE_UNRECOGNIZED;
+	}
+
+	// format and engine versions, reserved
+	for (int i = 0; i < 4 + 16; i++) {
+		f->get_32();
+	}
+
+	uint32_t count = f->get_32();
+	for (uint32_t i = 0; i < count && !f->eof_reached(); i++) {
+		uint32_t len = f->get_32();
+		CharString cs;
+		cs.resize(len + 1);
+		f->get_buffer((uint8_t *)cs.ptrw(), len);
+		cs.ptrw()[len] = 0;
+		r_files.push_back(String::utf8(cs.get_data()));
+		f->seek(f->get_position() + 8 + 8 + 16); // offset, size, md5
+	}
+
+	memdelete(f);
+	return Error::OK;
+}
+
+// hash of a written pack. must match the hash the server gave to this pack
+static String _get_pck_file_hash(const String &_path, const Ref<GRPacketCustomInputScene> &_data) {
+	FileAccess *f = FileAccess::open(_path, FileAccess::READ);
+	if (!f)
+		return "";
+
+	if (f->get_32() != PACK_HEADER_MAGIC) {
+		memdelete(f);
+		return "";
+	}
+
+	// format and engine versions, reserved
+	for (int i = 0; i < 4 + 16; i++) {
+		f->get_32();
+	}
+
+	std::vector<String> files;
+	std::vector<uint64_t> offsets, sizes;
+	uint32_t count = f->get_32();
+	for (uint32_t i = 0; i < count && !f->eof_reached(); i++) {
+		uint32_t len = f->get_32();
+		CharString cs;
+		cs.resize(len + 1);
+		f->get_buffer((uint8_t *)cs.ptrw(), len);
+		cs.ptrw()[len] = 0;
+		files.push_back(String::utf8(cs.get_data()));
+		offsets.push_back(f->get_64());
+		sizes.push_back(f->get_64());
+		f->seek(f->get_position() + 16); // md5
+	}
+
+	std::vector<Vector<uint8_t> > contents;
+	for (int i = 0; i < files.size(); i++) {
+		if (offsets[i] + sizes[i] > f->get_len()) {
+			memdelete(f);
+			return "";
+		}
+
+		Vector<uint8_t> d;
+		d.resize(sizes[i]);
+		f->seek(offsets[i]);
+		if (sizes[i] && f->get_buffer(d.ptrw(), sizes[i]) != sizes[i]) {
+			memdelete(f);
+			return "";
+		}
+		contents.push_back(d);
+	}
+	memdelete(f);
+
+	if (files.size() != count)
+		return "";
+
+	return GRUtils::get_pck_content_hash(_data->get_scene_path(), files, contents);
+}
+
+// verified packs are renamed to the cache file, so the cache never has partial or broken packs
+static Error _move_verified_pck_file(const String &_tmp, const String &_path, const Ref<GRPacketCustomInputScene> &_data, const String &_hash) {
+	DirAccess *dir = DirAccess::create_for_path(_path);
+	if (!dir)
+		return Error::ERR_CANT_CREATE;
+
+	Error err = Error::OK;
+	if (_get_pck_file_hash(_tmp, _data) != _hash) {
+		err = Error::ERR_FILE_CORRUPT;
+	} else {
+		if (dir->file_exists(_path)) {
+			dir->remove(_path);
+		}
+		err = dir->rename(_tmp, _path);
+	}
+
+	if (err) {
+		dir->remove(_tmp);
+	}
+	memdelete(dir);
+	return err;
+}
+
 void GRClient::_load_custom_input_scene(Ref<GRPacketCustomInputScene> _data) {
 	_remove_custom_input_scene();
 
-	if (_data->get_scene_path().empty() || _data->get_scene_data().size() == 0) {
-		_log("Scene not specified or data is empty. Removing custom input scene", LogLevel::LL_DEBUG);
+	if (_data->get_scene_path().empty()) {
+		_log("Scene not specified. Removing custom input scene", LogLevel::LL_DEBUG);
 		return;
 	}
 
@@ -539,10 +716,26 @@ void GRClient::_load_custom_input_scene(Ref<GRPacketCustomInputScene> _data) {
 	}
 
 	Error err = Error::OK;
-	FileAccess *file = FileAccess::open(custom_input_scene_tmp_pck_file, FileAccess::ModeFlags::WRITE, &err);
-	if (err) {
-		_log("Can't open temp file to store custom input scene: " + custom_input_scene_tmp_pck_file + ", code: " + str(err), LogLevel::LL_ERROR);
+	String pck_file = _get_custom_input_scene_cache_file(_data->get_scene_hash());
+
+	if (_data->get_scene_data().size() == 0) {
+		// only announced, so it must be in the cache
+		if (pck_file.empty() || !FileAccess::exists(pck_file)) {
+			_log("Custom input scene not found in cache: " + _data->get_scene_hash(), LogLevel::LL_ERROR);
+			return;
+		}
+		_log("Custom input scene loaded from cache: " + _data->get_scene_hash(), LogLevel::LL_DEBUG);
+		_update_custom_input_scene_cache(_data->get_scene_hash(), 0);
 	} else {
+		if (pck_file.empty()) {
+			pck_file = custom_input_scene_tmp_pck_file;
+		} else {
+			DirAccess *dir = DirAccess::create_for_path(custom_input_scene_cache_dir);
+			if (dir) {
+				dir->make_dir_recursive(custom_input_scene_cache_dir);
+				memdelete(dir);
+			}
+		}
 
 		PoolByteArray scene_data;
 		if (_data->is_compressed()) {
@@ -553,50 +746,382 @@ void GRClient::_load_custom_input_scene(Ref<GRPacketCustomInputScene> _data) {
 
 		if (err) {
 			_log("Can't decompress or set scene_data: Code: " + str(err), LogLevel::LL_ERROR);
-		} else {
-
-			auto r = scene_data.read();
-			file->store_buffer(r.ptr(), scene_data.size());
-			r.release();
-			file->close();
+			return;
+		}
 
-			if (PackedData::get_singleton()->is_disabled()) {
-				err = Error::FAILED;
-			} else {
-				err = PackedData::get_singleton()->add_pack(custom_input_scene_tmp_pck_file, true, 0);
+		bool to_cache = pck_file != custom_input_scene_tmp_pck_file;
+		String write_file = to_cache ? pck_file + ".tmp" : pck_file;
+		FileAccess *file = FileAccess::open(write_file, FileAccess::ModeFlags::WRITE, &err);
+		if (err) {
+			_log("Can't open file to store custom input scene: " + write_file + ", code: " + str(err), LogLevel::LL_ERROR);
+			if (file) {
+				memdelete(file);
 			}
+			return;
+		}
 
+		auto r = scene_data.read();
+		file->store_buffer(r.ptr(), scene_data.size());
+		r.release();
+		file->close();
+		memdelete(file);
+
+		if (to_cache) {
+			err = _move_verified_pck_file(write_file, pck_file, _data, _data->get_scene_hash());
 			if (err) {
-				_log("Can't load PCK file: " + custom_input_scene_tmp_pck_file, LogLevel::LL_ERROR);
+				_log("Custom input scene doesn't match its hash: " + _data->get_scene_hash() + ". Code: " + str(err), LogLevel::LL_ERROR);
+				return;
+			}
+			_update_custom_input_scene_cache(_data->get_scene_hash(), scene_data.size());
+		}
+	}
+
+	if (PackedData::get_singleton()->is_disabled()) {
+		err = Error::FAILED;
+	} else {
+		err = PackedData::get_singleton()->add_pack(pck_file, true, 0);
+	}
+
+	if (err) {
+		_log("Can't load PCK file: " + pck_file, LogLevel::LL_ERROR);
+	} else {
+
+		Ref<PackedScene> pck = ResourceLoader::load(_data->get_scene_path(), "", false, &err);
+		if (err) {
+			_log("Can't load scene file: " + _data->get_scene_path() + ", code: " + str(err), LogLevel::LL_ERROR);
+		} else {
+
+			custom_input_scene = pck->instance();
+			if (!custom_input_scene) {
+				_log("Can't instance scene from PCK file: " + pck_file + ", scene: " + _data->get_scene_path(), LogLevel::LL_ERROR);
 			} else {
 
-				Ref<PackedScene> pck = ResourceLoader::load(_data->get_scene_path(), "", false, &err);
-				if (err) {
-					_log("Can't load scene file: " + _data->get_scene_path() + ", code: " + str(err), LogLevel::LL_ERROR);
-				} else {
+				control_to_show_in->add_child(custom_input_scene);
+				custom_input_scene->connect("tree_exiting", this, "_on_node_deleting", vec_args({ (int)DeletingVarName::CUSTOM_INPUT_SCENE }));
+				custom_input_scene_hash = _data->get_scene_hash();
+				_read_pck_file_list(pck_file, custom_input_scene_files);
 
-					custom_input_scene = pck->instance();
-					if (!custom_input_scene) {
-						_log("Can't instance scene from PCK file: " + custom_input_scene_tmp_pck_file + ", scene: " + _data->get_scene_path(), LogLevel::LL_ERROR);
-					} else {
+				_reset_counters();
+				emit_signal("custom_input_scene_added");
+			}
+		}
+	}
+}
 
-						control_to_show_in->add_child(custom_input_scene);
-						custom_input_scene->connect("tree_exiting", this, "_on_node_deleting", vec_args({ (int)DeletingVarName::CUSTOM_INPUT_SCENE }));
+void GRClient::_apply_custom_input_scene_patch(Ref<GRPacketCustomInputScenePatch> _data) {
+	ERR_FAIL_COND(_data.is_null());
 
-						_reset_counters();
-						emit_signal("custom_input_scene_added");
-					}
-				}
+	// patch can be applied only on top of the same pack
+	if (!custom_input_scene || custom_input_scene_hash.empty() || custom_input_scene_hash != _data->get_base_hash()) {
+		_log("Custom input scene patch doesn't match loaded scene. Requesting full scene", LogLevel::LL_DEBUG);
+		Ref<GRPacketCustomInputSceneRequest> req(memnew(GRPacketCustomInputSceneRequest));
+		req->set_scene_hash(_data->get_scene_hash());
+		send_packet(req, SendPriority::PRIORITY_HIGH);
+		return;
+	}
+
+	Error err = Error::OK;
+	PoolByteArray patch_data;
+	if (_data->is_compressed()) {
+		err = decompress_bytes(_data->get_scene_data(), _data->get_original_size(), patch_data, _data->get_compression_type());
+	} else {
+		patch_data = _data->get_scene_data();
+	}
+
+	if (err) {
+		_log("Can't decompress custom input scene patch: Code: " + str(err), LogLevel::LL_ERROR);
+		return;
+	}
+
+	// mounted files keep offsets in their pack, so each patch needs its own file
+	String patch_file = custom_input_scene_tmp_pck_file.get_basename() + "_" + _data->get_scene_hash().substr(0, 16) + ".pck";
+	FileAccess *file = FileAccess::open(patch_file, FileAccess::ModeFlags::WRITE, &err);
+	if (err) {
+		_log("Can't open file to store custom input scene patch: " + patch_file + ", code: " + str(err), LogLevel::LL_ERROR);
+		if (file) {
+			memdelete(file);
+		}
+		return;
+	}
+
+	auto r = patch_data.read();
+	file->store_buffer(r.ptr(), patch_data.size());
+	r.release();
+	file->close();
+	memdelete(file);
+	custom_input_scene_patch_files.push_back(patch_file);
+
+	err = PackedData::get_singleton()->add_pack(patch_file, true, 0);
+	if (err) {
+		_log("Can't load PCK file: " + patch_file, LogLevel::LL_ERROR);
+		return;
+	}
+
+	// already loaded resources are updated in place
+	PoolStringArray changed = _data->get_changed_files();
+	for (int i = 0; i < changed.size(); i++) {
+		String path = changed[i];
+		if (path == _data->get_scene_path() || !ResourceCache::has(path))
+			continue;
+
+		Ref<Resource> res = ResourceCache::get(path);
+		if (res.is_valid()) {
+			res->reload_from_file();
+		}
+	}
+
+	Ref<PackedScene> pck = ResourceLoader::load(_data->get_scene_path(), "", true, &err);
+	if (err || pck.is_null()) {
+		_log("Can't reload scene file: " + _data->get_scene_path() + ", code: " + str(err), LogLevel::LL_ERROR);
+		return;
+	}
+
+	Node *scene = pck->instance();
+	if (!scene) {
+		_log("Can't instance patched scene: " + _data->get_scene_path(), LogLevel::LL_ERROR);
+		return;
+	}
+
+	// replace instance without removing mounted files
+	int pos = custom_input_scene->get_position_in_parent();
+	custom_input_scene->disconnect("tree_exiting", this, "_on_node_deleting");
+	custom_input_scene->queue_delete();
+
+	custom_input_scene = scene;
+	control_to_show_in->add_child(custom_input_scene);
+	control_to_show_in->move_child(custom_input_scene, pos);
+	custom_input_scene->connect("tree_exiting", this, "_on_node_deleting", vec_args({ (int)DeletingVarName::CUSTOM_INPUT_SCENE }));
+	custom_input_scene_hash = _data->get_scene_hash();
+
+	for (int i = 0; i < changed.size(); i++) {
+		if (std::find(custom_input_scene_files.begin(), custom_input_scene_files.end(), changed[i]) == custom_input_scene_files.end())
+			custom_input_scene_files.push_back(changed[i]);
+	}
+	_store_patched_custom_input_scene(_data);
+
+	_log("Custom input scene patched: " + str(changed.size()) + " files", LogLevel::LL_DEBUG);
+	emit_signal("custom_input_scene_added");
+}
+
+// writes the mounted pack with all applied patches as one pack, so a reconnect finds it in the cache
+void GRClient::_store_patched_custom_input_scene(Ref<GRPacketCustomInputScenePatch> _data) {
+	const String hash = _data->get_scene_hash();
+	String cache_file = _get_custom_input_scene_cache_file(hash);
+	if (cache_file.empty() || custom_input_scene_files.empty())
+		return;
+
+	if (FileAccess::exists(cache_file)) {
+		_update_custom_input_scene_cache(hash, 0);
+		return;
+	}
+
+	// res:// paths are read from the mounted packs, so changed files come from the patches
+	String tmp_file = cache_file + ".tmp";
+	Ref<PCKPacker> packer = newref(PCKPacker);
+	Error err = packer->pck_start(tmp_file);
+	for (int i = 0; i < custom_input_scene_files.size() && !err; i++) {
+		err = packer->add_file(custom_input_scene_files[i], custom_input_scene_files[i]);
+	}
+	if (!err) {
+		err = packer->flush();
+	}
+
+	int size = 0;
+	FileAccess *f = FileAccess::open(tmp_file, FileAccess::READ);
+	if (f) {
+		size = (int)f->get_len();
+		memdelete(f);
+	}
+
+	if (!err && size) {
+		// fails if the server also removed some files
+		err = _move_verified_pck_file(tmp_file, cache_file, _data, hash);
+	} else {
+		DirAccess *dir = DirAccess::create_for_path(tmp_file);
+		if (dir) {
+			dir->remove(tmp_file);
+			memdelete(dir);
+		}
+	}
+
+	if (err || !size) {
+		_log("Can't cache patched custom input scene: " + hash + ". Code: " + str(err), LogLevel::LL_ERROR);
+		return;
+	}
+
+	_update_custom_input_scene_cache(hash, size);
+}
+
+String GRClient::_get_custom_input_scene_cache_file(const String &_hash) {
+	if (_hash.empty() || custom_input_scene_cache_size_in_mb <= 0)
+		return "";
+	return custom_input_scene_cache_dir.plus_file(_hash + ".pck");
+}
+
+// marks pack as recently used. new packs also have their size
+void GRClient::_update_custom_input_scene_cache(const String &_hash, int _size) {
+	const String index_file = custom_input_scene_cache_dir.plus_file("index.cfg");
+	const String section = "packs";
+
+	Ref<ConfigFile> index(memnew(ConfigFile));
+	index->load(index_file); // fine if it not exists yet
+
+	Dictionary entry = index->get_value(section, _hash, Dictionary());
+	entry["last_used"] = (int64_t)OS::get_singleton()->get_unix_time();
+	if (_size) {
+		entry["size"] = _size;
+	}
+	index->set_value(section, _hash, entry);
+
+	// remove least recently used packs until all of them fit
+	const int64_t max_size = (int64_t)custom_input_scene_cache_size_in_mb * 1024 * 1024;
+	while (true) {
+		List<String> keys;
+		if (index->has_section(section)) {
+			index->get_section_keys(section, &keys);
+		}
+
+		int64_t total = 0;
+		String oldest;
+		int64_t oldest_time = INT64_MAX;
+		for (List<String>::Element *E = keys.front(); E; E = E->next()) {
+			Dictionary d = index->get_value(section, E->get());
+			total += (int64_t)d.get("size", 0);
+			if (E->get() != _hash && (int64_t)d.get("last_used", 0) < oldest_time) {
+				oldest_time = d.get("last_used", 0);
+				oldest = E->get();
 			}
 		}
+
+		if (total <= max_size || oldest.empty())
+			break;
+
+		DirAccess *dir = DirAccess::open(custom_input_scene_cache_dir);
+		if (dir) {
+			dir->remove(oldest + ".pck");
+			memdelete(dir);
+		}
+		index->erase_section_key(section, oldest);
+		_log("Custom input scene removed from cache: " + oldest, LogLevel::LL_DEBUG);
 	}
 
-	if (file) {
-		memdelete(file);
+	Error err = index->save(index_file);
+	if (err) {
+		_log("Can't save custom input scene cache index. Code: " + str(err), LogLevel::LL_ERROR);
+	}
+}
+
+void GRClient::_update_cursor(Ref<GRPacketCursorShapeSync> _data) {
+	ERR_FAIL_COND(_data.is_null());
+	Input::CursorShape shape = _data->get_shape();
+	ERR_FAIL_INDEX(shape, Input::CURSOR_MAX);
+
+	PoolByteArray data = _data->get_image();
+	if (data.size()) {
+		Ref<Image> img(memnew(Image));
+		Error err = img->load_png_from_buffer(data);
+		if (err) {
+			_log("Can't decode cursor image. Code: " + str(err), LogLevel::LL_ERROR);
+		} else {
+			CustomCursor c;
+			c.image = img;
+			c.hotspot = _data->get_hotspot();
+			custom_cursors[shape] = c;
+		}
+	} else {
+		custom_cursors.erase(shape);
+	}
+
+	// all cursors are scaled by the server window size
+	if (cursor_screen_size != _data->get_screen_size()) {
+		cursor_screen_size = _data->get_screen_size();
+		_apply_custom_cursors();
+	} else {
+		_apply_custom_cursor(shape);
+	}
+
+	// OS draws it at the local pointer position, so no round trip to the server
+	cursor_shape = shape;
+	if (tex_shows_stream && !tex_shows_stream->is_queued_for_deletion()) {
+		tex_shows_stream->set_default_cursor_shape((Control::CursorShape)shape);
+	}
+	emit_signal("cursor_shape_changed", shape);
+}
+
+void GRClient::_reset_cursor() {
+	custom_cursors.clear();
+	_apply_custom_cursors();
+
+	if (cursor_shape != Input::CURSOR_ARROW) {
+		cursor_shape = Input::CURSOR_ARROW;
+		if (tex_shows_stream && !tex_shows_stream->is_queued_for_deletion()) {
+			tex_shows_stream->set_default_cursor_shape(Control::CURSOR_ARROW);
+		}
+		emit_signal("cursor_shape_changed", cursor_shape);
+	}
+}
+
+// sets the cursor scaled like the stream or restores the default one
+void GRClient::_apply_custom_cursor(int shape) {
+	auto c = custom_cursors.find(shape);
+	if (!stream_hovered || c == custom_cursors.end()) {
+		if (custom_cursor_shapes & (1u << shape)) {
+			Input::get_singleton()->set_custom_mouse_cursor(RES(), (Input::CursorShape)shape);
+			custom_cursor_shapes &= ~(1u << shape);
+		}
+		return;
 	}
+
+	// image and hotspot are in server window pixels
+	Vector2 scale(1, 1);
+	if (input_collector && tex_shows_stream && cursor_screen_size.x > 0 && cursor_screen_size.y > 0) {
+		input_collector->_update_stream_rect();
+		Size2 size = input_collector->stream_rect.size;
+		if (size.x > 0 && size.y > 0) {
+			scale = size / cursor_screen_size * tex_shows_stream->get_viewport()->get_final_transform().get_scale();
+		}
+	}
+
+	Ref<Image> img = c->second.image;
+	int width = max(1, (int)Math::round(img->get_width() * scale.x));
+	int height = max(1, (int)Math::round(img->get_height() * scale.y));
+	if (width != img->get_width() || height != img->get_height()) {
+		img = img->duplicate();
+		img->resize(width, height, Image::INTERPOLATE_BILINEAR);
+	}
+
+	Ref<ImageTexture> tex(memnew(ImageTexture));
+	tex->create_from_image(img, 0);
+	Input::get_singleton()->set_custom_mouse_cursor(tex, (Input::CursorShape)shape, c->second.hotspot * scale);
+	custom_cursor_shapes |= 1u << shape;
+}
+
+void GRClient::_apply_custom_cursors() {
+	for (int i = 0; i < Input::CURSOR_MAX; i++) {
+		_apply_custom_cursor(i);
+	}
+}
+
+// custom cursors are app-wide, so they are set only while the pointer is over the stream
+void GRClient::_set_stream_hovered(bool _hovered) {
+	if (stream_hovered == _hovered)
+		return;
+	stream_hovered = _hovered;
+	_apply_custom_cursors();
 }
 
 void GRClient::_remove_custom_input_scene() {
+	custom_input_scene_hash = "";
+	custom_input_scene_files.clear();
+	for (int i = 0; i < custom_input_scene_patch_files.size(); i++) {
+		DirAccess *dir = DirAccess::create_for_path(custom_input_scene_patch_files[i]);
+		if (dir) {
+			dir->remove(custom_input_scene_patch_files[i]);
+			memdelete(dir);
+		}
+	}
+	custom_input_scene_patch_files.clear();
+
 	if (custom_input_scene && !custom_input_scene->is_queued_for_deletion()) {
 
 		custom_input_scene->queue_delete();
@@ -632,42 +1157,25 @@ void GRClient::_viewport_size_changed() {
 		ScreenOrientation tmp_vert = size.x < size.y ? ScreenOrientation::VERTICAL : ScreenOrientation::HORIZONTAL;
 		if (tmp_vert != is_vertical) {
 			is_vertical = tmp_vert;
-			send_queue_mutex.lock();
-			Ref<GRPacketClientStreamOrientation> packet = _find_queued_packet_by_type<Ref<GRPacketClientStreamOrientation> >();
-			if (packet.is_valid()) {
-				packet->set_vertical(is_vertical == ScreenOrientation::VERTICAL);
-				send_queue_mutex.unlock();
-				goto ratio_sync;
-			}
-			send_queue_mutex.unlock();
 
-			if (packet.is_null()) {
-				packet.instance();
-				packet->set_vertical(is_vertical == ScreenOrientation::VERTICAL);
-				send_packet(packet);
-			}
+			Ref<GRPacketClientStreamOrientation> packet = newref(GRPacketClientStreamOrientation);
+			packet->set_vertical(is_vertical == ScreenOrientation::VERTICAL);
+
+			send_slots_mutex.lock();
+			_send_slot_push(packet);
+			send_slots_mutex.unlock();
 		}
 	}
 
-ratio_sync:
-
 	if (_viewport_aspect_ratio_syncing) {
 		Vector2 size = control_to_show_in->get_size();
 
-		send_queue_mutex.lock();
-		Ref<GRPacketClientStreamAspect> packet = _find_queued_packet_by_type<Ref<GRPacketClientStreamAspect> >();
-		if (packet.is_valid()) {
-			packet->set_aspect(size.x / size.y);
-			send_queue_mutex.unlock();
-			return;
-		}
-		send_queue_mutex.unlock();
+		Ref<GRPacketClientStreamAspect> packet = newref(GRPacketClientStreamAspect);
+		packet->set_aspect(size.x / size.y);
 
-		if (packet.is_null()) {
-			packet.instance();
-			packet->set_aspect(size.x / size.y);
-			send_packet(packet);
-		}
+		send_slots_mutex.lock();
+		_send_slot_push(packet);
+		send_slots_mutex.unlock();
 	}
 }
 
@@ -676,11 +1184,17 @@ void GRClient::_update_texture_from_image(Ref<Image> img) {
 		if (img.is_valid()) {
 			Ref<ImageTexture> tex = tex_shows_stream->get_texture();
 			if (tex.is_valid()) {
+				if (input_collector && tex->get_size() != img->get_size()) {
+					input_collector->_invalidate_stream_rect();
+				}
 				tex->create_from_image(img);
 			} else {
 				tex.instance();
 				tex->create_from_image(img);
 				tex_shows_stream->set_texture(tex);
+				if (input_collector) {
+					input_collector->_invalidate_stream_rect();
+				}
 			}
 
 			uint32_t new_flags = Texture::FLAG_MIPMAPS | (is_filtering_enabled ? Texture::FLAG_FILTER : 0);
@@ -689,8 +1203,101 @@ void GRClient::_update_texture_from_image(Ref<Image> img) {
 			}
 		} else {
 			tex_shows_stream->set_texture(nullptr);
+			if (input_collector) {
+				input_collector->_invalidate_stream_rect();
+			}
+		}
+	}
+}
+
+void GRClient::_present_stream_frame(Ref<Image> img, Dictionary frame_times) {
+	GR_TRACE_SCOPE("present");
+	int64_t upload_start = (int64_t)OS::get_singleton()->get_ticks_usec();
+	_update_texture_from_image(img);
+
+	// all times are in the client clock
+	int64_t present = (int64_t)OS::get_singleton()->get_ticks_usec();
+	int64_t capture = frame_times["capture"];
+	int64_t readback = frame_times["readback"];
+	int64_t encode_start = frame_times["encode_start"];
+	int64_t encode_end = frame_times["encode_end"];
+	int64_t send = frame_times["send"];
+	int64_t receive = frame_times["receive"];
+	int64_t decode_start = frame_times["decode_start"];
+	int64_t decode_end = frame_times["decode_end"];
+
+	Dictionary lb;
+	lb["readback"] = (readback - capture) / 1000.0;
+	lb["encode_wait"] = (encode_start - readback) / 1000.0;
+	lb["encode"] = (encode_end - encode_start) / 1000.0;
+	lb["send_wait"] = (send - encode_end) / 1000.0;
+	lb["network"] = (receive - send) / 1000.0;
+	lb["decode_wait"] = (decode_start - receive) / 1000.0;
+	lb["decode"] = (decode_end - decode_start) / 1000.0;
+	lb["present_wait"] = (present - decode_end) / 1000.0;
+	lb["total"] = (present - capture) / 1000.0;
+	lb["clock_offset"] = (int64_t)frame_times["clock_offset"] / 1000.0;
+	lb["clock_drift_ppm"] = frame_times["clock_drift_ppm"];
+	lb["clock_rtt"] = (int64_t)frame_times["clock_rtt"] / 1000.0;
+	_set_latency_breakdown(lb);
+
+	if ((bool)frame_times["clock_synced"]) {
+		_add_stage_time(STAGE_RECEIVE, receive - send);
+		if (present >= capture)
+			frame_latency_histogram.add(present - capture);
+	}
+	_add_stage_time(STAGE_QUEUE_WAIT, decode_start - receive);
+	_add_stage_time(STAGE_DECODE, decode_end - decode_start);
+	_add_stage_time(STAGE_TEXTURE_UPLOAD, present - upload_start);
+
+	// every batch applied before this frame is now visible
+	uint32_t seq = frame_times["input_sequence"];
+	if (seq) {
+		input_latency_mutex.lock();
+		while (!pending_input_times.empty() && pending_input_times.front().first <= seq) {
+			input_latency_histogram.add(present - pending_input_times.front().second);
+			pending_input_times.pop_front();
 		}
+		input_latency_mutex.unlock();
+	}
+}
+
+Dictionary GRClient::get_input_latency_histogram() {
+	return input_latency_histogram.get_dictionary();
+}
+
+void GRClient::reset_input_latency_histogram() {
+	input_latency_histogram.reset();
+}
+
+Dictionary GRClient::get_stats() {
+	Dictionary res = GRDevice::get_stats();
+	if (input_latency_histogram.get_count()) {
+		res["input_latency"] = input_latency_histogram.get_dictionary();
 	}
+	if (frame_latency_histogram.get_count()) {
+		res["frame_latency"] = frame_latency_histogram.get_dictionary();
+	}
+	return res;
+}
+
+void GRClient::reset_stats() {
+	GRDevice::reset_stats();
+	input_latency_histogram.reset();
+	frame_latency_histogram.reset();
+}
+
+void GRClient::_write_metrics(GRMetricsWriter &w) {
+	GRDevice::_write_metrics(w);
+	w.add_value("godot_remote_queue_depth", stream_queue_size.load(), "queue=\"stream\"");
+
+	w.add_metric("godot_remote_connected", "gauge", "1 if the client is connected to the server", is_connection_working.load() ? 1 : 0);
+
+	w.add_header("godot_remote_input_latency_seconds", "summary", "Time from the first input event of a batch to the frame that shows it");
+	w.add_summary_values("godot_remote_input_latency_seconds", input_latency_histogram);
+
+	w.add_header("godot_remote_frame_latency_seconds", "summary", "Time from the capture on the server to the frame shown on the client");
+	w.add_summary_values("godot_remote_frame_latency_seconds", frame_latency_histogram);
 }
 
 void GRClient::_update_stream_texture_state(StreamState _stream_state) {
@@ -737,6 +1344,10 @@ void GRClient::_update_stream_texture_state(StreamState _stream_state) {
 				break;
 		}
 
+		if (input_collector) {
+			input_collector->_invalidate_stream_rect();
+		}
+
 		if (signal_connection_state != _stream_state) {
 			call_deferred("emit_signal", "stream_state_changed", _stream_state);
 			signal_connection_state = (StreamState)_stream_state;
@@ -746,24 +1357,17 @@ void GRClient::_update_stream_texture_state(StreamState _stream_state) {
 
 void GRClient::_reset_counters() {
 	GRDevice::_reset_counters();
-	sync_time_client = 0;
-	sync_time_server = 0;
 }
 
 void GRClient::set_server_setting(TypesOfServerSettings param, Variant value) {
-	send_queue_mutex.lock();
-	Ref<GRPacketServerSettings> packet = _find_queued_packet_by_type<Ref<GRPacketServerSettings> >();
-	if (packet.is_valid()) {
-		packet->add_setting(param, value);
-		send_queue_mutex.unlock();
-		return;
-	}
-	send_queue_mutex.unlock();
+	send_slots_mutex.lock();
+	Ref<GRPacketServerSettings> packet = _find_send_slot<Ref<GRPacketServerSettings> >();
 	if (packet.is_null()) {
 		packet.instance();
-		packet->add_setting(param, value);
-		send_packet(packet);
+		_send_slot_push(packet);
 	}
+	packet->add_setting(param, value);
+	send_slots_mutex.unlock();
 }
 
 void GRClient::disable_overriding_server_settings() {
@@ -781,6 +1385,8 @@ void GRClient::_thread_connection(THREAD_DATA p_userdata) {
 
 	OS *os = OS::get_singleton();
 	Thread::set_name("GRemote_connection");
+	GRUtils::trace_set_thread_name("client_connection");
+	GR_THREAD_CPU_SCOPE("client_connection");
 	GRDevice::AuthResult prev_auth_error = GRDevice::AuthResult::OK;
 
 	const String con_error_title = "Connection Error";
@@ -794,7 +1400,13 @@ void GRClient::_thread_connection(THREAD_DATA p_userdata) {
 		if (con->get_status() == StreamPeerTCP::STATUS_CONNECTED || con->get_status() == StreamPeerTCP::STATUS_CONNECTING) {
 			con->disconnect_from_host();
 		}
-		dev->_send_queue_resize(0);
+		dev->_send_queue_clear();
+		dev->recv_batch.clear();
+		dev->server_clock.reset();
+		dev->input_sequence = 0;
+		dev->input_latency_mutex.lock();
+		dev->pending_input_times.clear();
+		dev->input_latency_mutex.unlock();
 
 		IP_Address adr;
 		if (dev->con_type == CONNECTION_ADB) {
@@ -896,6 +1508,7 @@ void GRClient::_thread_connection(THREAD_DATA p_userdata) {
 				dev->is_connection_working = false;
 				dev->call_deferred("emit_signal", "connection_state_changed", false);
 				dev->call_deferred("emit_signal", "mouse_mode_changed", Input::MouseMode::MOUSE_MODE_VISIBLE);
+				dev->call_deferred("_reset_cursor");
 				break;
 			}
 			case GRDevice::AuthResult::ERROR:
@@ -969,15 +1582,25 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 
 	std::vector<Ref<GRPacketImageData> > stream_queue;
 
+	// custom input scene received by chunks
+	String scene_chunks_hash;
+	PoolByteArray scene_chunks_data;
+	int scene_chunks_received = 0; // also the offset of the next chunk
+	// broken transfers are requested again a few times
+	String scene_chunks_failed_hash;
+	int scene_chunks_retries = 0;
+
 	uint64_t time64 = os->get_ticks_usec();
 	uint64_t prev_cycle_time = 0;
 	uint64_t prev_send_input_time = time64;
 	uint64_t prev_ping_sending_time = time64;
+	uint64_t prev_sync_time_request = 0;
 	uint64_t next_image_required_frametime = time64;
 	uint64_t prev_display_image_time = time64 - 16_ms;
 
 	bool ping_sended = false;
 
+	GRPacketWriter writer(ppeer, &dev->sent_traffic);
 	TimeCountInit();
 	while (!con_thread->break_connection && !con_thread->stop_thread && connection->is_connected_to_host()) {
 		dev->connection_mutex.lock();
@@ -994,20 +1617,40 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 		bool is_queued_send = false; // this placed here for android compiler
 
 		// INPUT
+		// discrete events are sent right away, motion after the coalescing window
+		// and everything else, including sensors, with the target send rate
 		TimeCountReset();
 		time64 = os->get_ticks_usec();
-		if ((time64 - prev_send_input_time) > send_data_time_us) {
-			prev_send_input_time = time64;
-			nothing_happens = false;
+		{
+			bool is_send_time = (time64 - prev_send_input_time) > send_data_time_us;
+			if (is_send_time) {
+				prev_send_input_time = time64;
+			}
 
-			if (dev->input_collector) {
-				Ref<GRPacketInputData> pack = dev->input_collector->get_collected_input_data();
+			if (dev->input_collector && (is_send_time || dev->input_collector->is_input_flush_required(time64, dev->input_coalescing_window_ms * 1000))) {
+				GR_TRACE_SCOPE("send_input");
+				nothing_happens = false;
+				uint64_t first_event_time = 0;
+				Ref<GRPacketInputData> pack = dev->input_collector->get_collected_input_data(&first_event_time);
 
 				if (pack.is_valid()) {
-					err = ppeer->put_var(pack->get_data());
-					if (err) {
-						_log("Put input data failed with code: " + str((int)err), LogLevel::LL_ERROR);
-						goto end_send;
+					if (pack->get_input_batch_count()) {
+						pack->set_time_offset(dev->server_clock.get_offset(time64));
+						pack->set_input_sequence(++dev->input_sequence);
+						if (first_event_time) {
+							dev->input_latency_mutex.lock();
+							dev->pending_input_times.push_back(std::make_pair(dev->input_sequence, first_event_time));
+							// frames are not coming, keep only recent batches
+							while (dev->pending_input_times.size() > 256) {
+								dev->pending_input_times.pop_front();
+							}
+							dev->input_latency_mutex.unlock();
+						}
+						err = writer.put(pack->get_data());
+						if (err) {
+							_log("Put input data failed with code: " + str((int)err), LogLevel::LL_ERROR);
+							goto end_send;
+						}
 					}
 				} else {
 					_log("Can't get input data from input collector", LogLevel::LL_ERROR);
@@ -1016,6 +1659,21 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 			}
 		}
 
+		// TIME SYNC
+		// requests for the NTP-style clock estimation
+		time64 = os->get_ticks_usec();
+		if (time64 - prev_sync_time_request > 1000_ms) {
+			nothing_happens = false;
+			prev_sync_time_request = time64;
+
+			Ref<GRPacketSyncTime> pack = newref(GRPacketSyncTime);
+			err = writer.put(pack->get_data());
+			if (err) {
+				_log("Send sync time request failed with code: " + str(err), LogLevel::LL_ERROR);
+				goto end_send;
+			}
+		}
+
 		// PING
 		TimeCountReset();
 		time64 = os->get_ticks_usec();
@@ -1024,7 +1682,7 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 			ping_sended = true;
 
 			Ref<GRPacketPing> pack = newref(GRPacketPing);
-			err = ppeer->put_var(pack->get_data());
+			err = writer.put(pack->get_data());
 			prev_ping_sending_time = time64;
 
 			if (err) {
@@ -1034,25 +1692,47 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 			TimeCount("Ping send");
 		}
 
+		// BULK DATA
+		// limited by the window of each channel and the bandwidth limit
+		{
+			bool bulk_sent = false;
+			err = dev->_bulk_send(writer, send_data_time_us / 4, bulk_sent);
+			if (bulk_sent) {
+				nothing_happens = false;
+			}
+			if (err) {
+				_log("Send bulk data failed with code: " + str(err), LogLevel::LL_ERROR);
+				goto end_send;
+			}
+		}
+
 		// SEND QUEUE
 		start_while_time = os->get_ticks_usec();
-		while (!dev->send_queue.empty() && (os->get_ticks_usec() - start_while_time) <= send_data_time_us / 2) {
-			is_queued_send = true;
+		while ((os->get_ticks_usec() - start_while_time) <= send_data_time_us / 2) {
 			Ref<GRPacket> packet = dev->_send_queue_pop_front();
+			if (packet.is_null())
+				break;
 
-			if (packet.is_valid()) {
-				err = ppeer->put_var(packet->get_data());
+			is_queued_send = true;
+			err = writer.put(packet->get_data());
 
-				if (err) {
-					_log("Put data from queue failed with code: " + str(err), LogLevel::LL_ERROR);
-					goto end_send;
-				}
+			if (err) {
+				_log("Put data from queue failed with code: " + str(err), LogLevel::LL_ERROR);
+				goto end_send;
 			}
 		}
 		if (is_queued_send) {
 			TimeCount("Send queued data");
 		}
 	end_send:
+		// small packets of this iteration go out with one write
+		err = writer.flush();
+		if (err) {
+			_log("Can't send batched packets. Code: " + str(err), LogLevel::LL_ERROR);
+			con_thread->break_connection = true;
+			dev->connection_mutex.unlock();
+			continue;
+		}
 
 		if (!connection->is_connected_to_host()) {
 			_log("Lost connection after sending!", LogLevel::LL_ERROR);
@@ -1092,7 +1772,28 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 				ipsc->compression_type = (ImageCompressionType)pack->get_compression_type();
 				ipsc->size = pack->get_size();
 				ipsc->format = pack->get_format();
+
+				// server times to the client clock
+				int64_t offset = dev->server_clock.get_offset(time64);
+				Dictionary ft;
+				ft["capture"] = (int64_t)pack->get_capture_time() - offset;
+				ft["readback"] = (int64_t)pack->get_readback_time() - offset;
+				ft["encode_start"] = (int64_t)pack->get_encode_start_time() - offset;
+				ft["encode_end"] = (int64_t)pack->get_encode_end_time() - offset;
+				ft["send"] = (int64_t)pack->get_start_time() - offset;
+				ft["receive"] = (int64_t)pack->get_receive_time();
+				// server_clock is owned by this thread, the main thread gets a copy of its state
+				ft["clock_offset"] = offset;
+				ft["clock_drift_ppm"] = dev->server_clock.get_drift_ppm();
+				ft["clock_rtt"] = dev->server_clock.get_rtt();
+				ft["clock_synced"] = dev->server_clock.is_synced();
+				// frames captured before the server got the first batch of this connection
+				// can have the sequence from the previous one
+				ft["input_sequence"] = (int64_t)(pack->get_input_sequence() <= dev->input_sequence ? pack->get_input_sequence() : 0);
+				ipsc->frame_times = ft;
 				ipsc->_is_processing_img = true;
+
+				dev->_update_frame_stats(ipsc->tex_data.size(), pack->get_encode_end_time() - pack->get_encode_start_time());
 			}
 
 			pack.unref();
@@ -1110,23 +1811,25 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 		}
 
 		if (stream_queue.size() > 10) {
+			dev->dropped_frames += stream_queue.size();
 			stream_queue.clear();
 		}
+		dev->stream_queue_size = (int)stream_queue.size();
 
 		// Get some packets
 		TimeCountReset();
 		start_while_time = os->get_ticks_usec();
-		while (ppeer->get_available_packet_count() > 0 && (os->get_ticks_usec() - start_while_time) <= send_data_time_us / 2) {
+		while (dev->_has_incoming_packets(ppeer) && (os->get_ticks_usec() - start_while_time) <= send_data_time_us / 2) {
+			GR_TRACE_SCOPE("receive_packet");
 			nothing_happens = false;
 
-			Variant buf;
-			err = ppeer->get_var(buf);
+			Ref<GRPacket> pack;
+			err = dev->_get_incoming_packet(ppeer, pack);
 
 			if (err) {
 				goto end_recv;
 			}
 
-			Ref<GRPacket> pack = GRPacket::create(buf);
 			if (pack.is_null()) {
 				_log("Incorrect GRPacket", LogLevel::LL_ERROR);
 				continue;
@@ -1142,8 +1845,12 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 						continue;
 					}
 
-					dev->sync_time_client = os->get_ticks_usec();
-					dev->sync_time_server = data->get_time();
+					if (data->get_origin_time()) {
+						dev->server_clock.add_sample(data->get_origin_time(), data->get_receive_time(), data->get_time(), os->get_ticks_usec());
+					} else {
+						uint64_t t = os->get_ticks_usec();
+						dev->server_clock.set_offset((int64_t)data->get_time() - (int64_t)t, t);
+					}
 
 					break;
 				}
@@ -1154,6 +1861,7 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 						continue;
 					}
 
+					data->set_receive_time(os->get_ticks_usec());
 					stream_queue.push_back(data);
 					break;
 				}
@@ -1181,6 +1889,16 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 					dev->call_deferred("emit_signal", "mouse_mode_changed", data->get_mouse_mode());
 					break;
 				}
+				case GRPacket::PacketType::CursorShapeSync: {
+					Ref<GRPacketCursorShapeSync> data = pack;
+					if (data.is_null()) {
+						_log("Incorrect GRPacketCursorShapeSync", LogLevel::LL_ERROR);
+						continue;
+					}
+
+					dev->call_deferred("_update_cursor", data);
+					break;
+				}
 				case GRPacket::PacketType::CustomInputScene: {
 					Ref<GRPacketCustomInputScene> data = pack;
 					if (data.is_null()) {
@@ -1188,9 +1906,127 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 						continue;
 					}
 
+					// server announces the hash first, data is requested only if not cached
+					if (!data->get_scene_path().empty() && data->get_scene_data().size() == 0) {
+						String cached = dev->_get_custom_input_scene_cache_file(data->get_scene_hash());
+						if (cached.empty() || !FileAccess::exists(cached)) {
+							Ref<GRPacketCustomInputSceneRequest> req(memnew(GRPacketCustomInputSceneRequest));
+							req->set_scene_hash(data->get_scene_hash());
+							err = dev->_put_packet(ppeer, req->get_data());
+							if (err) {
+								_log("Send custom input scene request failed with code: " + str(err), LogLevel::LL_ERROR);
+								goto end_recv;
+							}
+							break;
+						}
+					}
+
 					dev->call_deferred("_load_custom_input_scene", data);
 					break;
 				}
+				case GRPacket::PacketType::CustomInputSceneChunk: {
+					Ref<GRPacketCustomInputSceneChunk> data = pack;
+					if (data.is_null()) {
+						_log("Incorrect GRPacketCustomInputSceneChunk", LogLevel::LL_ERROR);
+						continue;
+					}
+
+					if (data->get_total_size() <= 0) {
+						_log("Incorrect custom input scene size: " + str(data->get_total_size()), LogLevel::LL_ERROR);
+						err = Error::ERR_INVALID_DATA;
+					}
+
+					// start a new transfer in preallocated buffer
+					if (!err && data->get_offset() == 0) {
+						scene_chunks_hash = data->get_scene_hash();
+						scene_chunks_received = 0;
+						scene_chunks_data.resize(data->get_total_size());
+					} else if (!err && data->get_offset() != scene_chunks_received) {
+						// chunks come in order, so it is a repeated chunk
+						// or the rest of a dropped transfer
+						if (scene_chunks_hash != data->get_scene_hash() || data->get_offset() < scene_chunks_received) {
+							continue;
+						}
+						_log("Missing custom input scene data before offset " + str(data->get_offset()), LogLevel::LL_ERROR);
+						err = Error::ERR_INVALID_DATA;
+					} else if (!err && scene_chunks_hash != data->get_scene_hash()) {
+						continue;
+					}
+
+					PoolByteArray part;
+					if (!err) {
+						if (data->is_compressed()) {
+							err = decompress_bytes(data->get_scene_data(), data->get_original_size(), part, data->get_compression_type());
+						} else {
+							part = data->get_scene_data();
+						}
+
+						if (err || part.size() == 0 || data->get_offset() + part.size() > scene_chunks_data.size()) {
+							_log("Can't decompress custom input scene chunk. Code: " + str(err), LogLevel::LL_ERROR);
+							err = Error::ERR_INVALID_DATA;
+						}
+					}
+
+					// drop the broken transfer and request the whole pack again
+					if (err) {
+						scene_chunks_hash = "";
+						scene_chunks_data = PoolByteArray();
+						scene_chunks_received = 0;
+
+						if (scene_chunks_failed_hash != data->get_scene_hash()) {
+							scene_chunks_failed_hash = data->get_scene_hash();
+							scene_chunks_retries = 0;
+						}
+						// server restarts the transfer from the first chunk
+						if (scene_chunks_retries >= 3) {
+							err = Error::OK;
+							continue;
+						}
+						scene_chunks_retries++;
+
+						Ref<GRPacketCustomInputSceneRequest> req(memnew(GRPacketCustomInputSceneRequest));
+						req->set_scene_hash(data->get_scene_hash());
+						err = dev->_put_packet(ppeer, req->get_data());
+						if (err) {
+							_log("Send custom input scene request failed with code: " + str(err), LogLevel::LL_ERROR);
+							goto end_recv;
+						}
+						continue;
+					}
+
+					{
+						auto r = part.read();
+						auto w = scene_chunks_data.write();
+						memcpy(w.ptr() + data->get_offset(), r.ptr(), part.size());
+					}
+					// every byte is written once
+					scene_chunks_received = data->get_offset() + part.size();
+					dev->call_deferred("emit_signal", "custom_input_scene_progress", scene_chunks_received, scene_chunks_data.size());
+
+					if (scene_chunks_received == scene_chunks_data.size()) {
+						Ref<GRPacketCustomInputScene> scene(memnew(GRPacketCustomInputScene));
+						scene->set_scene_path(data->get_scene_path());
+						scene->set_scene_hash(scene_chunks_hash);
+						scene->set_scene_data(scene_chunks_data);
+						scene->set_compressed(false);
+
+						dev->call_deferred("_load_custom_input_scene", scene);
+						scene_chunks_hash = "";
+						scene_chunks_data = PoolByteArray();
+						scene_chunks_received = 0;
+					}
+					break;
+				}
+				case GRPacket::PacketType::CustomInputScenePatch: {
+					Ref<GRPacketCustomInputScenePatch> data = pack;
+					if (data.is_null()) {
+						_log("Incorrect GRPacketCustomInputScenePatch", LogLevel::LL_ERROR);
+						continue;
+					}
+
+					dev->call_deferred("_apply_custom_input_scene_patch", data);
+					break;
+				}
 				case GRPacket::PacketType::CustomUserData: {
 					Ref<GRPacketCustomUserData> data = pack;
 					if (data.is_null()) {
@@ -1202,13 +2038,22 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 				}
 				case GRPacket::PacketType::Ping: {
 					Ref<GRPacketPong> ppack(memnew(GRPacketPong));
-					err = ppeer->put_var(ppack->get_data());
+					err = dev->_put_packet(ppeer, ppack->get_data());
 					if ((int)err) {
 						_log("Send pong failed with code: " + str((int)err), LogLevel::LL_NORMAL);
 						break;
 					}
 					break;
 				}
+				case GRPacket::PacketType::BulkData:
+				case GRPacket::PacketType::BulkDataAck: {
+					err = dev->_bulk_receive(pack);
+					if (err) {
+						_log("Incorrect bulk data packet", LogLevel::LL_ERROR);
+						err = Error::OK;
+					}
+					break;
+				}
 				case GRPacket::PacketType::Pong: {
 					dev->_update_avg_ping(os->get_ticks_usec() - prev_ping_sending_time);
 					ping_sended = false;
@@ -1235,9 +2080,12 @@ void GRClient::_connection_loop(ConnectionThreadParamsClient *con_thread) {
 		prev_cycle_time = os->get_ticks_usec() - cycle_start_time;
 	}
 
-	dev->_send_queue_resize(0);
+	dev->_send_queue_clear();
+	dev->recv_batch.clear();
+	dev->_bulk_reset();
 
 	stream_queue.clear();
+	dev->stream_queue_size = 0;
 
 	if (connection->is_connected_to_host()) {
 		_log("Lost connection to " + address, LogLevel::LL_ERROR);
@@ -1258,6 +2106,8 @@ void GRClient::_thread_image_decoder(THREAD_DATA p_userdata) {
 	ImgProcessingStorageClient *ipsc = (ImgProcessingStorageClient *)p_userdata;
 	GRClient *dev = ipsc->dev;
 	Error err = Error::OK;
+	GRUtils::trace_set_thread_name("decoder");
+	GR_THREAD_CPU_SCOPE("client_decoder");
 
 	while (!ipsc->_thread_closing) {
 		if (!ipsc->_is_processing_img) {
@@ -1267,6 +2117,9 @@ void GRClient::_thread_image_decoder(THREAD_DATA p_userdata) {
 
 		Ref<Image> img(memnew(Image));
 		ImageCompressionType type = ipsc->compression_type;
+		Dictionary frame_times = ipsc->frame_times;
+		frame_times["decode_start"] = (int64_t)OS::get_singleton()->get_ticks_usec();
+		GR_TRACE_SCOPE("decode");
 
  		TimeCountInit();
  		switch (type) {
@@ -1299,7 +2152,8 @@ void GRClient::_thread_image_decoder(THREAD_DATA p_userdata) {
 
 		if (!err) { // is OK
 			TimeCount("Create Image Time");
-			dev->call_deferred("_update_texture_from_image", img);
+			frame_times["decode_end"] = (int64_t)OS::get_singleton()->get_ticks_usec();
+			dev->call_deferred("_present_stream_frame", img, frame_times);
 
 			if (dev->signal_connection_state != StreamState::STREAM_ACTIVE) {
 				dev->call_deferred("_update_stream_texture_state", StreamState::STREAM_ACTIVE);
@@ -1398,7 +2252,11 @@ timeout:
 void GRInputCollector::_update_stream_rect() {
 	if (!dev || dev->get_status() != GRDevice::WorkingStatus::STATUS_WORKING)
 		return;
+	// cleared before the rect is read, so an invalidation in the meantime is not lost
+	if (!stream_rect_dirty.exchange(false))
+		return;
 
+	Rect2 rect = stream_rect;
 	if (texture_rect && !texture_rect->is_queued_for_deletion()) {
 		switch (dev->get_stretch_mode()) {
 			case GRClient::StretchMode::STRETCH_KEEP_ASPECT: {
@@ -1414,35 +2272,130 @@ void GRInputCollector::_update_stream_rect() {
 
 				if (asp_rec > asp_tex) {
 					float width = outer_size.y * asp_tex;
-					stream_rect = Rect2(Vector2(pos.x + (outer_size.x - width) / 2, pos.y), Vector2(width, outer_size.y));
-					return;
+					rect = Rect2(Vector2(pos.x + (outer_size.x - width) / 2, pos.y), Vector2(width, outer_size.y));
 				} else {
 					float height = outer_size.x / asp_tex;
-					stream_rect = Rect2(Vector2(pos.x, pos.y + (outer_size.y - height) / 2), Vector2(outer_size.x, height));
-					return;
+					rect = Rect2(Vector2(pos.x, pos.y + (outer_size.y - height) / 2), Vector2(outer_size.x, height));
 				}
 				break;
 			}
 			case GRClient::StretchMode::STRETCH_FILL:
 			default:
 			fill:
-				stream_rect = Rect2(texture_rect->get_global_position(), texture_rect->get_size());
-				return;
+				rect = Rect2(texture_rect->get_global_position(), texture_rect->get_size());
+				break;
 		}
+	} else if (parent && !parent->is_queued_for_deletion()) {
+		rect = Rect2(parent->get_global_position(), parent->get_size());
 	}
-	if (parent && !parent->is_queued_for_deletion()) {
-		stream_rect = Rect2(parent->get_global_position(), parent->get_size());
+
+	_THREAD_SAFE_LOCK_;
+	// pending motion is normalized with the rect it was collected in
+	_flush_pending_motion();
+	stream_rect = rect;
+	collected_input_batch.set_stream_rect(rect);
+	_THREAD_SAFE_UNLOCK_;
+}
+
+void GRInputCollector::_invalidate_stream_rect() {
+	stream_rect_dirty = true;
+}
+
+std::pair<int, int> GRInputCollector::_get_pointer_key(const Ref<InputEvent> &ie) {
+	Ref<InputEventScreenDrag> iesd = ie;
+	return std::make_pair(ie->get_device(), iesd.is_valid() ? iesd->get_index() : -1);
+}
+
+bool GRInputCollector::_merge_motion(const Ref<InputEvent> &ie, uint64_t time) {
+	// merge with the last pending event of the same pointer.
+	// any other event flushes pending motion, so nothing of this pointer is skipped
+	auto idx = pending_motion_index.find(_get_pointer_key(ie));
+	if (idx == pending_motion_index.end())
+		return false;
+	PendingMotion &last = pending_motion[idx->second];
+
+	{
+		Ref<InputEventMouseMotion> iemm = ie;
+		if (iemm.is_valid()) {
+			Ref<InputEventMouseMotion> prev = last.event;
+			if (prev.is_null() || prev->get_device() != iemm->get_device())
+				return false;
+
+			if (prev->get_button_mask() != iemm->get_button_mask() ||
+					prev->get_alt() != iemm->get_alt() || prev->get_shift() != iemm->get_shift() ||
+					prev->get_control() != iemm->get_control() || prev->get_metakey() != iemm->get_metakey() ||
+					prev->get_command() != iemm->get_command())
+				return false;
+
+			prev->set_position(iemm->get_position());
+			prev->set_global_position(iemm->get_global_position());
+			prev->set_relative(prev->get_relative() + iemm->get_relative());
+			prev->set_speed(iemm->get_speed());
+			prev->set_pressure(iemm->get_pressure());
+			prev->set_tilt(iemm->get_tilt());
+			last.time = time;
+			return true;
+		}
 	}
-	return;
+
+	{
+		Ref<InputEventScreenDrag> iesd = ie;
+		if (iesd.is_valid()) {
+			Ref<InputEventScreenDrag> prev = last.event;
+			if (prev.is_null() || prev->get_device() != iesd->get_device() || prev->get_index() != iesd->get_index())
+				return false;
+
+			prev->set_position(iesd->get_position());
+			prev->set_relative(prev->get_relative() + iesd->get_relative());
+			prev->set_speed(iesd->get_speed());
+			last.time = time;
+			return true;
+		}
+	}
+	return false;
+}
+
+void GRInputCollector::_flush_pending_motion() {
+	for (int i = 0; i < (int)pending_motion.size(); i++) {
+		collected_input_batch.write_event(pending_motion[i].event, pending_motion[i].time);
+	}
+	pending_motion.clear();
+	pending_motion_index.clear();
 }
 
 void GRInputCollector::_collect_input(Ref<InputEvent> ie) {
-	Ref<GRInputDataEvent> data = GRInputDataEvent::parse_event(ie, stream_rect);
-	if (data.is_valid()) {
-		_THREAD_SAFE_LOCK_;
-		collected_input_data.push_back(data);
-		_THREAD_SAFE_UNLOCK_;
+	uint64_t time = OS::get_singleton()->get_ticks_usec();
+
+	_THREAD_SAFE_LOCK_;
+	if (!first_event_time) {
+		first_event_time = time;
+	}
+	if (cast_to<InputEventMouseMotion>(*ie) || cast_to<InputEventScreenDrag>(*ie)) {
+		if (!_merge_motion(ie, time)) {
+			// copy, because the same event can be used by other nodes
+			PendingMotion pm;
+			pm.event = ie->duplicate();
+			pm.time = time;
+			pending_motion.push_back(pm);
+			pending_motion_index[_get_pointer_key(ie)] = (int)pending_motion.size() - 1;
+		}
+		if (!unsent_input_time) {
+			unsent_input_time = time;
+		}
+	} else {
+		// keep order of events
+		_flush_pending_motion();
+		collected_input_batch.write_event(ie, time);
+
+		if (cast_to<InputEventMouseButton>(*ie) || cast_to<InputEventScreenTouch>(*ie) ||
+				cast_to<InputEventKey>(*ie) || cast_to<InputEventJoypadButton>(*ie) ||
+				cast_to<InputEventAction>(*ie) || cast_to<InputEventMIDI>(*ie)) {
+			has_urgent_input = true;
+		} else if (!unsent_input_time) {
+			unsent_input_time = time;
+		}
 	}
+	_THREAD_SAFE_UNLOCK_;
 }
 
 void GRInputCollector::_release_pointers() {
@@ -1477,6 +2430,7 @@ void GRInputCollector::_release_pointers() {
 
 void GRInputCollector::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("_input", "input_event"), &GRInputCollector::_input);
+	ClassDB::bind_method(D_METHOD("_invalidate_stream_rect"), &GRInputCollector::_invalidate_stream_rect);
 
 	ClassDB::bind_method(D_METHOD("is_capture_on_focus"), &GRInputCollector::is_capture_on_focus);
 	ClassDB::bind_method(D_METHOD("set_capture_on_focus", "value"), &GRInputCollector::set_capture_on_focus);
@@ -1497,13 +2451,7 @@ void GRInputCollector::_input(Ref<InputEvent> ie) {
 		return;
 	}
 
-	_THREAD_SAFE_LOCK_;
-	if (collected_input_data.size() >= 256) {
-		collected_input_data.resize(0);
-	}
-	_THREAD_SAFE_UNLOCK_;
-
-	// TODO maybe later i will change it to update less frequent
+	// recalculated only after resize, texture or stretch mode changes
 	_update_stream_rect();
 
 	if (ie.is_null()) {
@@ -1596,21 +2544,52 @@ void GRInputCollector::_notification(int p_notification) {
 			break;
 		case NOTIFICATION_ENTER_TREE: {
 			parent = cast_to<Control>(get_parent());
+			if (parent) {
+				parent->connect("item_rect_changed", this, "_invalidate_stream_rect");
+			}
+			get_viewport()->connect("size_changed", this, "_invalidate_stream_rect");
+			stream_rect_dirty = true;
 			break;
 		}
 		case NOTIFICATION_EXIT_TREE: {
+			if (parent && parent->is_connected("item_rect_changed", this, "_invalidate_stream_rect")) {
+				parent->disconnect("item_rect_changed", this, "_invalidate_stream_rect");
+			}
+			if (get_viewport()->is_connected("size_changed", this, "_invalidate_stream_rect")) {
+				get_viewport()->disconnect("size_changed", this, "_invalidate_stream_rect");
+			}
 			parent = nullptr;
 			break;
 		}
 		case NOTIFICATION_PROCESS: {
-			_THREAD_SAFE_LOCK_;
-			auto w = sensors.write();
-			w[0] = Input::get_singleton()->get_accelerometer();
-			w[1] = Input::get_singleton()->get_gravity();
-			w[2] = Input::get_singleton()->get_gyroscope();
-			w[3] = Input::get_singleton()->get_magnetometer();
-			w.release();
-			_THREAD_SAFE_UNLOCK_;
+			Input *input = Input::get_singleton();
+			Vector3 s[4] = {
+				input->get_accelerometer(),
+				input->get_gravity(),
+				input->get_gyroscope(),
+				input->get_magnetometer(),
+			};
+
+			// send sensors only when something noticeably changed
+			// and sometimes just to keep server values in sync.
+			// each sample keeps its time, but Input has only the latest values,
+			// so sensors are sampled not faster than the client frame rate
+			uint64_t time = OS::get_singleton()->get_ticks_usec();
+			bool changed = !sent_sensors_time || time - sent_sensors_time > 1000_ms;
+			// sensors have different units, so each one has its own threshold
+			for (int i = 0; i < 4 && !changed; i++) {
+				changed = (s[i] - sent_sensors[i]).length() > (dev ? dev->get_sensor_threshold((GRClient::SensorType)i) : 0.f);
+			}
+
+			if (changed) {
+				_THREAD_SAFE_LOCK_;
+				collected_input_batch.write_sensors(s, time);
+				_THREAD_SAFE_UNLOCK_;
+				for (int i = 0; i < 4; i++) {
+					sent_sensors[i] = s[i];
+				}
+				sent_sensors_time = time;
+			}
 			break;
 		}
 	}
@@ -1652,19 +2631,37 @@ void GRInputCollector::set_capture_input(bool value) {
 }
 
 void GRInputCollector::set_tex_rect(TextureRect *tr) {
+	if (texture_rect && texture_rect->is_connected("item_rect_changed", this, "_invalidate_stream_rect")) {
+		texture_rect->disconnect("item_rect_changed", this, "_invalidate_stream_rect");
+	}
 	texture_rect = tr;
+	if (texture_rect) {
+		texture_rect->connect("item_rect_changed", this, "_invalidate_stream_rect");
+	}
+	stream_rect_dirty = true;
 }
 
-Ref<GRPacketInputData> GRInputCollector::get_collected_input_data() {
+bool GRInputCollector::is_input_flush_required(uint64_t time, uint64_t coalescing_window) {
+	_THREAD_SAFE_LOCK_;
+	bool res = has_urgent_input || (unsent_input_time && time >= unsent_input_time + coalescing_window);
+	_THREAD_SAFE_UNLOCK_;
+	return res;
+}
+
+Ref<GRPacketInputData> GRInputCollector::get_collected_input_data(uint64_t *r_first_event_time) {
 	Ref<GRPacketInputData> res(memnew(GRPacketInputData));
-	Ref<GRInputDeviceSensorsData> s(memnew(GRInputDeviceSensorsData));
 
 	_THREAD_SAFE_LOCK_;
 
-	s->set_sensors(sensors);
-	collected_input_data.push_back(s);
-	res->set_input_data(collected_input_data);
-	collected_input_data.resize(0);
+	_flush_pending_motion();
+	res->set_input_batch(collected_input_batch.get_data(), collected_input_batch.get_count());
+	collected_input_batch.clear();
+	if (r_first_event_time) {
+		*r_first_event_time = first_event_time;
+	}
+	first_event_time = 0;
+	unsent_input_time = 0;
+	has_urgent_input = false;
 
 	_THREAD_SAFE_UNLOCK_;
 	return res;
@@ -1675,14 +2672,15 @@ void GRInputCollector::_init() {
 	parent = nullptr;
 	set_process(true);
 	set_process_input(true);
-	sensors.resize(4);
 	_THREAD_SAFE_UNLOCK_;
 }
 
 void GRInputCollector::_deinit() {
 	_THREAD_SAFE_LOCK_;
-	sensors.resize(0);
-	collected_input_data.resize(0);
+	sent_sensors_time = 0;
+	collected_input_batch.clear();
+	pending_motion.clear();
+	pending_motion_index.clear();
 	if (this_in_client)
 		*this_in_client = nullptr;
 	mouse_buttons.clear();
@@ -1702,6 +2700,14 @@ void GRTextureRect::_tex_size_changed() {
 			dev->no_signal_is_vertical = is_vertical;
 			dev->_update_stream_texture_state(dev->signal_connection_state); // update texture
 		}
+
+		// cursors are scaled like the stream
+		if (dev->stream_hovered) {
+			if (dev->input_collector) {
+				dev->input_collector->_invalidate_stream_rect();
+			}
+			dev->_apply_custom_cursors();
+		}
 	}
 }
 
@@ -1718,12 +2724,30 @@ void GRTextureRect::_notification(int p_notification) {
 		case NOTIFICATION_PREDELETE:
 			_deinit();
 			break;
+		case NOTIFICATION_MOUSE_ENTER:
+			if (dev) {
+				dev->_set_stream_hovered(true);
+			}
+			break;
+		case NOTIFICATION_MOUSE_EXIT:
+		case NOTIFICATION_EXIT_TREE:
+			if (dev) {
+				dev->_set_stream_hovered(false);
+			}
+			break;
+		// item_rect_changed is not emitted when parents move or scale
+		case NOTIFICATION_TRANSFORM_CHANGED:
+			if (dev && dev->input_collector) {
+				dev->input_collector->_invalidate_stream_rect();
+			}
+			break;
 	}
 }
 
 void GRTextureRect::_init() {
 	LEAVE_IF_EDITOR();
 	connect("resized", this, "_tex_size_changed");
+	set_notify_transform(true);
 }
 
 void GRTextureRect::_deinit() {
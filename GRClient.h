@@ -4,6 +4,8 @@
 #ifndef NO_GODOTREMOTE_CLIENT
 #define NO_GODOTREMOTE_CLIENT
 
+#include <deque>
+
 #include "GRDevice.h"
 #include "core/os/thread_safe.h"
 #include "core/io/ip_address.h"
@@ -39,6 +41,14 @@ public:
 		STREAM_NO_IMAGE = 2,
 	};
 
+	enum SensorType {
+		SENSOR_ACCELEROMETER = 0,
+		SENSOR_GRAVITY = 1,
+		SENSOR_GYROSCOPE = 2,
+		SENSOR_MAGNETOMETER = 3,
+		SENSOR_MAX,
+	};
+
 private:
 
 	class ImgProcessingStorageClient : public Object {
@@ -51,6 +61,7 @@ private:
 		int format = 0;
 		ImageCompressionType compression_type = ImageCompressionType::COMPRESSION_UNCOMPRESSED;
 		Size2 size;
+		Dictionary frame_times; // stage times of the frame in the client clock
 		bool _is_processing_img = false;
  		bool _thread_closing = false;
 
@@ -102,7 +113,7 @@ private:
 
 private:
 	bool is_deleting = false;
-	bool is_connection_working = false;
+	std::atomic<bool> is_connection_working = { false }; // also read by the metrics thread
 	Node *settings_menu_node = nullptr;
 	class Control *control_to_show_in = nullptr;
 	class GRTextureRect *tex_shows_stream = nullptr;
@@ -125,9 +136,23 @@ private:
 	ConnectionType con_type = ConnectionType::CONNECTION_WiFi;
 	int input_buffer_size_in_mb = 4;
 	int send_data_fps = 60;
-
-	uint64_t sync_time_client = 0;
-	uint64_t sync_time_server = 0;
+	int input_coalescing_window_ms = 4;
+	// in units of each sensor: m/s^2, m/s^2, rad/s and microtesla
+	float sensors_threshold[SENSOR_MAX] = { 0.05f, 0.05f, 0.01f, 0.5f };
+
+	// used only by the connection thread. its state is copied to the frame times for the main thread
+	GRUtils::clock_sync server_clock;
+	uint32_t input_sequence = 0;
+
+	// input-to-display latency. times of the first event of each sent batch
+	// wait here until a frame with the same or newer input sequence is shown
+	Mutex input_latency_mutex;
+	std::deque<std::pair<uint32_t, uint64_t> > pending_input_times;
+	GRUtils::latency_histogram input_latency_histogram;
+	// capture on the server to present here. only while the clocks are synced
+	GRUtils::latency_histogram frame_latency_histogram;
+	// received frames waiting for the decoder
+	std::atomic<int> stream_queue_size = { 0 };
 
 	// NO SIGNAL screen
 	uint64_t prev_valid_connection_time = 0;
@@ -145,15 +170,44 @@ private:
 
 	Node *custom_input_scene = nullptr;
 	String custom_input_scene_tmp_pck_file = "user://custom_input_scene.pck";
+	// unpacked scenes by content hash, least recently used are removed first
+	String custom_input_scene_cache_dir = "user://godot_remote_cache";
+	int custom_input_scene_cache_size_in_mb = 32;
+	String custom_input_scene_hash; // hash of the loaded pack
+	std::vector<String> custom_input_scene_patch_files;
+	// files of the loaded pack and its patches. used to cache patched packs
+	std::vector<String> custom_input_scene_files;
+
+	// cursor received from the server. Input is changed only while the pointer is over the stream
+	struct CustomCursor {
+		Ref<Image> image;
+		Vector2 hotspot;
+	};
+	Input::CursorShape cursor_shape = Input::CURSOR_ARROW;
+	std::map<int, CustomCursor> custom_cursors;
+	Size2 cursor_screen_size;
+	uint32_t custom_cursor_shapes = 0; // bit per Input::CursorShape set to Input
+	bool stream_hovered = false;
 
 	void _force_update_stream_viewport_signals();
 	void _load_custom_input_scene(Ref<class GRPacketCustomInputScene> _data);
 	void _remove_custom_input_scene();
+	void _apply_custom_input_scene_patch(Ref<class GRPacketCustomInputScenePatch> _data);
+	String _get_custom_input_scene_cache_file(const String &_hash);
+	void _update_custom_input_scene_cache(const String &_hash, int _size);
+	void _store_patched_custom_input_scene(Ref<class GRPacketCustomInputScenePatch> _data);
+	void _update_cursor(Ref<class GRPacketCursorShapeSync> _data);
+	void _reset_cursor();
+	void _apply_custom_cursor(int shape);
+	void _apply_custom_cursors();
+	void _set_stream_hovered(bool _hovered);
 	void _viewport_size_changed();
 	void _on_node_deleting(int var_name);
 	void _update_texture_from_image(Ref<Image> img);
+	void _present_stream_frame(Ref<Image> img, Dictionary frame_times);
 	void _update_stream_texture_state(StreamState _stream_state);
 	virtual void _reset_counters() override;
+	virtual void _write_metrics(class GRMetricsWriter &w) override;
 
 	THREAD_FUNC void _thread_connection(THREAD_DATA p_userdata);
 	THREAD_FUNC void _thread_image_decoder(THREAD_DATA p_userdata);
@@ -186,6 +240,10 @@ public:
 	ConnectionType get_connection_type();
 	void set_target_send_fps(int fps);
 	int get_target_send_fps();
+	void set_input_coalescing_window(int ms);
+	int get_input_coalescing_window();
+	void set_sensor_threshold(SensorType sensor, float threshold);
+	float get_sensor_threshold(SensorType sensor);
 	void set_stretch_mode(StretchMode stretch);
 	StretchMode get_stretch_mode();
 	void set_texture_filtering(bool is_filtering);
@@ -210,10 +268,17 @@ public:
 	bool set_address(String ip);
 	bool set_address_port(String ip, uint16_t _port);
 	void set_input_buffer(int mb);
+	void set_custom_input_scene_cache_size(int mb);
+	int get_custom_input_scene_cache_size();
 
 	void set_server_setting(TypesOfServerSettings param, Variant value);
 	void disable_overriding_server_settings();
 
+	Dictionary get_input_latency_histogram();
+	void reset_input_latency_histogram();
+	virtual Dictionary get_stats() override;
+	virtual void reset_stats() override;
+
 	void _init();
 	void _deinit();
 };
@@ -221,6 +286,7 @@ public:
 class GRInputCollector : public Node {
 	GDCLASS(GRInputCollector, Node);
 	friend GRClient;
+	friend class GRTextureRect;
 
 	_THREAD_SAFE_CLASS_;
 
@@ -229,21 +295,40 @@ private:
 	GRInputCollector **this_in_client = nullptr; //somebody help
 
 	class TextureRect *texture_rect = nullptr;
-	std::vector<Ref<GRInputData> > collected_input_data;
+	GRInputBatchWriter collected_input_batch;
+	struct PendingMotion {
+		Ref<InputEvent> event;
+		uint64_t time = 0;
+	};
+
+	// motion and drag events waiting to be merged with the next ones
+	std::vector<PendingMotion> pending_motion;
+	// last pending event of each pointer: (device, touch index or -1 for mouse)
+	std::map<std::pair<int, int>, int> pending_motion_index;
+	uint64_t unsent_input_time = 0;
+	uint64_t first_event_time = 0; // sensors are not counted
+	bool has_urgent_input = false;
 	class Control *parent;
 	bool capture_only_when_control_in_focus = false;
 	bool capture_pointer_only_when_hover_control = true;
 	bool dont_capture_pointer = false;
 
 	Rect2 stream_rect;
-	PoolVector3Array sensors;
+	std::atomic<bool> stream_rect_dirty = { true }; // also set by the stream thread
+	// last sensors values added to the batch
+	Vector3 sent_sensors[4];
+	uint64_t sent_sensors_time = 0;
 
 	Dictionary mouse_buttons;
 	Dictionary screen_touches;
 
 protected:
 	void _collect_input(Ref<InputEvent> ie);
+	static std::pair<int, int> _get_pointer_key(const Ref<InputEvent> &ie);
+	bool _merge_motion(const Ref<InputEvent> &ie, uint64_t time);
+	void _flush_pending_motion();
 	void _update_stream_rect();
+	void _invalidate_stream_rect();
 	void _release_pointers();
 
 	static void _bind_methods();
@@ -263,7 +348,8 @@ public:
 
 	void set_tex_rect(class TextureRect *tr);
 
-	Ref<class GRPacketInputData> get_collected_input_data();
+	bool is_input_flush_required(uint64_t time, uint64_t coalescing_window);
+	Ref<class GRPacketInputData> get_collected_input_data(uint64_t *r_first_event_time = nullptr);
 
 	void _init();
 	void _deinit();
@@ -293,5 +379,6 @@ public:
 VARIANT_ENUM_CAST(GRClient::ConnectionType)
 VARIANT_ENUM_CAST(GRClient::StretchMode)
 VARIANT_ENUM_CAST(GRClient::StreamState)
+VARIANT_ENUM_CAST(GRClient::SensorType)
 
 #endif // !NO_GODOTREMOTE_CLIENT
@@ -1,9 +1,79 @@
 /* GRDevice.cpp */
 #include "GRDevice.h"
+#include "GRMetrics.h"
 #include "GodotRemote.h"
 
 using namespace GRUtils;
 
+//////////////////////////////////////////////////////////////////////////
+// PACKET WRITER
+
+GRPacketWriter::GRPacketWriter(const Ref<PacketPeerStream> &_ppeer, GRUtils::traffic_counters *_counters) {
+	ppeer = _ppeer;
+	counters = _counters;
+	batch.instance();
+}
+
+bool GRPacketWriter::_is_latency_critical(GRPacket::PacketType type) {
+	switch (type) {
+		case GRPacket::PacketType::SyncTime:
+		case GRPacket::PacketType::InputData:
+		case GRPacket::PacketType::Ping:
+		case GRPacket::PacketType::Pong:
+			return true;
+		default:
+			return false;
+	}
+}
+
+Error GRPacketWriter::put(const PoolByteArray &data) {
+	ERR_FAIL_COND_V(data.size() == 0, Error::ERR_INVALID_PARAMETER);
+	Error err = Error::OK;
+	uint8_t type = data.read()[0];
+
+	if (counters)
+		counters->add(type, data.size());
+
+	// keep the order of packets
+	if (data.size() > max_batched_packet_size) {
+		err = flush();
+		if (err)
+			return err;
+		return ppeer->put_var(data);
+	}
+
+	if (batch_size + data.size() > max_batch_size) {
+		err = flush();
+		if (err)
+			return err;
+	}
+
+	batch->add_packet(data);
+	batch_size += data.size();
+
+	if (_is_latency_critical((GRPacket::PacketType)type)) {
+		return flush();
+	}
+	return err;
+}
+
+Error GRPacketWriter::flush() {
+	Error err = Error::OK;
+	int count = batch->get_packets_count();
+	if (count == 1) {
+		err = ppeer->put_var(batch->get_packet_data(0));
+	} else if (count > 1) {
+		err = ppeer->put_var(batch->get_data());
+	}
+
+	batch->clear();
+	batch_size = 0;
+	return err;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// DEVICE
+
 void GRDevice::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("_internal_call_only_deffered_start"), &GRDevice::_internal_call_only_deffered_start);
 	ClassDB::bind_method(D_METHOD("_internal_call_only_deffered_stop"), &GRDevice::_internal_call_only_deffered_stop);
@@ -17,18 +87,55 @@ void GRDevice::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_min_fps"), &GRDevice::get_min_fps);
 	ClassDB::bind_method(D_METHOD("get_max_fps"), &GRDevice::get_max_fps);
 
+	ClassDB::bind_method(D_METHOD("get_latency_breakdown"), &GRDevice::get_latency_breakdown);
+	ClassDB::bind_method(D_METHOD("get_stats"), &GRDevice::get_stats);
+	ClassDB::bind_method(D_METHOD("reset_stats"), &GRDevice::reset_stats);
+
 	ClassDB::bind_method(D_METHOD("get_port"), &GRDevice::get_port);
 	ClassDB::bind_method(D_METHOD("set_port", "port"), &GRDevice::set_port, DEFVAL(51341));
 
-	ClassDB::bind_method(D_METHOD("send_user_data", "packet_id", "user_data", "full_objects"), &GRDevice::send_user_data, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("send_user_data", "packet_id", "user_data", "full_objects", "compression_type", "priority"), &GRDevice::send_user_data, DEFVAL(false), DEFVAL(-1), DEFVAL(SendPriority::PRIORITY_NORMAL));
+	ClassDB::bind_method(D_METHOD("get_send_queue_size"), &GRDevice::get_send_queue_size);
+	ClassDB::bind_method(D_METHOD("set_send_queue_high_water_mark", "count"), &GRDevice::set_send_queue_high_water_mark);
+	ClassDB::bind_method(D_METHOD("get_send_queue_high_water_mark"), &GRDevice::get_send_queue_high_water_mark);
+	ClassDB::bind_method(D_METHOD("open_bulk_channel", "name", "total_size"), &GRDevice::open_bulk_channel, DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("write_bulk_channel", "channel", "data"), &GRDevice::write_bulk_channel);
+	ClassDB::bind_method(D_METHOD("close_bulk_channel", "channel"), &GRDevice::close_bulk_channel);
+	ClassDB::bind_method(D_METHOD("cancel_bulk_channel", "channel"), &GRDevice::cancel_bulk_channel);
+	ClassDB::bind_method(D_METHOD("get_bulk_channel_writable_size", "channel"), &GRDevice::get_bulk_channel_writable_size);
+	ClassDB::bind_method(D_METHOD("read_bulk_channel", "channel", "max_size"), &GRDevice::read_bulk_channel, DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("get_bulk_channel_available_size", "channel"), &GRDevice::get_bulk_channel_available_size);
+	ClassDB::bind_method(D_METHOD("set_bulk_window_size", "size"), &GRDevice::set_bulk_window_size);
+	ClassDB::bind_method(D_METHOD("get_bulk_window_size"), &GRDevice::get_bulk_window_size);
+	ClassDB::bind_method(D_METHOD("set_bulk_writable_low_water", "size"), &GRDevice::set_bulk_writable_low_water);
+	ClassDB::bind_method(D_METHOD("get_bulk_writable_low_water"), &GRDevice::get_bulk_writable_low_water);
+	ClassDB::bind_method(D_METHOD("set_bulk_bandwidth_limit", "bytes_per_sec"), &GRDevice::set_bulk_bandwidth_limit);
+	ClassDB::bind_method(D_METHOD("get_bulk_bandwidth_limit"), &GRDevice::get_bulk_bandwidth_limit);
+
 	ClassDB::bind_method(D_METHOD("start"), &GRDevice::start);
 	ClassDB::bind_method(D_METHOD("stop"), &GRDevice::stop);
 	ClassDB::bind_method(D_METHOD("get_status"), &GRDevice::get_status);
 
 	ADD_SIGNAL(MethodInfo("status_changed", PropertyInfo(Variant::INT, "status")));
 	ADD_SIGNAL(MethodInfo("user_data_received", PropertyInfo(Variant::NIL, "packet_id"), PropertyInfo(Variant::NIL, "user_data")));
+	ADD_SIGNAL(MethodInfo("send_queue_overflowed"));
+	ADD_SIGNAL(MethodInfo("send_queue_drained"));
+
+	// sender side
+	ADD_SIGNAL(MethodInfo("bulk_progress", PropertyInfo(Variant::INT, "channel"), PropertyInfo(Variant::INT, "delivered"), PropertyInfo(Variant::INT, "total")));
+	ADD_SIGNAL(MethodInfo("bulk_writable", PropertyInfo(Variant::INT, "channel")));
+	ADD_SIGNAL(MethodInfo("bulk_completed", PropertyInfo(Variant::INT, "channel"), PropertyInfo(Variant::BOOL, "success")));
+	// receiver side
+	ADD_SIGNAL(MethodInfo("bulk_channel_opened", PropertyInfo(Variant::INT, "channel"), PropertyInfo(Variant::STRING, "name"), PropertyInfo(Variant::INT, "total_size")));
+	// data must be taken with read_bulk_channel, only read data frees the sender's window
+	ADD_SIGNAL(MethodInfo("bulk_data_available", PropertyInfo(Variant::INT, "channel"), PropertyInfo(Variant::INT, "available")));
+	ADD_SIGNAL(MethodInfo("bulk_channel_closed", PropertyInfo(Variant::INT, "channel"), PropertyInfo(Variant::BOOL, "completed")));
 
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "port"), "set_port", "get_port");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "send_queue_high_water_mark", PROPERTY_HINT_RANGE, "1,1000000"), "set_send_queue_high_water_mark", "get_send_queue_high_water_mark");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "bulk_window_size", PROPERTY_HINT_RANGE, "1024,67108864"), "set_bulk_window_size", "get_bulk_window_size");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "bulk_writable_low_water", PROPERTY_HINT_RANGE, "1,67108864"), "set_bulk_writable_low_water", "get_bulk_writable_low_water");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "bulk_bandwidth_limit"), "set_bulk_bandwidth_limit", "get_bulk_bandwidth_limit");
 
 	BIND_ENUM_CONSTANT(STATUS_STARTING);
 	BIND_ENUM_CONSTANT(STATUS_STOPPING);
@@ -47,6 +154,10 @@ void GRDevice::_bind_methods() {
 	BIND_ENUM_CONSTANT(SUBSAMPLING_H2V1);
 	BIND_ENUM_CONSTANT(SUBSAMPLING_H2V2);
 
+	BIND_ENUM_CONSTANT(PRIORITY_HIGH);
+	BIND_ENUM_CONSTANT(PRIORITY_NORMAL);
+	BIND_ENUM_CONSTANT(PRIORITY_LOW);
+
 	BIND_ENUM_CONSTANT(COMPRESSION_UNCOMPRESSED);
 	BIND_ENUM_CONSTANT(COMPRESSION_JPG);
 	BIND_ENUM_CONSTANT(COMPRESSION_PNG);
@@ -64,19 +175,46 @@ void GRDevice::_notification(int p_notification) {
 }
 
 void GRDevice::_reset_counters() {
+	window_stats_mutex.lock();
 	avg_fps = min_fps = max_fps = 0;
 	avg_ping = min_ping = max_ping = 0;
-	fps_queue = ping_queue = iterable_queue<uint64_t>();
+	frametime_stats.clear();
+	ping_stats.clear();
+	frame_size_stats.clear();
+	encode_time_stats.clear();
+	window_stats_mutex.unlock();
+	_set_latency_breakdown(Dictionary());
 }
 
 void GRDevice::_update_avg_ping(uint64_t ping) {
-	ping_queue.add_value_limited(ping, avg_ping_max_count);
- 	calculate_avg_min_max_values(ping_queue, &avg_ping, &min_ping, &max_ping, &GRDevice::_ping_calc_modifier);
+	window_stats_mutex.lock();
+	ping_stats.add(ping, avg_ping_max_count);
+	ping_total_count++;
+	ping_total_sum += ping;
+	avg_ping = _ping_calc_modifier(ping_stats.get_avg());
+	min_ping = _ping_calc_modifier((double)ping_stats.get_min());
+	max_ping = _ping_calc_modifier((double)ping_stats.get_max());
+	window_stats_mutex.unlock();
 }
 
 void GRDevice::_update_avg_fps(uint64_t frametime) {
-	fps_queue.add_value_limited(frametime, (int)round(Engine::get_singleton()->get_frames_per_second()));
-	calculate_avg_min_max_values(fps_queue, &avg_fps, &min_fps, &max_fps, &GRDevice::_fps_calc_modifier);
+	// about one second of frames
+	int limit = (int)round(Engine::get_singleton()->get_frames_per_second());
+
+	window_stats_mutex.lock();
+	frametime_stats.add(frametime, limit > 0 ? limit : 1);
+	avg_fps = _fps_calc_modifier(frametime_stats.get_avg());
+	// longest frame is the lowest fps
+	min_fps = _fps_calc_modifier((double)frametime_stats.get_max());
+	max_fps = _fps_calc_modifier((double)frametime_stats.get_min());
+	window_stats_mutex.unlock();
+}
+
+void GRDevice::_update_frame_stats(uint64_t size, uint64_t encode_time) {
+	window_stats_mutex.lock();
+	frame_size_stats.add(size, frame_stats_max_count);
+	encode_time_stats.add(encode_time, frame_stats_max_count);
+	window_stats_mutex.unlock();
 }
 
 float GRDevice::_ping_calc_modifier(double i) {
@@ -90,35 +228,692 @@ float GRDevice::_ping_calc_modifier(double i) {
 		return 0;
 }
 
-void GRDevice::send_user_data(Variant packet_id, Variant user_data, bool full_objects) {
-	send_queue_mutex.lock();
+Error GRDevice::send_user_data(Variant packet_id, Variant user_data, bool full_objects, int compression_type, SendPriority priority) {
 	Ref<GRPacketCustomUserData> packet = newref(GRPacketCustomUserData);
-	send_packet(packet);
-
 	packet->set_packet_id(packet_id);
 	packet->set_send_full_objects(full_objects);
 	packet->set_user_data(user_data);
+	packet->set_compression_type(compression_type);
+
+	return send_packet(packet, priority);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BULK DATA
+
+int GRDevice::open_bulk_channel(String name, int total_size) {
+	ERR_FAIL_COND_V(total_size < 0, -1);
+
+	bulk_mutex.lock();
+	uint32_t id = bulk_next_channel++;
+	BulkOutChannel &c = bulk_out_channels[id];
+	c.name = name;
+	c.total_size = total_size;
+	bulk_mutex.unlock();
+	return id;
+}
+
+Error GRDevice::write_bulk_channel(int channel, const PoolByteArray &data) {
+	Error err = Error::OK;
+
+	bulk_mutex.lock();
+	auto it = bulk_out_channels.find(channel);
+	if (it == bulk_out_channels.end() || it->second.closed || it->second.cancelled) {
+		err = Error::ERR_DOES_NOT_EXIST;
+	} else if (data.size() > bulk_window_size) {
+		// would never fit, must be split by the caller
+		err = Error::ERR_INVALID_PARAMETER;
+	} else if (it->second.written - it->second.acked + data.size() > (uint64_t)bulk_window_size) {
+		// whole data must fit in the window. caller must wait for bulk_writable
+		it->second.blocked = true;
+		err = Error::ERR_BUSY;
+	} else if (data.size()) {
+		it->second.pending.push_back(data);
+		it->second.written += data.size();
+	}
+	bulk_mutex.unlock();
+
+	if (err == Error::ERR_DOES_NOT_EXIST) {
+		_log("Bulk channel " + str(channel) + " is not opened", LogLevel::LL_ERROR);
+	} else if (err == Error::ERR_INVALID_PARAMETER) {
+		_log("Bulk data of " + str(data.size()) + " bytes is larger than the bulk window", LogLevel::LL_ERROR);
+	}
+	return err;
+}
+
+Error GRDevice::close_bulk_channel(int channel) {
+	Error err = Error::OK;
+
+	bulk_mutex.lock();
+	auto it = bulk_out_channels.find(channel);
+	if (it == bulk_out_channels.end() || it->second.cancelled) {
+		err = Error::ERR_DOES_NOT_EXIST;
+	} else {
+		it->second.closed = true;
+	}
+	bulk_mutex.unlock();
+	return err;
+}
+
+void GRDevice::cancel_bulk_channel(int channel) {
+	bulk_mutex.lock();
+	auto it = bulk_out_channels.find(channel);
+	if (it != bulk_out_channels.end() && !it->second.cancelled) {
+		it->second.cancelled = true;
+		it->second.pending.clear();
+		call_deferred("emit_signal", "bulk_completed", channel, false);
+	}
+	bulk_mutex.unlock();
+}
+
+int GRDevice::get_bulk_channel_writable_size(int channel) {
+	int res = 0;
+
+	bulk_mutex.lock();
+	auto it = bulk_out_channels.find(channel);
+	if (it != bulk_out_channels.end() && !it->second.closed && !it->second.cancelled) {
+		int64_t buffered = (int64_t)(it->second.written - it->second.acked);
+		res = (int)max((int64_t)bulk_window_size - buffered, (int64_t)0);
+	}
+	bulk_mutex.unlock();
+	return res;
+}
+
+PoolByteArray GRDevice::read_bulk_channel(int channel, int max_size) {
+	PoolByteArray res;
+
+	bulk_mutex.lock();
+	auto it = bulk_in_channels.find(channel);
+	if (it != bulk_in_channels.end() && !it->second.finished) {
+		BulkInChannel &c = it->second;
+		int size = (int)(c.received - c.read);
+		if (max_size > 0 && max_size < size)
+			size = max_size;
+
+		res.resize(size);
+		{
+			auto w = res.write();
+			int pos = 0;
+			while (pos < size) {
+				int part = c.buffered.front().size() - c.buffered_offset;
+				if (part > size - pos)
+					part = size - pos;
+				{
+					auto r = c.buffered.front().read();
+					memcpy(w.ptr() + pos, r.ptr() + c.buffered_offset, part);
+				}
+				pos += part;
+				c.buffered_offset += part;
+				if (c.buffered_offset == c.buffered.front().size()) {
+					c.buffered.pop_front();
+					c.buffered_offset = 0;
+				}
+			}
+		}
+		// acked by the connection thread
+		c.read += size;
+
+		if (c.close_received && c.read == c.received) {
+			_bulk_finish_in_channel(channel, c);
+		}
+	}
+	bulk_mutex.unlock();
+	return res;
+}
+
+int GRDevice::get_bulk_channel_available_size(int channel) {
+	int res = 0;
+
+	bulk_mutex.lock();
+	auto it = bulk_in_channels.find(channel);
+	if (it != bulk_in_channels.end() && !it->second.finished) {
+		res = (int)(it->second.received - it->second.read);
+	}
+	bulk_mutex.unlock();
+	return res;
+}
+
+void GRDevice::set_bulk_window_size(int _size) {
+	ERR_FAIL_COND(_size <= 0);
+	bulk_window_size = _size;
+}
+
+int GRDevice::get_bulk_window_size() {
+	return bulk_window_size;
+}
+
+void GRDevice::set_bulk_writable_low_water(int _size) {
+	ERR_FAIL_COND(_size <= 0);
+	bulk_writable_low_water = _size;
+}
+
+int GRDevice::get_bulk_writable_low_water() {
+	return bulk_writable_low_water;
+}
+
+void GRDevice::set_bulk_bandwidth_limit(int _bytes_per_sec) {
+	ERR_FAIL_COND(_bytes_per_sec < 0);
+	bulk_bandwidth_limit = _bytes_per_sec;
+}
+
+int GRDevice::get_bulk_bandwidth_limit() {
+	return bulk_bandwidth_limit;
+}
+
+Error GRDevice::_bulk_send(GRPacketWriter &writer, uint64_t time_budget_us, bool &r_sent) {
+	OS *os = OS::get_singleton();
+	uint64_t start_time = os->get_ticks_usec();
+	std::vector<Ref<GRPacketBulkData> > packs;
+
+	// acks of the data read by the consumers
+	std::vector<Ref<GRPacketBulkDataAck> > acks;
+	bulk_mutex.lock();
+	for (auto it = bulk_in_channels.begin(); it != bulk_in_channels.end();) {
+		BulkInChannel &c = it->second;
+		if (c.finished || c.read > c.ack_sent) {
+			Ref<GRPacketBulkDataAck> ack = newref(GRPacketBulkDataAck);
+			ack->set_channel(it->first);
+			ack->set_received(c.read);
+			ack->set_rejected(c.rejected);
+			acks.push_back(ack);
+			c.ack_sent = c.read;
+		}
+
+		if (c.finished) {
+			it = bulk_in_channels.erase(it);
+		} else {
+			it++;
+		}
+	}
+	bulk_mutex.unlock();
+
+	for (int i = 0; i < (int)acks.size(); i++) {
+		r_sent = true;
+		Error err = writer.put(acks[i]);
+		if (err) {
+			return err;
+		}
+	}
+
+	// channels take turns, one packet per channel in each round
+	do {
+		packs.clear();
+
+		bulk_mutex.lock();
+		uint64_t time = os->get_ticks_usec();
+		if (bulk_bandwidth_limit > 0) {
+			// token bucket with up to 100 ms of burst
+			double burst = (double)max(bulk_bandwidth_limit / 10, bulk_chunk_size);
+			bulk_tokens += (time - bulk_tokens_time) * (bulk_bandwidth_limit / 1000000.0);
+			if (bulk_tokens > burst)
+				bulk_tokens = burst;
+		}
+		bulk_tokens_time = time;
+
+		for (auto it = bulk_out_channels.begin(); it != bulk_out_channels.end();) {
+			BulkOutChannel &c = it->second;
+			Ref<GRPacketBulkData> pack;
+
+			if (c.cancelled) {
+				if (c.open_sent) {
+					pack = newref(GRPacketBulkData);
+					pack->set_channel(it->first);
+					pack->set_flags(GRPacketBulkData::FLAG_CANCEL);
+					packs.push_back(pack);
+				}
+				it = bulk_out_channels.erase(it);
+				continue;
+			}
+
+			int size = 0;
+			if (!c.pending.empty() && c.sent - c.acked < (uint64_t)bulk_window_size) {
+				size = min(bulk_chunk_size, c.pending.front().size() - c.pending_offset);
+				if (bulk_bandwidth_limit > 0)
+					size = min(size, (int)bulk_tokens);
+			}
+
+			if (size > 0) {
+				pack = newref(GRPacketBulkData);
+				pack->set_offset(c.sent);
+				pack->set_bulk_data(c.pending.front(), c.pending_offset, size);
+
+				c.sent += size;
+				c.pending_offset += size;
+				if (c.pending_offset == c.pending.front().size()) {
+					c.pending.pop_front();
+					c.pending_offset = 0;
+				}
+				if (bulk_bandwidth_limit > 0)
+					bulk_tokens -= size;
+			}
+
+			uint8_t flags = 0;
+			if (!c.open_sent)
+				flags |= GRPacketBulkData::FLAG_OPEN;
+			if (c.closed && !c.close_sent && c.pending.empty())
+				flags |= GRPacketBulkData::FLAG_CLOSE;
+
+			if (flags && pack.is_null()) {
+				pack = newref(GRPacketBulkData);
+				pack->set_offset(c.sent);
+			}
+
+			if (pack.is_valid()) {
+				pack->set_channel(it->first);
+				pack->set_flags(flags);
+				if (flags & GRPacketBulkData::FLAG_OPEN) {
+					pack->set_name(c.name);
+					pack->set_total_size(c.total_size);
+					c.open_sent = true;
+				}
+				if (flags & GRPacketBulkData::FLAG_CLOSE) {
+					c.close_sent = true;
+				}
+				packs.push_back(pack);
+			}
+			it++;
+		}
+		bulk_mutex.unlock();
+
+		// serialized outside of the lock
+		for (int i = 0; i < (int)packs.size(); i++) {
+			r_sent = true;
+			Error err = writer.put(packs[i]);
+			if (err) {
+				return err;
+			}
+		}
+	} while (packs.size() && (os->get_ticks_usec() - start_time) < time_budget_us);
+
+	return Error::OK;
+}
 
-	send_queue_mutex.unlock();
+void GRDevice::_bulk_finish_in_channel(uint32_t id, BulkInChannel &c) {
+	c.finished = true;
+	c.buffered.clear();
+	c.buffered_offset = 0;
+	call_deferred("emit_signal", "bulk_channel_closed", id, !c.rejected);
 }
 
-void GRDevice::_send_queue_resize(int new_size) {
-	send_queue_mutex.lock();
-	send_queue.resize(new_size);
-	send_queue_mutex.unlock();
+Error GRDevice::_bulk_receive(const Ref<GRPacket> &pack) {
+	Ref<GRPacketBulkDataAck> ack = pack;
+	if (ack.is_valid()) {
+		bulk_mutex.lock();
+		auto it = bulk_out_channels.find(ack->get_channel());
+		if (it != bulk_out_channels.end() && !it->second.cancelled) {
+			BulkOutChannel &c = it->second;
+			uint32_t id = it->first;
+
+			if (ack->is_rejected()) {
+				call_deferred("emit_signal", "bulk_completed", id, false);
+				bulk_out_channels.erase(it);
+				bulk_mutex.unlock();
+				_log("Bulk channel " + str(id) + " was rejected by the receiver", LogLevel::LL_ERROR);
+				return Error::OK;
+			}
+
+			if (ack->get_received() > c.acked)
+				c.acked = min(ack->get_received(), c.sent);
+			call_deferred("emit_signal", "bulk_progress", id, c.acked, c.total_size ? c.total_size : c.written);
+
+			// not woken up for every few freed bytes
+			int64_t free_size = (int64_t)bulk_window_size - (int64_t)(c.written - c.acked);
+			if (c.blocked && free_size >= (int64_t)min(bulk_writable_low_water, bulk_window_size)) {
+				c.blocked = false;
+				call_deferred("emit_signal", "bulk_writable", id);
+			}
+
+			if (c.close_sent && c.acked >= c.written) {
+				call_deferred("emit_signal", "bulk_completed", id, true);
+				bulk_out_channels.erase(it);
+			}
+		}
+		bulk_mutex.unlock();
+		return Error::OK;
+	}
+
+	Ref<GRPacketBulkData> data = pack;
+	ERR_FAIL_COND_V(data.is_null(), Error::ERR_INVALID_PARAMETER);
+
+	uint32_t id = data->get_channel();
+	uint8_t flags = data->get_flags();
+
+	bulk_mutex.lock();
+	if (flags & GRPacketBulkData::FLAG_OPEN) {
+		BulkInChannel c;
+		c.name = data->get_name();
+		c.total_size = data->get_total_size();
+		bulk_in_channels[id] = c;
+		call_deferred("emit_signal", "bulk_channel_opened", id, c.name, c.total_size);
+	}
+
+	auto it = bulk_in_channels.find(id);
+	if (it == bulk_in_channels.end()) {
+		bulk_mutex.unlock();
+		_log("Received bulk data for unknown channel " + str(id), LogLevel::LL_WARNING);
+		return Error::OK;
+	}
+
+	BulkInChannel &c = it->second;
+	// rejected or completed, waits for the last ack
+	if (c.finished) {
+		bulk_mutex.unlock();
+		return Error::OK;
+	}
+
+	if (flags & GRPacketBulkData::FLAG_CANCEL) {
+		call_deferred("emit_signal", "bulk_channel_closed", id, false);
+		bulk_in_channels.erase(it);
+		bulk_mutex.unlock();
+		return Error::OK;
+	}
+
+	// reordered or repeated data would break the stream
+	if (data->get_offset() != c.received) {
+		uint64_t expected = c.received;
+		c.rejected = true;
+		_bulk_finish_in_channel(id, c);
+		bulk_mutex.unlock();
+		_log("Bulk channel " + str(id) + " got data at offset " + str(data->get_offset()) + " instead of " + str(expected), LogLevel::LL_ERROR);
+		return Error::OK;
+	}
+
+	PoolByteArray bytes = data->get_bulk_data();
+	if (bytes.size()) {
+		c.buffered.push_back(bytes);
+		c.received += bytes.size();
+		call_deferred("emit_signal", "bulk_data_available", id, (int)(c.received - c.read));
+	}
+
+	if (flags & GRPacketBulkData::FLAG_CLOSE) {
+		c.close_received = true;
+		if (c.read == c.received) {
+			_bulk_finish_in_channel(id, c);
+		}
+	}
+	bulk_mutex.unlock();
+	return Error::OK;
+}
+
+void GRDevice::_bulk_reset() {
+	bulk_mutex.lock();
+	for (auto it = bulk_out_channels.begin(); it != bulk_out_channels.end(); it++) {
+		if (!it->second.cancelled)
+			call_deferred("emit_signal", "bulk_completed", it->first, false);
+	}
+	for (auto it = bulk_in_channels.begin(); it != bulk_in_channels.end(); it++) {
+		if (!it->second.finished)
+			call_deferred("emit_signal", "bulk_channel_closed", it->first, false);
+	}
+	bulk_out_channels.clear();
+	bulk_in_channels.clear();
+	bulk_tokens = 0;
+	bulk_mutex.unlock();
+}
+
+bool GRDevice::_has_incoming_packets(const Ref<PacketPeerStream> &ppeer) {
+	return !recv_batch.empty() || ppeer->get_available_packet_count() > 0;
+}
+
+Error GRDevice::_get_incoming_packet(const Ref<PacketPeerStream> &ppeer, Ref<GRPacket> &r_pack) {
+	if (recv_batch.empty()) {
+		Variant res;
+		Error err = ppeer->get_var(res);
+		if (err)
+			return err;
+
+		r_pack = GRPacket::create(res);
+		Ref<GRPacketBatch> batch = r_pack;
+		if (batch.is_null()) {
+			if (r_pack.is_valid())
+				received_traffic.add((uint8_t)r_pack->get_type(), ((PoolByteArray)res).size());
+			return Error::OK;
+		}
+
+		r_pack.unref();
+		for (int i = 0; i < batch->get_packets_count(); i++) {
+			PoolByteArray data = batch->get_packet_data(i);
+			Ref<GRPacket> pack = GRPacket::create(data);
+			if (pack.is_valid()) {
+				received_traffic.add((uint8_t)pack->get_type(), data.size());
+				recv_batch.push_back(pack);
+			}
+		}
+
+		if (recv_batch.empty())
+			return Error::OK;
+	}
+
+	r_pack = recv_batch.front();
+	recv_batch.pop_front();
+	return Error::OK;
+}
+
+Error GRDevice::_put_packet(const Ref<PacketPeerStream> &ppeer, const PoolByteArray &data) {
+	ERR_FAIL_COND_V(data.size() == 0, Error::ERR_INVALID_PARAMETER);
+	sent_traffic.add(data.read()[0], data.size());
+	return ppeer->put_var(data);
+}
+
+void GRDevice::_send_slot_push(const Ref<GRPacket> &packet) {
+	send_slots[(int)packet->get_type()] = packet;
+	has_send_slots.store(true, std::memory_order_release);
+}
+
+void GRDevice::_send_queue_clear() {
+	// packets pushed meanwhile keep their reserved places
+	int removed = 0;
+	for (int i = 0; i < SendPriority::PRIORITY_MAX; i++) {
+		removed += send_queue[i].clear();
+	}
+	send_queue_size -= removed;
+	send_queue_overflowed = false;
+
+	send_slots_mutex.lock();
+	send_slots.clear();
+	has_send_slots = false;
+	send_slots_mutex.unlock();
 }
 
 Ref<GRPacket> GRDevice::_send_queue_pop_front() {
-	send_queue_mutex.lock();
 	Ref<GRPacket> packet;
-	if (send_queue.size() > 0) {
-		packet = send_queue.front();
-		send_queue.erase(send_queue.begin());
+
+	// slots go first, they are few and small
+	if (has_send_slots.load(std::memory_order_acquire)) {
+		send_slots_mutex.lock();
+		if (send_slots.size()) {
+			packet = send_slots.begin()->second;
+			send_slots.erase(send_slots.begin());
+		}
+		has_send_slots = send_slots.size() != 0;
+		send_slots_mutex.unlock();
+
+		if (packet.is_valid())
+			return packet;
+	}
+
+	for (int i = 0; i < SendPriority::PRIORITY_MAX; i++) {
+		if (send_queue[i].pop(packet)) {
+			int size = --send_queue_size;
+			if (send_queue_overflowed && size <= send_queue_high_water_mark / 2) {
+				send_queue_overflowed = false;
+				call_deferred("emit_signal", "send_queue_drained");
+			}
+			return packet;
+		}
 	}
-	send_queue_mutex.unlock();
 	return packet;
 }
 
+void GRDevice::_set_latency_breakdown(const Dictionary &_breakdown) {
+	latency_mutex.lock();
+	latency_breakdown = _breakdown;
+	latency_mutex.unlock();
+}
+
+Dictionary GRDevice::get_latency_breakdown() {
+	latency_mutex.lock();
+	Dictionary res = latency_breakdown.duplicate();
+	latency_mutex.unlock();
+	return res;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// STATS
+
+const char *GRDevice::stats_stage_names[STAGE_MAX] = {
+	"capture",
+	"convert",
+	"encode",
+	"queue_wait",
+	"send",
+	"receive",
+	"decode",
+	"texture_upload",
+};
+
+Dictionary GRDevice::get_stats() {
+	Dictionary res;
+	for (int i = 0; i < STAGE_MAX; i++) {
+		if (stage_stats[i].get_count()) {
+			res[stats_stage_names[i]] = stage_stats[i].get_dictionary();
+		}
+	}
+
+	// recent values. times in ms, sizes in bytes
+	window_stats_mutex.lock();
+	res["ping"] = ping_stats.get_dictionary(0.001);
+	res["frametime"] = frametime_stats.get_dictionary(0.001);
+	res["frame_size"] = frame_size_stats.get_dictionary();
+	res["encode_time"] = encode_time_stats.get_dictionary(0.001);
+	window_stats_mutex.unlock();
+	return res;
+}
+
+void GRDevice::reset_stats() {
+	for (int i = 0; i < STAGE_MAX; i++) {
+		stage_stats[i].reset();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// METRICS
+
+static String _packet_type_name(int type) {
+	switch ((GRPacket::PacketType)type) {
+		case GRPacket::PacketType::NonePacket:
+			return "NonePacket";
+		case GRPacket::PacketType::SyncTime:
+			return "SyncTime";
+		case GRPacket::PacketType::ImageData:
+			return "ImageData";
+		case GRPacket::PacketType::InputData:
+			return "InputData";
+		case GRPacket::PacketType::ServerSettings:
+			return "ServerSettings";
+		case GRPacket::PacketType::MouseModeSync:
+			return "MouseModeSync";
+		case GRPacket::PacketType::CustomInputScene:
+			return "CustomInputScene";
+		case GRPacket::PacketType::ClientStreamOrientation:
+			return "ClientStreamOrientation";
+		case GRPacket::PacketType::ClientStreamAspect:
+			return "ClientStreamAspect";
+		case GRPacket::PacketType::CustomUserData:
+			return "CustomUserData";
+		case GRPacket::PacketType::CursorShapeSync:
+			return "CursorShapeSync";
+		case GRPacket::PacketType::CustomInputScenePatch:
+			return "CustomInputScenePatch";
+		case GRPacket::PacketType::CustomInputSceneChunk:
+			return "CustomInputSceneChunk";
+		case GRPacket::PacketType::BulkData:
+			return "BulkData";
+		case GRPacket::PacketType::Batch:
+			return "Batch";
+		case GRPacket::PacketType::Ping:
+			return "Ping";
+		case GRPacket::PacketType::CustomInputSceneRequest:
+			return "CustomInputSceneRequest";
+		case GRPacket::PacketType::Pong:
+			return "Pong";
+		case GRPacket::PacketType::BulkDataAck:
+			return "BulkDataAck";
+	}
+	return str(type);
+}
+
+static void _write_traffic_metrics(GRMetricsWriter &w, const String &name, const String &help, const GRUtils::traffic_counters &counters, bool bytes) {
+	w.add_header(name, "counter", help);
+	for (int i = 0; i < GRUtils::traffic_counters::types_count; i++) {
+		if (counters.get_packets(i)) {
+			w.add_value(name, (double)(bytes ? counters.get_bytes(i) : counters.get_packets(i)), "type=\"" + _packet_type_name(i) + "\"");
+		}
+	}
+}
+
+void GRDevice::_start_metrics_server() {
+	_stop_metrics_server();
+	if (!(bool)GET_PS(GodotRemote::ps_general_metrics_enabled_name))
+		return;
+
+	String address = GET_PS(GodotRemote::ps_general_metrics_address_name);
+	int metrics_port = GET_PS(GodotRemote::ps_general_metrics_port_name);
+
+	metrics_server = memnew(GRMetricsServer(this));
+	Error err = metrics_server->start(address, metrics_port);
+	if (err) {
+		_log("Can't start metrics endpoint on " + address + ":" + str(metrics_port) + ". Code: " + str(err), LogLevel::LL_ERROR);
+		memdelete(metrics_server);
+		metrics_server = nullptr;
+		return;
+	}
+	_log("Metrics are available on http://" + address + ":" + str(metrics_port) + "/metrics", LogLevel::LL_NORMAL);
+}
+
+void GRDevice::_stop_metrics_server() {
+	if (metrics_server) {
+		memdelete(metrics_server);
+		metrics_server = nullptr;
+	}
+}
+
+void GRDevice::_write_metrics(GRMetricsWriter &w) {
+	w.add_metric("godot_remote_up", "gauge", "1 if the device is working", get_status() == WorkingStatus::STATUS_WORKING ? 1 : 0);
+
+	window_stats_mutex.lock();
+	w.add_metric("godot_remote_fps", "gauge", "Average stream fps in about the last second", avg_fps);
+	w.add_metric("godot_remote_fps_min", "gauge", "Fps of the longest recent frame", min_fps);
+	w.add_metric("godot_remote_fps_max", "gauge", "Fps of the shortest recent frame", max_fps);
+
+	w.add_header("godot_remote_rtt_seconds", "summary", "Round trip time of pings. quantiles are of recent pings");
+	w.add_value("godot_remote_rtt_seconds", ping_stats.get_percentile(0.5) / 1000000.0, "quantile=\"0.5\"");
+	w.add_value("godot_remote_rtt_seconds", ping_stats.get_percentile(0.95) / 1000000.0, "quantile=\"0.95\"");
+	w.add_value("godot_remote_rtt_seconds", ping_stats.get_percentile(0.99) / 1000000.0, "quantile=\"0.99\"");
+	w.add_value("godot_remote_rtt_seconds_sum", ping_total_sum / 1000000.0);
+	w.add_value("godot_remote_rtt_seconds_count", (double)ping_total_count);
+
+	w.add_metric("godot_remote_frame_bytes", "gauge", "Average size of recent frames", frame_size_stats.get_avg());
+	window_stats_mutex.unlock();
+
+	w.add_header("godot_remote_stage_seconds", "summary", "Time spent in the stages of the stream pipeline");
+	for (int i = 0; i < STAGE_MAX; i++) {
+		if (stage_stats[i].get_count()) {
+			w.add_summary_values("godot_remote_stage_seconds", stage_stats[i], String("stage=\"") + stats_stage_names[i] + "\"");
+		}
+	}
+
+	_write_traffic_metrics(w, "godot_remote_sent_bytes_total", "Bytes of sent packets by type", sent_traffic, true);
+	_write_traffic_metrics(w, "godot_remote_sent_packets_total", "Number of sent packets by type", sent_traffic, false);
+	_write_traffic_metrics(w, "godot_remote_received_bytes_total", "Bytes of received packets by type", received_traffic, true);
+	_write_traffic_metrics(w, "godot_remote_received_packets_total", "Number of received packets by type", received_traffic, false);
+
+	w.add_metric("godot_remote_dropped_frames_total", "counter", "Frames replaced or discarded before they were sent or shown", (double)dropped_frames.load());
+
+	w.add_header("godot_remote_queue_depth", "gauge", "Number of items waiting in the queues");
+	w.add_value("godot_remote_queue_depth", send_queue_size.load(), "queue=\"send\"");
+}
+
 void GRDevice::set_status(WorkingStatus status) {
 	working_status = status;
 	emit_signal("status_changed", working_status);
@@ -143,15 +938,36 @@ void GRDevice::set_port(uint16_t _port) {
 	restart();
 }
 
-void GRDevice::send_packet(Ref<GRPacket> packet) {
-	ERR_FAIL_COND(packet.is_null());
+Error GRDevice::send_packet(Ref<GRPacket> packet, SendPriority priority) {
+	ERR_FAIL_COND_V(packet.is_null(), Error::ERR_INVALID_PARAMETER);
+	ERR_FAIL_INDEX_V(priority, SendPriority::PRIORITY_MAX, Error::ERR_INVALID_PARAMETER);
+
+	// place is reserved first, so concurrent producers can't overshoot the limit.
+	// high priority lane is used for small control packets and gets extra room above the mark
+	int limit = send_queue_high_water_mark + (priority == SendPriority::PRIORITY_HIGH ? send_queue_high_priority_reserve : 0);
+	if (send_queue_size.fetch_add(1) >= limit) {
+		send_queue_size--;
+		if (!send_queue_overflowed.exchange(true)) {
+			call_deferred("emit_signal", "send_queue_overflowed");
+		}
+		return Error::ERR_BUSY;
+	}
 
-	send_queue_mutex.lock();
-	if (send_queue.size() > 10000)
-		send_queue.resize(0);
+	send_queue[priority].push(packet);
+	return Error::OK;
+}
+
+int GRDevice::get_send_queue_size() {
+	return send_queue_size;
+}
+
+void GRDevice::set_send_queue_high_water_mark(int _val) {
+	ERR_FAIL_COND(_val <= 0);
+	send_queue_high_water_mark = _val;
+}
 
-	send_queue.push_back(packet);
-	send_queue_mutex.unlock();
+int GRDevice::get_send_queue_high_water_mark() {
+	return send_queue_high_water_mark;
 }
 
 void GRDevice::start() {
@@ -184,6 +1000,7 @@ void GRDevice::_init() {
 
 void GRDevice::_deinit() {
 	LEAVE_IF_EDITOR();
+	_stop_metrics_server();
 	if (GodotRemote::get_singleton()) {
 		GodotRemote::get_singleton()->device = nullptr;
 	}
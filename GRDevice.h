@@ -1,6 +1,8 @@
 /* GRDevice.h */
 #pragma once
 
+#include <deque>
+#include <map>
 #include <vector>
 
 #include "GRLiterals.h"
@@ -8,11 +10,36 @@
 #include "GRPacket.h"
 #include "GRUtils.h"
 
+#include "core/io/packet_peer.h"
 #include "scene/main/node.h"
 
+// Collects small packets and writes them to the socket at once.
+// Big packets are written directly, latency-critical ones flush the batch right away
+class GRPacketWriter {
+	Ref<PacketPeerStream> ppeer;
+	Ref<GRPacketBatch> batch;
+	int batch_size = 0;
+	GRUtils::traffic_counters *counters = nullptr;
+
+	static bool _is_latency_critical(GRPacket::PacketType type);
+
+public:
+	static const int max_batched_packet_size = 1024;
+	static const int max_batch_size = 16 * 1024;
+
+	Error put(const PoolByteArray &data);
+	Error put(const Ref<GRPacket> &pack) { return put(pack->get_data()); }
+	Error flush();
+
+	GRPacketWriter(const Ref<PacketPeerStream> &_ppeer, GRUtils::traffic_counters *_counters = nullptr);
+};
+
 class GRDevice : public Node {
 	GDCLASS(GRDevice, Node);
 
+	friend class GRMetricsServer;
+	friend class GRLoopbackBenchmark;
+
 public:
 	enum class AuthResult {
 		OK = 0,
@@ -48,6 +75,13 @@ public:
 		SUBSAMPLING_H2V2 = __SUBSAMPLING_H2V2
 	};
 
+	enum SendPriority {
+		PRIORITY_HIGH = 0,
+		PRIORITY_NORMAL = 1,
+		PRIORITY_LOW = 2,
+		PRIORITY_MAX,
+	};
+
 	enum ImageCompressionType {
 		COMPRESSION_UNCOMPRESSED = __COMPRESSION_UNCOMPRESSED,
 		COMPRESSION_JPG = __COMPRESSION_JPG,
@@ -58,10 +92,11 @@ private:
 	WorkingStatus working_status = WorkingStatus::STATUS_STOPPED;
 
 protected:
+	// must be called with send_slots_mutex locked
 	template <class T>
-	T _find_queued_packet_by_type() {
-		for (unsigned i = 0; i < send_queue.size(); i++) {
-			T o = send_queue[i];
+	T _find_send_slot() {
+		for (auto it = send_slots.begin(); it != send_slots.end(); it++) {
+			T o = it->second;
 			if (o.is_valid()) {
 				return o;
 			}
@@ -69,23 +104,132 @@ protected:
 		return T();
 	}
 
-	GRUtils::iterable_queue<uint64_t> fps_queue;
- 	GRUtils::iterable_queue<uint64_t> ping_queue;
- 	float avg_ping = 0, min_ping = 0, max_ping = 0;
- 	float avg_fps = 0, min_fps = 0, max_fps = 0;
- 	uint32_t avg_ping_max_count = 100;
+	// sliding windows, updated by the connection thread
+	Mutex window_stats_mutex;
+	GRUtils::window_stats frametime_stats;
+	GRUtils::window_stats ping_stats;
+	GRUtils::window_stats frame_size_stats;
+	GRUtils::window_stats encode_time_stats;
+	float avg_ping = 0, min_ping = 0, max_ping = 0;
+	float avg_fps = 0, min_fps = 0, max_fps = 0;
+	uint32_t avg_ping_max_count = 100;
+	// all pings since start, for the _sum and _count of the rtt summary
+	uint64_t ping_total_count = 0;
+	uint64_t ping_total_sum = 0;
+	uint32_t frame_stats_max_count = 100;
 
-	Mutex send_queue_mutex;
-	std::vector<Ref<GRPacket> > send_queue;
+	// one lane per priority. any thread can push, only the connection thread pops
+	GRUtils::mpsc_queue<Ref<GRPacket> > send_queue[PRIORITY_MAX];
+	std::atomic<int> send_queue_size = { 0 };
+	std::atomic<bool> send_queue_overflowed = { false };
+	int send_queue_high_water_mark = 10000;
+	int send_queue_high_priority_reserve = 256;
 
+	// latest-wins packets. queued once and updated in place until sent
+	Mutex send_slots_mutex;
+	std::map<int, Ref<GRPacket> > send_slots;
+	std::atomic<bool> has_send_slots = { false };
+
+	// stages of the last frame in milliseconds
+	Mutex latency_mutex;
+	Dictionary latency_breakdown;
+
+	// always collected, even in release builds.
+	// queue_wait is the time before sending on the server and before decoding on the client
+	enum StatsStage {
+		STAGE_CAPTURE,
+		STAGE_CONVERT,
+		STAGE_ENCODE,
+		STAGE_QUEUE_WAIT,
+		STAGE_SEND,
+		STAGE_RECEIVE,
+		STAGE_DECODE,
+		STAGE_TEXTURE_UPLOAD,
+		STAGE_MAX,
+	};
+	static const char *stats_stage_names[STAGE_MAX];
+	GRUtils::latency_histogram stage_stats[STAGE_MAX];
+
+	// never reset, scrapers compute rates from them
+	GRUtils::traffic_counters sent_traffic;
+	GRUtils::traffic_counters received_traffic;
+	std::atomic<uint64_t> dropped_frames = { 0 };
+	class GRMetricsServer *metrics_server = nullptr;
+
+	_FORCE_INLINE_ void _add_stage_time(StatsStage stage, int64_t usec) {
+		if (usec >= 0)
+			stage_stats[stage].add(usec);
+	}
+	void _start_metrics_server();
+	void _stop_metrics_server();
+	// called from the metrics thread. must only read atomics or lock mutexes
+	virtual void _write_metrics(class GRMetricsWriter &w);
+
+	void _set_latency_breakdown(const Dictionary &_breakdown);
 	void set_status(WorkingStatus status);
 	void _update_avg_ping(uint64_t ping);
 	void _update_avg_fps(uint64_t frametime);
+	void _update_frame_stats(uint64_t size, uint64_t encode_time);
 	static float _ping_calc_modifier(double i);
  	static float _fps_calc_modifier(double i);
-	void _send_queue_resize(int new_size);
+	// packets unpacked from a received GRPacketBatch. used only by the connection thread
+	std::deque<Ref<GRPacket> > recv_batch;
+	bool _has_incoming_packets(const Ref<PacketPeerStream> &ppeer);
+	Error _get_incoming_packet(const Ref<PacketPeerStream> &ppeer, Ref<GRPacket> &r_pack);
+	// direct write, bypassing GRPacketWriter
+	Error _put_packet(const Ref<PacketPeerStream> &ppeer, const PoolByteArray &data);
+
+	void _send_slot_push(const Ref<GRPacket> &packet);
+	void _send_queue_clear();
 	Ref<GRPacket> _send_queue_pop_front();
 
+	// BULK DATA
+	struct BulkOutChannel {
+		String name;
+		uint64_t total_size = 0;
+		std::deque<PoolByteArray> pending; // written but not sent yet
+		int pending_offset = 0; // already sent part of pending.front()
+		uint64_t written = 0;
+		uint64_t sent = 0;
+		uint64_t acked = 0;
+		bool open_sent = false;
+		bool closed = false;
+		bool close_sent = false;
+		bool cancelled = false;
+		bool blocked = false; // write was refused, bulk_writable will be emitted
+	};
+
+	// data waits here until the consumer reads it and only read bytes are acked,
+	// so the sender's window limits the memory used by the receiver
+	struct BulkInChannel {
+		String name;
+		uint64_t total_size = 0;
+		uint64_t received = 0;
+		uint64_t read = 0;
+		uint64_t ack_sent = 0;
+		std::deque<PoolByteArray> buffered;
+		int buffered_offset = 0; // already read part of buffered.front()
+		bool close_received = false;
+		bool finished = false; // removed after the last ack
+		bool rejected = false;
+	};
+
+	Mutex bulk_mutex;
+	std::map<uint32_t, BulkOutChannel> bulk_out_channels;
+	std::map<uint32_t, BulkInChannel> bulk_in_channels;
+	uint32_t bulk_next_channel = 1;
+	int bulk_window_size = 256 * 1024;
+	int bulk_writable_low_water = 64 * 1024; // free window needed to emit bulk_writable
+	int bulk_chunk_size = 16 * 1024;
+	int bulk_bandwidth_limit = 0;
+	double bulk_tokens = 0;
+	uint64_t bulk_tokens_time = 0;
+
+	Error _bulk_send(GRPacketWriter &writer, uint64_t time_budget_us, bool &r_sent);
+	Error _bulk_receive(const Ref<GRPacket> &pack);
+	void _bulk_finish_in_channel(uint32_t id, BulkInChannel &c);
+	void _bulk_reset();
+
 	virtual void _reset_counters();
 	virtual void _internal_call_only_deffered_start() {};
 	virtual void _internal_call_only_deffered_stop() {};
@@ -104,9 +248,29 @@ public:
 	float get_max_fps();
 	uint16_t get_port();
 	void set_port(uint16_t _port);
+	Dictionary get_latency_breakdown();
+	virtual Dictionary get_stats();
+	virtual void reset_stats();
+
+	Error send_packet(Ref<GRPacket> packet, SendPriority priority = SendPriority::PRIORITY_NORMAL);
+	Error send_user_data(Variant packet_id, Variant user_data, bool full_objects = false, int compression_type = -1, SendPriority priority = SendPriority::PRIORITY_NORMAL);
+	int get_send_queue_size();
+	void set_send_queue_high_water_mark(int _val);
+	int get_send_queue_high_water_mark();
 
-	void send_packet(Ref<GRPacket> packet);
-	void send_user_data(Variant packet_id, Variant user_data, bool full_objects = false);
+	int open_bulk_channel(String name, int total_size = 0);
+	Error write_bulk_channel(int channel, const PoolByteArray &data);
+	Error close_bulk_channel(int channel);
+	void cancel_bulk_channel(int channel);
+	int get_bulk_channel_writable_size(int channel);
+	PoolByteArray read_bulk_channel(int channel, int max_size = 0);
+	int get_bulk_channel_available_size(int channel);
+	void set_bulk_window_size(int _size);
+	int get_bulk_window_size();
+	void set_bulk_writable_low_water(int _size);
+	int get_bulk_writable_low_water();
+	void set_bulk_bandwidth_limit(int _bytes_per_sec);
+	int get_bulk_bandwidth_limit();
 
 	void start();
 	void stop();
@@ -123,3 +287,4 @@ VARIANT_ENUM_CAST(GRDevice::WorkingStatus)
 VARIANT_ENUM_CAST(GRDevice::Subsampling)
 VARIANT_ENUM_CAST(GRDevice::ImageCompressionType)
 VARIANT_ENUM_CAST(GRDevice::TypesOfServerSettings)
+VARIANT_ENUM_CAST(GRDevice::SendPriority)
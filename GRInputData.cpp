@@ -106,6 +106,18 @@ Ref<GRInputDataEvent> GRInputDataEvent::parse_event(const Ref<InputEvent> &ev, c
 	return Ref<GRInputDataEvent>();
 }
 
+static Rect2 _get_restore_rect(const Rect2 &rect) {
+	Rect2 vp_size = rect;
+	if (vp_size.size.x == 0 && vp_size.size.y == 0 &&
+			vp_size.position.x == 0 && vp_size.position.y == 0) {
+		if (SceneTree::get_singleton() && SceneTree::get_singleton()->get_root()) {
+			//vp_size = SceneTree::get_singleton()->get_root()->get_visible_rect();
+			vp_size = Rect2(OS::get_singleton()->get_window_size(), SceneTree::get_singleton()->get_root()->get_size());
+		}
+	}
+	return vp_size;
+}
+
 Ref<InputEvent> GRInputDataEvent::construct_event(const Rect2 &rect) {
 	ERR_FAIL_COND_V(!data->get_size(), Ref<InputEvent>());
 
@@ -118,14 +130,7 @@ Ref<InputEvent> GRInputDataEvent::construct_event(const Rect2 &rect) {
 	InputType type = _get_type();
 	ERR_FAIL_COND_V_MSG(type < InputType::_InputEvent || type >= InputType::_InputEventMAX, Ref<GRInputDataEvent>(), "Not InputEvent");
 
-	Rect2 vp_size = rect;
-	if (vp_size.size.x == 0 && vp_size.size.y == 0 &&
-			vp_size.position.x == 0 && vp_size.position.y == 0) {
-		if (SceneTree::get_singleton() && SceneTree::get_singleton()->get_root()) {
-			//vp_size = SceneTree::get_singleton()->get_root()->get_visible_rect();
-			vp_size = Rect2(OS::get_singleton()->get_window_size(), SceneTree::get_singleton()->get_root()->get_size());
-		}
-	}
+	Rect2 vp_size = _get_restore_rect(rect);
 
 	switch (type) {
 		case InputType::_NoneIT:
@@ -449,8 +454,514 @@ PARSE(GRIEDataMIDI) {
 	data->put_32(iemidi->get_controller_value());
 }
 
+//////////////////////////////////////////////////////////////////////////
+// PACKED INPUT BATCH
+
+// 1/65536 of the stream size is far below one pixel on any real screen
+static const float batch_pos_scale = 65536.f;
+static const float batch_pos_limit = 16384.f;
+
+static int32_t _quantize_pos(float val) {
+	if (Math::is_nan(val))
+		return 0;
+	return (int32_t)Math::round(CLAMP(val, -batch_pos_limit, batch_pos_limit) * batch_pos_scale);
+}
+
+void GRInputBatchWriter::_put_8(uint8_t val) {
+	buffer.push_back(val);
+}
+
+void GRInputBatchWriter::_put_uvarint(uint64_t val) {
+	while (val >= 0x80) {
+		buffer.push_back((uint8_t)(val | 0x80));
+		val >>= 7;
+	}
+	buffer.push_back((uint8_t)val);
+}
+
+void GRInputBatchWriter::_put_varint(int64_t val) {
+	// zigzag, so small negative numbers stay small
+	_put_uvarint(((uint64_t)val << 1) ^ (uint64_t)(val >> 63));
+}
+
+void GRInputBatchWriter::_put_float(float val) {
+	size_t pos = buffer.size();
+	buffer.resize(pos + 4);
+	encode_float(val, &buffer[pos]);
+}
+
+void GRInputBatchWriter::_put_unorm16(float val) {
+	uint16_t q = (uint16_t)Math::round(CLAMP(val, 0.f, 1.f) * 65535.f);
+	buffer.push_back((uint8_t)(q & 0xFF));
+	buffer.push_back((uint8_t)(q >> 8));
+}
+
+void GRInputBatchWriter::_put_snorm16(float val) {
+	uint16_t q = (uint16_t)(int16_t)Math::round(CLAMP(val, -1.f, 1.f) * 32767.f);
+	buffer.push_back((uint8_t)(q & 0xFF));
+	buffer.push_back((uint8_t)(q >> 8));
+}
+
+void GRInputBatchWriter::_put_pos(const Vector2 &val) {
+	int32_t x = _quantize_pos(val.x);
+	int32_t y = _quantize_pos(val.y);
+	_put_varint((int64_t)x - prev_pos_x);
+	_put_varint((int64_t)y - prev_pos_y);
+	prev_pos_x = x;
+	prev_pos_y = y;
+}
+
+void GRInputBatchWriter::_put_vec(const Vector2 &val) {
+	_put_varint(_quantize_pos(val.x));
+	_put_varint(_quantize_pos(val.y));
+}
+
+void GRInputBatchWriter::_put_string(const String &val) {
+	CharString cs = val.utf8();
+	_put_uvarint(cs.length());
+	buffer.insert(buffer.end(), (const uint8_t *)cs.get_data(), (const uint8_t *)cs.get_data() + cs.length());
+}
+
+void GRInputBatchWriter::_put_modifiers(const Ref<InputEventWithModifiers> &ev) {
+	_put_8((uint8_t)ev->get_alt() | (uint8_t)ev->get_shift() << 1 | (uint8_t)ev->get_control() << 2 |
+			(uint8_t)ev->get_metakey() << 3 | (uint8_t)ev->get_command() << 4);
+}
+
+void GRInputBatchWriter::_put_header(GRInputData::InputType type, uint64_t time) {
+	_put_8((uint8_t)type);
+	_put_varint((int64_t)(time - prev_time));
+	prev_time = time;
+	count++;
+}
+
+void GRInputBatchWriter::clear() {
+	// keeps capacity, so the buffer is allocated only once
+	buffer.clear();
+	prev_pos_x = 0;
+	prev_pos_y = 0;
+	prev_time = 0;
+	count = 0;
+}
+
+void GRInputBatchWriter::set_stream_rect(const Rect2 &rect) {
+	pos_scale = Vector2(rect.size.x ? 1.f / rect.size.x : 0.f, rect.size.y ? 1.f / rect.size.y : 0.f);
+	pos_offset = -rect.position * pos_scale;
+}
+
+bool GRInputBatchWriter::write_event(const Ref<InputEvent> &ev, uint64_t time) {
+	ERR_FAIL_COND_V(ev.is_null(), false);
+
+#define HEADER(_type)                                 \
+	_put_header(GRInputData::InputType::_type, time); \
+	_put_varint(ev->get_device())
+
+	{
+		Ref<InputEventMouseMotion> iemm = ev;
+		if (iemm.is_valid()) {
+			HEADER(_InputEventMouseMotion);
+			_put_modifiers(iemm);
+			_put_uvarint(iemm->get_button_mask());
+			_put_pos(_normalize(iemm->get_position()));
+			_put_vec(_normalize_rel(iemm->get_global_position() - iemm->get_position()));
+			_put_unorm16(iemm->get_pressure());
+			_put_snorm16(iemm->get_tilt().x);
+			_put_snorm16(iemm->get_tilt().y);
+			_put_vec(_normalize_rel(iemm->get_relative()));
+			_put_vec(_normalize_rel(iemm->get_speed()));
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventMouseButton> iemb = ev;
+		if (iemb.is_valid()) {
+			HEADER(_InputEventMouseButton);
+			_put_modifiers(iemb);
+			_put_uvarint(iemb->get_button_mask());
+			_put_pos(_normalize(iemb->get_position()));
+			_put_vec(_normalize_rel(iemb->get_global_position() - iemb->get_position()));
+			_put_float(iemb->get_factor());
+			_put_uvarint(iemb->get_button_index());
+			_put_8((uint8_t)iemb->is_pressed() | (uint8_t)iemb->is_doubleclick() << 1);
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventScreenDrag> iesd = ev;
+		if (iesd.is_valid()) {
+			HEADER(_InputEventScreenDrag);
+			_put_uvarint(iesd->get_index());
+			_put_pos(_normalize(iesd->get_position()));
+			_put_vec(_normalize_rel(iesd->get_relative()));
+			_put_vec(_normalize_rel(iesd->get_speed()));
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventScreenTouch> iest = ev;
+		if (iest.is_valid()) {
+			HEADER(_InputEventScreenTouch);
+			_put_uvarint(iest->get_index());
+			_put_8(iest->is_pressed());
+			_put_pos(_normalize(iest->get_position()));
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventKey> iek = ev;
+		if (iek.is_valid()) {
+			HEADER(_InputEventKey);
+			_put_modifiers(iek);
+			_put_8((uint8_t)iek->is_pressed() | (uint8_t)iek->is_echo() << 1);
+			_put_uvarint(iek->get_scancode());
+			_put_uvarint(iek->get_unicode());
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventMagnifyGesture> iemg = ev;
+		if (iemg.is_valid()) {
+			HEADER(_InputEventMagnifyGesture);
+			_put_modifiers(iemg);
+			_put_pos(_normalize(iemg->get_position()));
+			_put_float(iemg->get_factor());
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventPanGesture> iepg = ev;
+		if (iepg.is_valid()) {
+			HEADER(_InputEventPanGesture);
+			_put_modifiers(iepg);
+			_put_pos(_normalize(iepg->get_position()));
+			_put_vec(_normalize_rel(iepg->get_delta()));
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventJoypadButton> iejb = ev;
+		if (iejb.is_valid()) {
+			HEADER(_InputEventJoypadButton);
+			_put_uvarint(iejb->get_button_index());
+			_put_unorm16(iejb->get_pressure());
+			_put_8(iejb->is_pressed());
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventJoypadMotion> iejm = ev;
+		if (iejm.is_valid()) {
+			HEADER(_InputEventJoypadMotion);
+			_put_uvarint(iejm->get_axis());
+			_put_snorm16(iejm->get_axis_value());
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventAction> iea = ev;
+		if (iea.is_valid()) {
+			HEADER(_InputEventAction);
+			_put_string(iea->get_action());
+			_put_unorm16(iea->get_strength());
+			_put_8(iea->is_pressed());
+			return true;
+		}
+	}
+
+	{
+		Ref<InputEventMIDI> iemidi = ev;
+		if (iemidi.is_valid()) {
+			HEADER(_InputEventMIDI);
+			_put_varint(iemidi->get_channel());
+			_put_varint(iemidi->get_message());
+			_put_varint(iemidi->get_pitch());
+			_put_varint(iemidi->get_velocity());
+			_put_varint(iemidi->get_instrument());
+			_put_varint(iemidi->get_pressure());
+			_put_varint(iemidi->get_controller_number());
+			_put_varint(iemidi->get_controller_value());
+			return true;
+		}
+	}
+
+#undef HEADER
+
+	ERR_PRINT("Not supported InputEvent type: " + str(ev));
+	return false;
+}
+
+void GRInputBatchWriter::write_sensors(const Vector3 *sensors, uint64_t time) {
+	_put_header(GRInputData::InputType::_InputDeviceSensors, time);
+	for (int i = 0; i < 4; i++) {
+		_put_float(sensors[i].x);
+		_put_float(sensors[i].y);
+		_put_float(sensors[i].z);
+	}
+}
+
+PoolByteArray GRInputBatchWriter::get_data() const {
+	PoolByteArray res;
+	if (buffer.size()) {
+		res.resize((int)buffer.size());
+		auto w = res.write();
+		memcpy(w.ptr(), buffer.data(), buffer.size());
+	}
+	return res;
+}
+
+uint8_t GRInputBatchReader::_get_8() {
+	if (ptr >= end) {
+		error = true;
+		return 0;
+	}
+	return *ptr++;
+}
+
+uint64_t GRInputBatchReader::_get_uvarint() {
+	uint64_t res = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (ptr >= end)
+			break;
+		uint8_t b = *ptr++;
+		res |= (uint64_t)(b & 0x7F) << shift;
+		if (!(b & 0x80))
+			return res;
+	}
+	error = true;
+	return 0;
+}
+
+int64_t GRInputBatchReader::_get_varint() {
+	uint64_t val = _get_uvarint();
+	return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+float GRInputBatchReader::_get_float() {
+	if (end - ptr < 4) {
+		error = true;
+		ptr = end;
+		return 0;
+	}
+	float res = decode_float(ptr);
+	ptr += 4;
+	return res;
+}
+
+float GRInputBatchReader::_get_unorm16() {
+	uint16_t q = _get_8();
+	q |= (uint16_t)_get_8() << 8;
+	return q / 65535.f;
+}
+
+float GRInputBatchReader::_get_snorm16() {
+	uint16_t q = _get_8();
+	q |= (uint16_t)_get_8() << 8;
+	return CLAMP((int16_t)q / 32767.f, -1.f, 1.f);
+}
+
+Vector2 GRInputBatchReader::_get_pos() {
+	prev_pos_x += (int32_t)_get_varint();
+	prev_pos_y += (int32_t)_get_varint();
+	return Vector2(prev_pos_x / batch_pos_scale, prev_pos_y / batch_pos_scale);
+}
+
+Vector2 GRInputBatchReader::_get_vec() {
+	float x = (int32_t)_get_varint() / batch_pos_scale;
+	float y = (int32_t)_get_varint() / batch_pos_scale;
+	return Vector2(x, y);
+}
+
+String GRInputBatchReader::_get_string() {
+	uint64_t len = _get_uvarint();
+	if ((uint64_t)(end - ptr) < len) {
+		error = true;
+		ptr = end;
+		return String();
+	}
+	String res = String::utf8((const char *)ptr, (int)len);
+	ptr += len;
+	return res;
+}
+
+void GRInputBatchReader::_get_modifiers(const Ref<InputEventWithModifiers> &ev) {
+	uint8_t flags = _get_8();
+	ev->set_alt(flags & (1 << 0));
+	ev->set_shift(flags & (1 << 1));
+	ev->set_control(flags & (1 << 2));
+	ev->set_metakey(flags & (1 << 3));
+	ev->set_command(flags & (1 << 4));
+}
+
+bool GRInputBatchReader::read_next() {
+	event.unref();
+	type = GRInputData::InputType::_NoneIT;
+	if (error || ptr >= end)
+		return false;
+
+	type = (GRInputData::InputType)_get_8();
+	time += _get_varint();
+	switch (type) {
+		case GRInputData::InputType::_InputDeviceSensors: {
+			for (int i = 0; i < 4; i++) {
+				float x = _get_float();
+				float y = _get_float();
+				float z = _get_float();
+				sensors[i] = Vector3(x, y, z);
+			}
+			break;
+		}
+		case GRInputData::InputType::_InputEventMouseMotion: {
+			Ref<InputEventMouseMotion> iemm(memnew(InputEventMouseMotion));
+			iemm->set_device((int)_get_varint());
+			_get_modifiers(iemm);
+			iemm->set_button_mask((int)_get_uvarint());
+			Vector2 pos = _get_pos();
+			iemm->set_position(restore(pos));
+			iemm->set_global_position(restore(pos + _get_vec()));
+			iemm->set_pressure(_get_unorm16());
+			float tilt_x = _get_snorm16();
+			iemm->set_tilt(Vector2(tilt_x, _get_snorm16()));
+			iemm->set_relative(restore_rel(_get_vec()));
+			iemm->set_speed(restore_rel(_get_vec()));
+			event = iemm;
+			break;
+		}
+		case GRInputData::InputType::_InputEventMouseButton: {
+			Ref<InputEventMouseButton> iemb(memnew(InputEventMouseButton));
+			iemb->set_device((int)_get_varint());
+			_get_modifiers(iemb);
+			iemb->set_button_mask((int)_get_uvarint());
+			Vector2 pos = _get_pos();
+			iemb->set_position(restore(pos));
+			iemb->set_global_position(restore(pos + _get_vec()));
+			iemb->set_factor(_get_float());
+			iemb->set_button_index((int)_get_uvarint());
+			uint8_t flags = _get_8();
+			iemb->set_pressed(flags & 1);
+			iemb->set_doubleclick((flags >> 1) & 1);
+			event = iemb;
+			break;
+		}
+		case GRInputData::InputType::_InputEventScreenDrag: {
+			Ref<InputEventScreenDrag> iesd(memnew(InputEventScreenDrag));
+			iesd->set_device((int)_get_varint());
+			iesd->set_index((int)_get_uvarint());
+			iesd->set_position(restore(_get_pos()));
+			iesd->set_relative(restore_rel(_get_vec()));
+			iesd->set_speed(restore_rel(_get_vec()));
+			event = iesd;
+			break;
+		}
+		case GRInputData::InputType::_InputEventScreenTouch: {
+			Ref<InputEventScreenTouch> iest(memnew(InputEventScreenTouch));
+			iest->set_device((int)_get_varint());
+			iest->set_index((int)_get_uvarint());
+			iest->set_pressed(_get_8());
+			iest->set_position(restore(_get_pos()));
+			event = iest;
+			break;
+		}
+		case GRInputData::InputType::_InputEventKey: {
+			Ref<InputEventKey> iek(memnew(InputEventKey));
+			iek->set_device((int)_get_varint());
+			_get_modifiers(iek);
+			uint8_t flags = _get_8();
+			iek->set_pressed(flags & 1);
+			iek->set_echo((flags >> 1) & 1);
+			iek->set_scancode((uint32_t)_get_uvarint());
+			iek->set_unicode((uint32_t)_get_uvarint());
+			event = iek;
+			break;
+		}
+		case GRInputData::InputType::_InputEventMagnifyGesture: {
+			Ref<InputEventMagnifyGesture> iemg(memnew(InputEventMagnifyGesture));
+			iemg->set_device((int)_get_varint());
+			_get_modifiers(iemg);
+			iemg->set_position(restore(_get_pos()));
+			iemg->set_factor(_get_float());
+			event = iemg;
+			break;
+		}
+		case GRInputData::InputType::_InputEventPanGesture: {
+			Ref<InputEventPanGesture> iepg(memnew(InputEventPanGesture));
+			iepg->set_device((int)_get_varint());
+			_get_modifiers(iepg);
+			iepg->set_position(restore(_get_pos()));
+			iepg->set_delta(restore_rel(_get_vec()));
+			event = iepg;
+			break;
+		}
+		case GRInputData::InputType::_InputEventJoypadButton: {
+			Ref<InputEventJoypadButton> iejb(memnew(InputEventJoypadButton));
+			iejb->set_device((int)_get_varint());
+			iejb->set_button_index((int)_get_uvarint());
+			iejb->set_pressure(_get_unorm16());
+			iejb->set_pressed(_get_8());
+			event = iejb;
+			break;
+		}
+		case GRInputData::InputType::_InputEventJoypadMotion: {
+			Ref<InputEventJoypadMotion> iejm(memnew(InputEventJoypadMotion));
+			iejm->set_device((int)_get_varint());
+			iejm->set_axis((int)_get_uvarint());
+			iejm->set_axis_value(_get_snorm16());
+			event = iejm;
+			break;
+		}
+		case GRInputData::InputType::_InputEventAction: {
+			Ref<InputEventAction> iea(memnew(InputEventAction));
+			iea->set_device((int)_get_varint());
+			iea->set_action(_get_string());
+			iea->set_strength(_get_unorm16());
+			iea->set_pressed(_get_8());
+			event = iea;
+			break;
+		}
+		case GRInputData::InputType::_InputEventMIDI: {
+			Ref<InputEventMIDI> iemidi(memnew(InputEventMIDI));
+			iemidi->set_device((int)_get_varint());
+			iemidi->set_channel((int)_get_varint());
+			iemidi->set_message((int)_get_varint());
+			iemidi->set_pitch((int)_get_varint());
+			iemidi->set_velocity((int)_get_varint());
+			iemidi->set_instrument((int)_get_varint());
+			iemidi->set_pressure((int)_get_varint());
+			iemidi->set_controller_number((int)_get_varint());
+			iemidi->set_controller_value((int)_get_varint());
+			event = iemidi;
+			break;
+		}
+		default:
+			ERR_PRINT("Not supported input type in batch: " + str((int)type));
+			error = true;
+			break;
+	}
+
+	if (error) {
+		event.unref();
+		type = GRInputData::InputType::_NoneIT;
+		return false;
+	}
+	return true;
+}
+
+GRInputBatchReader::GRInputBatchReader(const uint8_t *_data, int _size, const Rect2 &_rect) {
+	ptr = _data;
+	end = _data + (_data ? _size : 0);
+	rect = _get_restore_rect(_rect);
+}
+
 #undef fix
 #undef fix_rel
 #undef restore
+#undef restore_rel
 #undef CONSTRUCT
 #undef PARSE
@@ -1,6 +1,8 @@
 /* GRInputData.h */
 #pragma once
 
+#include <vector>
+
 #include "GRUtils.h"
 #include "core/io/stream_peer.h"
 #include "core/os/input_event.h"
@@ -164,4 +166,88 @@ INPUT_EVENT_DATA(GRIEDataMIDI, GRInputDataEvent, InputType::_InputEventMIDI);
 
 #undef INPUT_EVENT_DATA
 
+//////////////////////////////////////////////////////////////////////////
+// PACKED INPUT BATCH
+
+// Compact encoding of many input events in one byte buffer.
+// Each entry starts with an InputType tag and a time delta. Integers are varints,
+// positions are quantized and stored as zigzag deltas from the previous position.
+class GRInputBatchWriter {
+	std::vector<uint8_t> buffer;
+	int32_t prev_pos_x = 0;
+	int32_t prev_pos_y = 0;
+	uint64_t prev_time = 0;
+	int count = 0;
+
+	// stream rect to normalized coordinates
+	Vector2 pos_scale = Vector2(1, 1);
+	Vector2 pos_offset;
+
+	_FORCE_INLINE_ Vector2 _normalize(const Vector2 &val) const { return val * pos_scale + pos_offset; }
+	_FORCE_INLINE_ Vector2 _normalize_rel(const Vector2 &val) const { return val * pos_scale; }
+
+	void _put_8(uint8_t val);
+	void _put_uvarint(uint64_t val);
+	void _put_varint(int64_t val);
+	void _put_float(float val);
+	void _put_unorm16(float val);
+	void _put_snorm16(float val);
+	void _put_pos(const Vector2 &val);
+	void _put_vec(const Vector2 &val);
+	void _put_string(const String &val);
+	void _put_modifiers(const Ref<InputEventWithModifiers> &ev);
+	void _put_header(GRInputData::InputType type, uint64_t time);
+
+public:
+	void clear();
+	void set_stream_rect(const Rect2 &rect);
+	// time is a client ticks_usec when the event happened
+	bool write_event(const Ref<InputEvent> &ev, uint64_t time);
+	// accelerometer, gravity, gyroscope and magnetometer
+	void write_sensors(const Vector3 *sensors, uint64_t time);
+
+	int get_count() const { return count; }
+	int get_size() const { return (int)buffer.size(); }
+	bool is_empty() const { return count == 0; }
+	PoolByteArray get_data() const;
+};
+
+// Reads entries written by GRInputBatchWriter. Events are created directly
+// without intermediate GRInputData objects.
+class GRInputBatchReader {
+	const uint8_t *ptr = nullptr;
+	const uint8_t *end = nullptr;
+	Rect2 rect;
+	int32_t prev_pos_x = 0;
+	int32_t prev_pos_y = 0;
+	uint64_t time = 0;
+	bool error = false;
+
+	GRInputData::InputType type = GRInputData::InputType::_NoneIT;
+	Ref<InputEvent> event;
+	Vector3 sensors[4];
+
+	uint8_t _get_8();
+	uint64_t _get_uvarint();
+	int64_t _get_varint();
+	float _get_float();
+	float _get_unorm16();
+	float _get_snorm16();
+	Vector2 _get_pos();
+	Vector2 _get_vec();
+	String _get_string();
+	void _get_modifiers(const Ref<InputEventWithModifiers> &ev);
+
+public:
+	bool read_next();
+
+	GRInputData::InputType get_type() const { return type; }
+	uint64_t get_time() const { return time; }
+	Ref<InputEvent> get_event() const { return event; }
+	const Vector3 *get_sensors() const { return sensors; }
+	bool has_error() const { return error; }
+
+	GRInputBatchReader(const uint8_t *_data, int _size, const Rect2 &_rect = Rect2());
+};
+
 VARIANT_ENUM_CAST(GRInputData::InputType)
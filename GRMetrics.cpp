@@ -0,0 +1,144 @@
+/* GRMetrics.cpp */
+#include "GRMetrics.h"
+#include "GRDevice.h"
+
+using namespace GRUtils;
+
+//////////////////////////////////////////////////////////////////////////
+// WRITER
+
+void GRMetricsWriter::add_header(const String &name, const String &type, const String &help) {
+	text += "# HELP " + name + " " + help + "\n";
+	text += "# TYPE " + name + " " + type + "\n";
+}
+
+void GRMetricsWriter::add_value(const String &name, double value, const String &extra_labels) {
+	String l = labels;
+	if (!extra_labels.empty())
+		l += (l.empty() ? "" : ",") + extra_labels;
+
+	text += name;
+	if (!l.empty())
+		text += "{" + l + "}";
+
+	// counters are printed without exponent and fraction
+	if (Math::abs(value) < 1e15 && value == Math::floor(value))
+		text += " " + String::num_int64((int64_t)value) + "\n";
+	else
+		text += " " + String::num(value) + "\n";
+}
+
+void GRMetricsWriter::add_metric(const String &name, const String &type, const String &help, double value) {
+	add_header(name, type, help);
+	add_value(name, value);
+}
+
+void GRMetricsWriter::add_summary_values(const String &name, const GRUtils::latency_histogram &hist, const String &extra_labels) {
+	const String sep = extra_labels.empty() ? "" : ",";
+	add_value(name, hist.get_percentile(0.5) / 1000000.0, extra_labels + sep + "quantile=\"0.5\"");
+	add_value(name, hist.get_percentile(0.95) / 1000000.0, extra_labels + sep + "quantile=\"0.95\"");
+	add_value(name, hist.get_percentile(0.99) / 1000000.0, extra_labels + sep + "quantile=\"0.99\"");
+	add_value(name + "_sum", hist.get_sum() / 1000000.0, extra_labels);
+	add_value(name + "_count", (double)hist.get_count(), extra_labels);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SERVER
+
+GRMetricsServer::GRMetricsServer(GRDevice *_dev) {
+	dev = _dev;
+	tcp_server.instance();
+}
+
+GRMetricsServer::~GRMetricsServer() {
+	stop();
+}
+
+Error GRMetricsServer::start(const String &address, uint16_t port) {
+	stop();
+
+	IP_Address bind_address = address.empty() ? IP_Address("127.0.0.1") : IP_Address(address);
+	Error err = tcp_server->listen(port, bind_address);
+	if (err)
+		return err;
+
+	stop_thread = false;
+	thread.start(&_thread_listen, this);
+	return Error::OK;
+}
+
+void GRMetricsServer::stop() {
+	stop_thread = true;
+	thread.wait_to_finish();
+	if (tcp_server->is_listening())
+		tcp_server->stop();
+}
+
+void GRMetricsServer::_thread_listen(THREAD_DATA p_userdata) {
+	Thread::set_name("GR_metrics_thread");
+	GRMetricsServer *ms = (GRMetricsServer *)p_userdata;
+	OS *os = OS::get_singleton();
+
+	while (!ms->stop_thread) {
+		if (ms->tcp_server->is_connection_available()) {
+			ms->_serve(ms->tcp_server->take_connection());
+		} else {
+			os->delay_usec(20_ms);
+		}
+	}
+}
+
+void GRMetricsServer::_serve(Ref<StreamPeerTCP> con) {
+	if (con.is_null())
+		return;
+
+	OS *os = OS::get_singleton();
+	uint64_t start_time = os->get_ticks_usec();
+	String request;
+	uint8_t buf[512];
+
+	// only the request line is needed, headers are skipped
+	while (con->get_status() == StreamPeerTCP::STATUS_CONNECTED && os->get_ticks_usec() - start_time < 1000_ms) {
+		int received = 0;
+		if (con->get_partial_data(buf, sizeof(buf), received) != Error::OK)
+			break;
+
+		if (received == 0) {
+			os->delay_usec(1_ms);
+			continue;
+		}
+
+		request += String::utf8((const char *)buf, received);
+		if (request.find("\r\n\r\n") != -1 || request.find("\n\n") != -1 || request.length() > 8192)
+			break;
+	}
+
+	String line = request.get_slice("\n", 0).strip_edges();
+	String method = line.get_slice(" ", 0);
+	String path = line.get_slice(" ", 1).get_slice("?", 0);
+
+	String status = "200 OK";
+	String body;
+	if (method != "GET") {
+		status = "405 Method Not Allowed";
+		body = "Only GET is supported\n";
+	} else if (path != "/metrics" && path != "/") {
+		status = "404 Not Found";
+		body = "Metrics are available on /metrics\n";
+	} else {
+		GRMetricsWriter w("device=\"" + dev->get_class() + "\"");
+		dev->_write_metrics(w);
+		body = w.get_text();
+	}
+
+	CharString body_data = body.utf8();
+	String header = "HTTP/1.1 " + status + "\r\n";
+	header += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+	header += "Content-Length: " + str(body_data.length()) + "\r\n";
+	header += "Connection: close\r\n\r\n";
+	CharString header_data = header.utf8();
+
+	con->put_data((const uint8_t *)header_data.get_data(), header_data.length());
+	con->put_data((const uint8_t *)body_data.get_data(), body_data.length());
+	con->disconnect_from_host();
+}
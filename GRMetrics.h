@@ -0,0 +1,46 @@
+/* GRMetrics.h */
+#pragma once
+
+#include "GRUtils.h"
+#include "core/io/stream_peer_tcp.h"
+#include "core/io/tcp_server.h"
+
+class GRDevice;
+
+// Page in the Prometheus text format
+class GRMetricsWriter {
+	String text;
+	String labels; // added to every value
+
+public:
+	void add_header(const String &name, const String &type, const String &help);
+	void add_value(const String &name, double value, const String &extra_labels = "");
+	// header with one value
+	void add_metric(const String &name, const String &type, const String &help, double value);
+	// quantiles, sum and count of a summary. values in seconds
+	void add_summary_values(const String &name, const GRUtils::latency_histogram &hist, const String &extra_labels = "");
+
+	String get_text() const { return text; }
+
+	GRMetricsWriter(const String &_labels = "") :
+			labels(_labels) {}
+};
+
+// Tiny HTTP listener serving device stats on /metrics.
+// requests are handled one by one on its own thread, streaming threads only update counters
+class GRMetricsServer {
+	GRDevice *dev = nullptr;
+	Ref<TCP_Server> tcp_server;
+	Thread thread;
+	std::atomic<bool> stop_thread = { false };
+
+	THREAD_FUNC void _thread_listen(THREAD_DATA p_userdata);
+	void _serve(Ref<StreamPeerTCP> con);
+
+public:
+	Error start(const String &address, uint16_t port);
+	void stop();
+
+	GRMetricsServer(GRDevice *_dev);
+	~GRMetricsServer();
+};
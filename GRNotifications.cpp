@@ -112,8 +112,81 @@ void GRNotifications::_set_all_notifications_positions(NotificationsPosition pos
 	}
 }
 
+void GRNotifications::_flush_pending_notifications() {
+	if (!has_pending_notifications.load())
+		return;
+
+	std::vector<PendingNotification> to_show;
+	const uint64_t time = OS::get_singleton()->get_ticks_usec();
+	bool has_pending = false;
+
+	pending_mutex.lock();
+	for (auto it = pending_notifications.begin(); it != pending_notifications.end();) {
+		PendingNotification &pn = it->second;
+		if (time - pn.shown_time < pending_throttle_time) {
+			// wait and collect more repeats
+			has_pending = true;
+			++it;
+		} else if (pn.count) {
+			to_show.push_back(pn);
+			pn.count = 0;
+			pn.shown_time = time;
+			has_pending = true;
+			++it;
+		} else {
+			it = pending_notifications.erase(it);
+		}
+	}
+	has_pending_notifications = has_pending;
+	pending_mutex.unlock();
+
+	std::sort(to_show.begin(), to_show.end(), [](const PendingNotification &a, const PendingNotification &b) { return a.order < b.order; });
+	for (unsigned i = 0; i < to_show.size(); i++) {
+		const PendingNotification &pn = to_show[i];
+		_show_notification(pn.title, pn.text, pn.icon, pn.update_existing, pn.duration_multiplier, pn.count);
+	}
+}
+
+void GRNotifications::_erase_pending_notifications(const String &title) {
+	pending_mutex.lock();
+	if (title.empty()) {
+		pending_notifications.clear();
+	} else {
+		for (auto it = pending_notifications.begin(); it != pending_notifications.end();) {
+			if (it->second.title == title) {
+				it = pending_notifications.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+	pending_mutex.unlock();
+}
+
+GRNotificationPanel *GRNotifications::_get_panel_from_pool() {
+	if (panels_pool.size()) {
+		GRNotificationPanel *np = panels_pool.back();
+		panels_pool.pop_back();
+		return np;
+	}
+	return memnew(GRNotificationPanel);
+}
+
+void GRNotifications::_release_panel(GRNotificationPanel *np) {
+	if ((int)panels_pool.size() >= panels_pool_size || cast_to<GRNotificationPanelUpdatable>(np)) {
+		memdelete(np);
+		return;
+	}
+	np->_reset();
+	panels_pool.push_back(np);
+}
+
 void GRNotifications::_notification(int p_what) {
 	switch (p_what) {
+		case NOTIFICATION_INTERNAL_PROCESS: {
+			_flush_pending_notifications();
+			break;
+		}
 		case NOTIFICATION_EXIT_TREE: {
 			GRNotificationPanel::clear_styles();
 			break;
@@ -247,13 +320,27 @@ void GRNotifications::add_notification_or_update_line(String title, String id, S
 }
 
 void GRNotifications::add_notification(String title, String text, NotificationIcon icon, bool update_existing, float duration_multiplier) {
-	if (singleton) {
-		singleton->call_deferred("_add_notification", title, text, icon, update_existing, duration_multiplier);
+	if (singleton && singleton->notifications_enabled) {
+		// repeated notifications are merged here and shown once per frame on the main thread
+		singleton->pending_mutex.lock();
+		PendingNotification &pn = singleton->pending_notifications[title + "\n" + text];
+		if (pn.count == 0) {
+			pn.title = title;
+			pn.text = text;
+			pn.order = singleton->pending_order++;
+		}
+		pn.icon = icon;
+		pn.update_existing = update_existing;
+		pn.duration_multiplier = duration_multiplier;
+		pn.count++;
+		singleton->has_pending_notifications = true;
+		singleton->pending_mutex.unlock();
 	}
 }
 
 void GRNotifications::remove_notification(String title, bool all_entries) {
 	if (singleton) {
+		singleton->_erase_pending_notifications(title);
 		singleton->call_deferred("_remove_notification", title, all_entries);
 	}
 }
@@ -266,41 +353,67 @@ void GRNotifications::remove_notification_exact(Node *_notif) {
 
 void GRNotifications::clear_notifications() {
 	if (singleton) {
+		singleton->_erase_pending_notifications("");
 		singleton->call_deferred("_clear_notifications");
 	}
 }
 
 void GRNotifications::_add_notification(String title, String text, NotificationIcon icon, bool update_existing, float duration_multiplier) {
+	_show_notification(title, text, icon, update_existing, duration_multiplier, 1);
+}
+
+void GRNotifications::_show_notification(String title, String text, NotificationIcon icon, bool update_existing, float duration_multiplier, int count) {
 	if (!notifications_enabled)
 		return;
 
 	if (notif_list_node && !notif_list_node->is_queued_for_deletion()) {
-		GRNotificationPanel *np;
-		if (update_existing) {
-			np = _get_notification(title);
-			if (np) {
-				_log("Updating existing notification with Title: \"" + title + "\"" + " and Text:\"" + text + "\"", LogLevel::LL_DEBUG);
-				if (notifications_position <= NotificationsPosition::TOP_RIGHT) {
-					notif_list_node->move_child(np, 0);
-				} else {
-					notif_list_node->move_child(np, notif_list_node->get_child_count() - 1);
-				}
-				goto set_new_data;
+		GRNotificationPanel *np = nullptr;
+
+		// same title and text only increase the counter
+		for (int i = (int)notifications.size() - 1; i >= 0; i--) {
+			GRNotificationPanel *p = notifications[i];
+			if (!cast_to<GRNotificationPanelUpdatable>(p) && p->get_title() == title && p->get_text() == text) {
+				np = p;
+				break;
 			}
 		}
 
-		np = memnew(GRNotificationPanel);
-		notif_list_node->add_child(np);
-		if (notifications_position <= NotificationsPosition::TOP_RIGHT)
-			notif_list_node->move_child(np, 0);
-		notifications.push_back(np);
+		if (!np && update_existing) {
+			np = _get_notification(title);
+		}
 
-		_log("New notification added with Title: \"" + title + "\"" + " and Text:\"" + text + "\"", LogLevel::LL_DEBUG);
-		emit_signal("notification_added", title, text);
+		if (np) {
+			if (notifications_position <= NotificationsPosition::TOP_RIGHT) {
+				notif_list_node->move_child(np, 0);
+			} else {
+				notif_list_node->move_child(np, notif_list_node->get_child_count() - 1);
+			}
+
+			if (np->get_text() == text) {
+				np->set_repeat_count(np->get_repeat_count() + count);
+				return;
+			}
 
-	set_new_data:
+			_log("Updating existing notification with Title: \"" + title + "\"" + " and Text:\"" + text + "\"", LogLevel::LL_DEBUG);
+		} else {
+			// oldest panel goes away instead of growing the list
+			if (max_visible_notifications > 0 && (int)notifications.size() >= max_visible_notifications) {
+				_remove_exact_notification(notifications[0]);
+			}
+
+			np = _get_panel_from_pool();
+			notif_list_node->add_child(np);
+			if (notifications_position <= NotificationsPosition::TOP_RIGHT)
+				notif_list_node->move_child(np, 0);
+			notifications.push_back(np);
+
+			_log("New notification added with Title: \"" + title + "\"" + " and Text:\"" + text + "\"", LogLevel::LL_DEBUG);
+			emit_signal("notification_added", title, text);
+		}
 
 		np->set_data(this, title, text, (NotificationIcon)icon, duration_multiplier, style);
+		if (count > 1)
+			np->set_repeat_count(count);
 
 		// FORCE UPDATE SIZE OF CONTEINER
 		notif_list_node->call("_size_changed");
@@ -320,12 +433,12 @@ void GRNotifications::_remove_notification(String title, bool all_entries) {
 
 void GRNotifications::_remove_exact_notification(Node *_notif) {
 	GRNotificationPanel *np = cast_to<GRNotificationPanel>(_notif);
-	if (np) {
+	if (np && std::find(notifications.begin(), notifications.end(), np) != notifications.end()) {
 		emit_signal("notification_removed", np->get_text(), clearing_notifications);
 
 		notif_list_node->remove_child(np);
 		vec_remove_idx(notifications, np);
-		memdelete(np);
+		_release_panel(np);
 
 		// FORCE UPDATE SIZE OF CONTEINER
 		notif_list_node->call("_size_changed");
@@ -334,12 +447,12 @@ void GRNotifications::_remove_exact_notification(Node *_notif) {
 
 void GRNotifications::_clear_notifications() {
 	clearing_notifications = true;
-	for (int i = 0; i < notifications.size(); i++) {
+	for (unsigned i = 0; i < notifications.size(); i++) {
 		GRNotificationPanel *tmp = notifications[i];
 		notif_list_node->remove_child(tmp);
-		vec_remove_idx(notifications, tmp);
-		memdelete(tmp);
+		_release_panel(tmp);
 	}
+	notifications.clear();
 	emit_signal("notifications_cleared");
 	clearing_notifications = false;
 }
@@ -373,6 +486,7 @@ void GRNotifications::_init() {
 	notif_list_node->set_mouse_filter(Control::MouseFilter::MOUSE_FILTER_IGNORE);
 
 	set_notifications_position(notifications_position);
+	set_process_internal(true);
 }
 
 void GRNotifications::_deinit() {
@@ -382,6 +496,13 @@ void GRNotifications::_deinit() {
 	if (this == singleton)
 		singleton = nullptr;
 	call_deferred("_remove_list");
+	_erase_pending_notifications("");
+
+	// pooled panels are not in the tree
+	for (unsigned i = 0; i < panels_pool.size(); i++) {
+		memdelete(panels_pool[i]);
+	}
+	panels_pool.clear();
 
 	notifications.clear();
 	GRNotificationPanel::_default_close_texture.unref();
@@ -542,6 +663,7 @@ void GRNotificationPanel::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_title"), &GRNotificationPanel::get_title);
 	ClassDB::bind_method(D_METHOD("get_text"), &GRNotificationPanel::get_text);
 	ClassDB::bind_method(D_METHOD("update_text", "text"), &GRNotificationPanel::update_text);
+	ClassDB::bind_method(D_METHOD("get_repeat_count"), &GRNotificationPanel::get_repeat_count);
 }
 
 void GRNotificationPanel::clear_styles() {
@@ -573,7 +695,9 @@ void GRNotificationPanel::set_data(GRNotifications *_owner, String title, String
 	owner = _owner;
 	notification_icon = icon;
 	title_node->set_text(title);
-	text_node->set_text(text);
+	repeat_count = 1;
+	_set_text(text);
+	set_modulate(Color(1, 1, 1, 1));
 	duration_mul = duration_multiplier;
 	style = _style;
 
@@ -591,17 +715,46 @@ String GRNotificationPanel::get_title() {
 }
 
 String GRNotificationPanel::get_text() {
-	return text_node->get_text();
+	return base_text;
 }
 
 void GRNotificationPanel::update_text(String text) {
-	text_node->set_text(text);
+	repeat_count = 1;
+	_set_text(text);
+	_setup_tween(tween_node);
+
+	if (!is_hovered)
+		tween_node->start();
+}
+
+int GRNotificationPanel::get_repeat_count() {
+	return repeat_count;
+}
+
+void GRNotificationPanel::set_repeat_count(int count) {
+	repeat_count = count;
+	_set_text(base_text);
 	_setup_tween(tween_node);
 
 	if (!is_hovered)
 		tween_node->start();
 }
 
+void GRNotificationPanel::_set_text(const String &_text) {
+	base_text = _text;
+	text_node->set_text(repeat_count > 1 ? _text + " x" + str(repeat_count) : _text);
+}
+
+void GRNotificationPanel::_reset() {
+	tween_node->stop_all();
+	tween_node->remove_all();
+	set_modulate(Color(1, 1, 1, 1));
+	is_hovered = false;
+	repeat_count = 1;
+	base_text = "";
+	style.unref();
+}
+
 void GRNotificationPanel::_init() {
 	set_name("NotificationPanel");
 
@@ -707,7 +860,7 @@ void GRNotificationPanelUpdatable::_notification(int p_notification) {
 void GRNotificationPanelUpdatable::set_updatable_line(GRNotifications *_owner, String title, String id, String text, GRNotifications::NotificationIcon icon, float duration_multiplier, Ref<GRNotificationStyle> _style) {
 	if (configured) {
 		lines[id] = text;
-		text_node->set_text(_get_text_from_lines());
+		_set_text(_get_text_from_lines());
 
 		_setup_tween(tween_node);
 		if (!is_hovered) {
@@ -718,7 +871,7 @@ void GRNotificationPanelUpdatable::set_updatable_line(GRNotifications *_owner, S
 		notification_icon = icon;
 		lines[id] = text;
 		title_node->set_text(title);
-		text_node->set_text(_get_text_from_lines());
+		_set_text(_get_text_from_lines());
 		duration_mul = duration_multiplier;
 		style = _style;
 
@@ -735,7 +888,7 @@ void GRNotificationPanelUpdatable::set_updatable_line(GRNotifications *_owner, S
 void GRNotificationPanelUpdatable::remove_updatable_line(String id) {
 	if (lines.find(id) != lines.end()) {
 		lines.erase(id);
-		text_node->set_text(_get_text_from_lines());
+		_set_text(_get_text_from_lines());
 
 		_setup_tween(tween_node);
 		if (!is_hovered) {
@@ -746,7 +899,7 @@ void GRNotificationPanelUpdatable::remove_updatable_line(String id) {
 
 void GRNotificationPanelUpdatable::clear_lines() {
 	lines.clear();
-	text_node->set_text(_get_text_from_lines());
+	_set_text(_get_text_from_lines());
 
 	_setup_tween(tween_node);
 	if (!is_hovered) {
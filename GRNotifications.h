@@ -1,6 +1,7 @@
 /* GRNotifications.h */
 #pragma once
 
+#include <map>
 #include <vector>
 
 #include "GRUtils.h"
@@ -36,10 +37,34 @@ public:
 	};
 
 private:
+	// add_notification calls from any thread, merged by title and text
+	struct PendingNotification {
+		String title;
+		String text;
+		NotificationIcon icon = NotificationIcon::ICON_NONE;
+		bool update_existing = true;
+		float duration_multiplier = 1.f;
+		int count = 0;
+		uint64_t order = 0;
+		uint64_t shown_time = 0;
+	};
+
 	static GRNotifications *singleton;
 
 	bool clearing_notifications = false;
 
+	Mutex pending_mutex;
+	std::map<String, PendingNotification> pending_notifications;
+	std::atomic<bool> has_pending_notifications = { false };
+	uint64_t pending_order = 0;
+	// same notification updates panel not more often than this
+	uint64_t pending_throttle_time = 250 * 1000;
+
+	// removed panels are hidden and reused
+	std::vector<GRNotificationPanel *> panels_pool;
+	int panels_pool_size = 16;
+	int max_visible_notifications = 8;
+
 	float notifications_duration = 2.0;
 	bool notifications_enabled = true;
 	NotificationsPosition notifications_position = NotificationsPosition::TOP_LEFT;
@@ -52,6 +77,11 @@ private:
 	GRNotificationPanel *_get_notification(String title);
 
 	void _set_all_notifications_positions(NotificationsPosition pos);
+	void _flush_pending_notifications();
+	void _erase_pending_notifications(const String &title);
+	void _show_notification(String title, String text, NotificationIcon icon, bool update_existing, float duration_multiplier, int count);
+	GRNotificationPanel *_get_panel_from_pool();
+	void _release_panel(GRNotificationPanel *np);
 
 	void _set_notifications_position(NotificationsPosition positon);
 	void _add_notification_or_append_string(String title, String text, NotificationIcon icon, bool new_string, float duration_multiplier);
@@ -110,6 +140,8 @@ protected:
 	GRNotifications::NotificationIcon notification_icon = GRNotifications::NotificationIcon::ICON_NONE;
 	float duration_mul = 1.f;
 	bool is_hovered = false;
+	String base_text;
+	int repeat_count = 1;
 	Ref<GRNotificationStyle> style;
 
 	static Ref<GRNotificationStyle> _default_style;
@@ -131,6 +163,8 @@ protected:
 	void _remove_this_notification();
 	void _setup_tween(Tween *_tween);
 	void _update_style();
+	void _set_text(const String &_text);
+	void _reset();
 
 	static Ref<class GRNotificationStyle> generate_default_style();
 #ifndef NO_GODOTREMOTE_DEFAULT_RESOURCES
@@ -148,6 +182,8 @@ public:
 	String get_title();
 	String get_text();
 	void update_text(String text);
+	int get_repeat_count();
+	void set_repeat_count(int count);
 
 	void _init();
 	void _deinit();
@@ -39,20 +39,34 @@ Ref<GRPacket> GRPacket::create(const PoolByteArray &bytes) {
 			CREATE(GRPacketMouseModeSync);
 		case PacketType::CustomInputScene:
 			CREATE(GRPacketCustomInputScene);
+		case PacketType::CustomInputScenePatch:
+			CREATE(GRPacketCustomInputScenePatch);
+		case PacketType::CustomInputSceneChunk:
+			CREATE(GRPacketCustomInputSceneChunk);
 		case PacketType::ClientStreamOrientation:
 			CREATE(GRPacketClientStreamOrientation);
 		case PacketType::ClientStreamAspect:
 			CREATE(GRPacketClientStreamAspect);
 		case PacketType::CustomUserData:
 			CREATE(GRPacketCustomUserData);
+		case PacketType::CursorShapeSync:
+			CREATE(GRPacketCursorShapeSync);
+		case PacketType::BulkData:
+			CREATE(GRPacketBulkData);
+		case PacketType::Batch:
+			CREATE(GRPacketBatch);
 
 			// Requests
 		case PacketType::Ping:
 			CREATE(GRPacketPing);
+		case PacketType::CustomInputSceneRequest:
+			CREATE(GRPacketCustomInputSceneRequest);
 
 			// Responses
 		case PacketType::Pong:
 			CREATE(GRPacketPong);
+		case PacketType::BulkDataAck:
+			CREATE(GRPacketBulkDataAck);
 		default:
 			ERR_FAIL_V_MSG(Ref<GRPacket>(), "Can't create unknown GRPacket! Type: " + str((int)type));
 	}
@@ -66,12 +80,16 @@ Ref<GRPacket> GRPacket::create(const PoolByteArray &bytes) {
 Ref<StreamPeerBuffer> GRPacketSyncTime::_get_data() {
 	auto buf = GRPacket::_get_data();
 	buf->put_var(OS::get_singleton()->get_ticks_usec());
+	buf->put_64(origin_time);
+	buf->put_64(receive_time);
 	return buf;
 }
 
 bool GRPacketSyncTime::_create(Ref<StreamPeerBuffer> buf) {
 	GRPacket::_create(buf);
 	time = buf->get_var();
+	origin_time = buf->get_64();
+	receive_time = buf->get_64();
 	return true;
 }
 
@@ -79,6 +97,22 @@ uint64_t GRPacketSyncTime::get_time() {
 	return time;
 }
 
+uint64_t GRPacketSyncTime::get_origin_time() {
+	return origin_time;
+}
+
+void GRPacketSyncTime::set_origin_time(uint64_t _time) {
+	origin_time = _time;
+}
+
+uint64_t GRPacketSyncTime::get_receive_time() {
+	return receive_time;
+}
+
+void GRPacketSyncTime::set_receive_time(uint64_t _time) {
+	receive_time = _time;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // IMAGE DATA
 Ref<StreamPeerBuffer> GRPacketImageData::_get_data() {
@@ -90,6 +124,11 @@ Ref<StreamPeerBuffer> GRPacketImageData::_get_data() {
 	buf->put_var(img_data);
 	buf->put_var(start_time);
 	buf->put_var(frametime);
+	buf->put_64(capture_time);
+	buf->put_64(readback_time);
+	buf->put_64(encode_start_time);
+	buf->put_64(encode_end_time);
+	buf->put_32(input_sequence);
 	return buf;
 }
 
@@ -102,6 +141,11 @@ bool GRPacketImageData::_create(Ref<StreamPeerBuffer> buf) {
 	img_data = buf->get_var();
 	start_time = buf->get_var();
 	frametime = buf->get_var();
+	capture_time = buf->get_64();
+	readback_time = buf->get_64();
+	encode_start_time = buf->get_64();
+	encode_end_time = buf->get_64();
+	input_sequence = buf->get_32();
 	return true;
 }
 
@@ -161,6 +205,45 @@ void GRPacketImageData::set_format(int _format) {
 	format = _format;
 }
 
+uint64_t GRPacketImageData::get_capture_time() {
+	return capture_time;
+}
+
+uint64_t GRPacketImageData::get_readback_time() {
+	return readback_time;
+}
+
+uint64_t GRPacketImageData::get_encode_start_time() {
+	return encode_start_time;
+}
+
+uint64_t GRPacketImageData::get_encode_end_time() {
+	return encode_end_time;
+}
+
+uint64_t GRPacketImageData::get_receive_time() {
+	return receive_time;
+}
+
+void GRPacketImageData::set_stage_times(uint64_t _capture, uint64_t _readback, uint64_t _encode_start, uint64_t _encode_end) {
+	capture_time = _capture;
+	readback_time = _readback;
+	encode_start_time = _encode_start;
+	encode_end_time = _encode_end;
+}
+
+void GRPacketImageData::set_receive_time(uint64_t _time) {
+	receive_time = _time;
+}
+
+uint32_t GRPacketImageData::get_input_sequence() {
+	return input_sequence;
+}
+
+void GRPacketImageData::set_input_sequence(uint32_t _seq) {
+	input_sequence = _seq;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // INPUT DATA
 Ref<StreamPeerBuffer> GRPacketInputData::_get_data() {
@@ -181,6 +264,15 @@ Ref<StreamPeerBuffer> GRPacketInputData::_get_data() {
 	for (unsigned i = 0; i < inputs.size(); i++) {
 		buf->put_var(((Ref<GRInputData>)inputs[i])->get_data());
 	}
+
+	buf->put_32(input_batch_count);
+	buf->put_32(input_batch.size());
+	if (input_batch.size()) {
+		auto r = input_batch.read();
+		buf->put_data(r.ptr(), input_batch.size());
+	}
+	buf->put_64(time_offset);
+	buf->put_32(input_sequence);
 	return buf;
 }
 
@@ -193,6 +285,17 @@ bool GRPacketInputData::_create(Ref<StreamPeerBuffer> buf) {
 			return false;
 		inputs.push_back(id);
 	}
+
+	input_batch_count = buf->get_32();
+	int batch_size = buf->get_32();
+	ERR_FAIL_COND_V(batch_size < 0 || batch_size > buf->get_available_bytes(), false);
+	input_batch.resize(batch_size);
+	if (batch_size) {
+		auto w = input_batch.write();
+		buf->get_data(w.ptr(), batch_size);
+	}
+	time_offset = buf->get_64();
+	input_sequence = buf->get_32();
 	return true;
 }
 
@@ -219,6 +322,35 @@ void GRPacketInputData::set_input_data(std::vector<Ref<GRInputData> > &_inputs)
 	inputs = _inputs;
 }
 
+PoolByteArray GRPacketInputData::get_input_batch() {
+	return input_batch;
+}
+
+int GRPacketInputData::get_input_batch_count() {
+	return input_batch_count;
+}
+
+void GRPacketInputData::set_input_batch(const PoolByteArray &_batch, int _count) {
+	input_batch = _batch;
+	input_batch_count = _count;
+}
+
+int64_t GRPacketInputData::get_time_offset() {
+	return time_offset;
+}
+
+void GRPacketInputData::set_time_offset(int64_t _offset) {
+	time_offset = _offset;
+}
+
+uint32_t GRPacketInputData::get_input_sequence() {
+	return input_sequence;
+}
+
+void GRPacketInputData::set_input_sequence(uint32_t _seq) {
+	input_sequence = _seq;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // SERVER SETTINGS
 Ref<StreamPeerBuffer> GRPacketServerSettings::_get_data() {
@@ -267,12 +399,80 @@ void GRPacketMouseModeSync::set_mouse_mode(Input::MouseMode _mode) {
 	mouse_mode = _mode;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// CURSOR SHAPE SYNC
+
+Ref<StreamPeerBuffer> GRPacketCursorShapeSync::_get_data() {
+	auto buf = GRPacket::_get_data();
+	buf->put_8(shape);
+	buf->put_float(hotspot.x);
+	buf->put_float(hotspot.y);
+	buf->put_float(screen_size.x);
+	buf->put_float(screen_size.y);
+	buf->put_32(image.size());
+	if (image.size()) {
+		auto r = image.read();
+		buf->put_data(r.ptr(), image.size());
+	}
+	return buf;
+}
+
+bool GRPacketCursorShapeSync::_create(Ref<StreamPeerBuffer> buf) {
+	GRPacket::_create(buf);
+	shape = (Input::CursorShape)buf->get_8();
+	hotspot.x = buf->get_float();
+	hotspot.y = buf->get_float();
+	screen_size.x = buf->get_float();
+	screen_size.y = buf->get_float();
+	int size = buf->get_32();
+	ERR_FAIL_COND_V(size < 0 || size > buf->get_available_bytes(), false);
+	image.resize(size);
+	if (size) {
+		auto w = image.write();
+		buf->get_data(w.ptr(), size);
+	}
+	return true;
+}
+
+Input::CursorShape GRPacketCursorShapeSync::get_shape() {
+	return shape;
+}
+
+void GRPacketCursorShapeSync::set_shape(Input::CursorShape _shape) {
+	shape = _shape;
+}
+
+Vector2 GRPacketCursorShapeSync::get_hotspot() {
+	return hotspot;
+}
+
+void GRPacketCursorShapeSync::set_hotspot(Vector2 _hotspot) {
+	hotspot = _hotspot;
+}
+
+Size2 GRPacketCursorShapeSync::get_screen_size() {
+	return screen_size;
+}
+
+void GRPacketCursorShapeSync::set_screen_size(Size2 _size) {
+	screen_size = _size;
+}
+
+PoolByteArray GRPacketCursorShapeSync::get_image() {
+	return image;
+}
+
+void GRPacketCursorShapeSync::set_image(PoolByteArray _image) {
+	image = _image;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // CUSTOM INPUT SCENE
 
 Ref<StreamPeerBuffer> GRPacketCustomInputScene::_get_data() {
 	auto buf = GRPacket::_get_data();
 	buf->put_string(scene_path);
+	buf->put_string(scene_hash);
 	buf->put_8(compressed);
 	buf->put_8(compression_type);
 	buf->put_32(original_data_size);
@@ -283,6 +483,7 @@ Ref<StreamPeerBuffer> GRPacketCustomInputScene::_get_data() {
 bool GRPacketCustomInputScene::_create(Ref<StreamPeerBuffer> buf) {
 	GRPacket::_create(buf);
 	scene_path = buf->get_string();
+	scene_hash = buf->get_string();
 	compressed = buf->get_8();
 	compression_type = buf->get_8();
 	original_data_size = buf->get_32();
@@ -298,6 +499,14 @@ void GRPacketCustomInputScene::set_scene_path(String _path) {
 	scene_path = _path;
 }
 
+String GRPacketCustomInputScene::get_scene_hash() {
+	return scene_hash;
+}
+
+void GRPacketCustomInputScene::set_scene_hash(String _hash) {
+	scene_hash = _hash;
+}
+
 PoolByteArray GRPacketCustomInputScene::get_scene_data() {
 	return scene_data;
 }
@@ -330,6 +539,72 @@ void GRPacketCustomInputScene::set_compression_type(int val) {
 	compression_type = val;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// CUSTOM INPUT SCENE PATCH
+
+Ref<StreamPeerBuffer> GRPacketCustomInputScenePatch::_get_data() {
+	auto buf = GRPacketCustomInputScene::_get_data();
+	buf->put_string(base_hash);
+	buf->put_var(changed_files);
+	return buf;
+}
+
+bool GRPacketCustomInputScenePatch::_create(Ref<StreamPeerBuffer> buf) {
+	GRPacketCustomInputScene::_create(buf);
+	base_hash = buf->get_string();
+	changed_files = buf->get_var();
+	return true;
+}
+
+String GRPacketCustomInputScenePatch::get_base_hash() {
+	return base_hash;
+}
+
+void GRPacketCustomInputScenePatch::set_base_hash(String _hash) {
+	base_hash = _hash;
+}
+
+PoolStringArray GRPacketCustomInputScenePatch::get_changed_files() {
+	return changed_files;
+}
+
+void GRPacketCustomInputScenePatch::set_changed_files(PoolStringArray _files) {
+	changed_files = _files;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// CUSTOM INPUT SCENE CHUNK
+
+Ref<StreamPeerBuffer> GRPacketCustomInputSceneChunk::_get_data() {
+	auto buf = GRPacketCustomInputScene::_get_data();
+	buf->put_32(offset);
+	buf->put_32(total_size);
+	return buf;
+}
+
+bool GRPacketCustomInputSceneChunk::_create(Ref<StreamPeerBuffer> buf) {
+	GRPacketCustomInputScene::_create(buf);
+	offset = buf->get_32();
+	total_size = buf->get_32();
+	return true;
+}
+
+int GRPacketCustomInputSceneChunk::get_offset() {
+	return offset;
+}
+
+void GRPacketCustomInputSceneChunk::set_offset(int _offset) {
+	offset = _offset;
+}
+
+int GRPacketCustomInputSceneChunk::get_total_size() {
+	return total_size;
+}
+
+void GRPacketCustomInputSceneChunk::set_total_size(int _size) {
+	total_size = _size;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // CLIENT DEVICE ROTATION
 
@@ -383,6 +658,30 @@ Ref<StreamPeerBuffer> GRPacketCustomUserData::_get_data() {
 	auto buf = GRPacket::_get_data();
 	buf->put_string(packet_id);
 	buf->put_8(full_objects);
+
+	// small payloads are not worth compressing
+	if (compression_type != -1) {
+		int len = 0;
+		Error err = encode_variant(user_data, nullptr, len, full_objects);
+		if (err == Error::OK && len > 128) {
+			PoolByteArray raw, com;
+			raw.resize(len);
+			{
+				auto w = raw.write();
+				encode_variant(user_data, w.ptr(), len, full_objects);
+			}
+
+			if (compress_bytes(raw, com, compression_type) == Error::OK && com.size() < len) {
+				buf->put_8(true);
+				buf->put_8(compression_type);
+				buf->put_32(len);
+				buf->put_var(com);
+				return buf;
+			}
+		}
+	}
+
+	buf->put_8(false);
 	buf->put_var(user_data, full_objects);
 	return buf;
 }
@@ -391,7 +690,23 @@ bool GRPacketCustomUserData::_create(Ref<StreamPeerBuffer> buf) {
 	GRPacket::_create(buf);
 	packet_id = buf->get_string();
 	full_objects = buf->get_8();
-	user_data = buf->get_var(full_objects);
+
+	if (buf->get_8()) {
+		compression_type = buf->get_8();
+		int len = buf->get_32();
+		PoolByteArray com = buf->get_var();
+		PoolByteArray raw;
+
+		Error err = decompress_bytes(com, len, raw, compression_type);
+		ERR_FAIL_COND_V_MSG(err, false, "Can't decompress user data");
+
+		auto r = raw.read();
+		err = decode_variant(user_data, r.ptr(), len, nullptr, full_objects);
+		ERR_FAIL_COND_V_MSG(err, false, "Can't decode user data");
+	} else {
+		compression_type = -1;
+		user_data = buf->get_var(full_objects);
+	}
 	return true;
 }
 
@@ -418,3 +733,225 @@ Variant GRPacketCustomUserData::get_user_data() {
 void GRPacketCustomUserData::set_user_data(Variant val) {
 	user_data = val;
 }
+
+int GRPacketCustomUserData::get_compression_type() {
+	return compression_type;
+}
+
+void GRPacketCustomUserData::set_compression_type(int val) {
+	compression_type = val;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BULK DATA
+
+Ref<StreamPeerBuffer> GRPacketBulkData::_get_data() {
+	auto buf = GRPacket::_get_data();
+	buf->put_32(channel);
+	buf->put_8(flags);
+	if (flags & FLAG_OPEN) {
+		buf->put_string(name);
+		buf->put_64(total_size);
+	}
+	buf->put_64(offset);
+	buf->put_32(data_size);
+	if (data_size) {
+		auto r = data.read();
+		buf->put_data(r.ptr() + data_from, data_size);
+	}
+	return buf;
+}
+
+bool GRPacketBulkData::_create(Ref<StreamPeerBuffer> buf) {
+	GRPacket::_create(buf);
+	channel = buf->get_32();
+	flags = buf->get_8();
+	if (flags & FLAG_OPEN) {
+		name = buf->get_string();
+		total_size = buf->get_64();
+	}
+	offset = buf->get_64();
+	data_from = 0;
+	data_size = buf->get_32();
+	ERR_FAIL_COND_V_MSG(data_size < 0 || data_size > buf->get_available_bytes(), false, "Incorrect size of bulk data");
+
+	data.resize(data_size);
+	if (data_size) {
+		auto w = data.write();
+		return buf->get_data(w.ptr(), data_size) == Error::OK;
+	}
+	return true;
+}
+
+uint32_t GRPacketBulkData::get_channel() {
+	return channel;
+}
+
+void GRPacketBulkData::set_channel(uint32_t val) {
+	channel = val;
+}
+
+uint8_t GRPacketBulkData::get_flags() {
+	return flags;
+}
+
+void GRPacketBulkData::set_flags(uint8_t val) {
+	flags = val;
+}
+
+String GRPacketBulkData::get_name() {
+	return name;
+}
+
+void GRPacketBulkData::set_name(String val) {
+	name = val;
+}
+
+uint64_t GRPacketBulkData::get_total_size() {
+	return total_size;
+}
+
+void GRPacketBulkData::set_total_size(uint64_t val) {
+	total_size = val;
+}
+
+uint64_t GRPacketBulkData::get_offset() {
+	return offset;
+}
+
+void GRPacketBulkData::set_offset(uint64_t val) {
+	offset = val;
+}
+
+PoolByteArray GRPacketBulkData::get_bulk_data() {
+	if (data_from == 0 && data_size == data.size())
+		return data;
+	return data.subarray(data_from, data_from + data_size - 1);
+}
+
+void GRPacketBulkData::set_bulk_data(const PoolByteArray &_data, int from, int size) {
+	if (size < 0)
+		size = _data.size() - from;
+	ERR_FAIL_COND(from < 0 || from + size > _data.size());
+
+	data = _data;
+	data_from = from;
+	data_size = size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BATCH
+
+Ref<StreamPeerBuffer> GRPacketBatch::_get_data() {
+	auto buf = GRPacket::_get_data();
+	buf->put_32((int)packets.size());
+	for (int i = 0; i < (int)packets.size(); i++) {
+		auto r = packets[i].read();
+		buf->put_32(packets[i].size());
+		buf->put_data(r.ptr(), packets[i].size());
+	}
+	return buf;
+}
+
+bool GRPacketBatch::_create(Ref<StreamPeerBuffer> buf) {
+	GRPacket::_create(buf);
+	int count = buf->get_32();
+	packets.clear();
+	for (int i = 0; i < count; i++) {
+		int size = buf->get_32();
+		ERR_FAIL_COND_V_MSG(size <= 0 || size > buf->get_available_bytes(), false, "Incorrect size of batched packet");
+
+		PoolByteArray data;
+		data.resize(size);
+		{
+			auto w = data.write();
+			if (buf->get_data(w.ptr(), size) != Error::OK)
+				return false;
+		}
+		packets.push_back(data);
+	}
+	return true;
+}
+
+void GRPacketBatch::add_packet(const PoolByteArray &data) {
+	packets.push_back(data);
+}
+
+int GRPacketBatch::get_packets_count() {
+	return (int)packets.size();
+}
+
+PoolByteArray GRPacketBatch::get_packet_data(int idx) {
+	ERR_FAIL_INDEX_V(idx, (int)packets.size(), PoolByteArray());
+	return packets[idx];
+}
+
+void GRPacketBatch::clear() {
+	packets.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// CUSTOM INPUT SCENE REQUEST
+
+Ref<StreamPeerBuffer> GRPacketCustomInputSceneRequest::_get_data() {
+	auto buf = GRPacket::_get_data();
+	buf->put_string(scene_hash);
+	return buf;
+}
+
+bool GRPacketCustomInputSceneRequest::_create(Ref<StreamPeerBuffer> buf) {
+	GRPacket::_create(buf);
+	scene_hash = buf->get_string();
+	return true;
+}
+
+String GRPacketCustomInputSceneRequest::get_scene_hash() {
+	return scene_hash;
+}
+
+void GRPacketCustomInputSceneRequest::set_scene_hash(String _hash) {
+	scene_hash = _hash;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BULK DATA ACK
+
+Ref<StreamPeerBuffer> GRPacketBulkDataAck::_get_data() {
+	auto buf = GRPacket::_get_data();
+	buf->put_32(channel);
+	buf->put_64(received);
+	buf->put_8(rejected);
+	return buf;
+}
+
+bool GRPacketBulkDataAck::_create(Ref<StreamPeerBuffer> buf) {
+	GRPacket::_create(buf);
+	channel = buf->get_32();
+	received = buf->get_64();
+	rejected = buf->get_8();
+	return true;
+}
+
+uint32_t GRPacketBulkDataAck::get_channel() {
+	return channel;
+}
+
+void GRPacketBulkDataAck::set_channel(uint32_t val) {
+	channel = val;
+}
+
+uint64_t GRPacketBulkDataAck::get_received() {
+	return received;
+}
+
+void GRPacketBulkDataAck::set_received(uint64_t val) {
+	received = val;
+}
+
+bool GRPacketBulkDataAck::is_rejected() {
+	return rejected;
+}
+
+void GRPacketBulkDataAck::set_rejected(bool val) {
+	rejected = val;
+}
@@ -23,12 +23,19 @@ public:
 		ClientStreamOrientation = 7,
 		ClientStreamAspect = 8,
 		CustomUserData = 9,
+		CursorShapeSync = 10,
+		CustomInputScenePatch = 11,
+		CustomInputSceneChunk = 12,
+		BulkData = 13,
+		Batch = 14,
 
 		// Requests
 		Ping = 128,
+		CustomInputSceneRequest = 129,
 
 		// Responses
 		Pong = 192,
+		BulkDataAck = 193,
 	};
 
 protected:
@@ -43,8 +50,15 @@ protected:
 		BIND_ENUM_CONSTANT(ClientStreamOrientation);
 		BIND_ENUM_CONSTANT(ClientStreamAspect);
 		BIND_ENUM_CONSTANT(CustomUserData);
+		BIND_ENUM_CONSTANT(CursorShapeSync);
+		BIND_ENUM_CONSTANT(CustomInputScenePatch);
+		BIND_ENUM_CONSTANT(CustomInputSceneChunk);
+		BIND_ENUM_CONSTANT(BulkData);
+		BIND_ENUM_CONSTANT(Batch);
 		BIND_ENUM_CONSTANT(Ping);
+		BIND_ENUM_CONSTANT(CustomInputSceneRequest);
 		BIND_ENUM_CONSTANT(Pong);
+		BIND_ENUM_CONSTANT(BulkDataAck);
 	}
 	virtual Ref<StreamPeerBuffer> _get_data() {
 		Ref<StreamPeerBuffer> buf(memnew(StreamPeerBuffer));
@@ -66,11 +80,15 @@ public:
 
 //////////////////////////////////////////////////////////////////////////
 // SyncTime
+// client sends it periodically, server replies with the request time and its own times.
+// server also sends one without origin time right after connecting
 class GRPacketSyncTime : public GRPacket {
 	GDCLASS(GRPacketSyncTime, GRPacket);
 	friend GRPacket;
 
-	uint64_t time = 0;
+	uint64_t time = 0; // when packet was sent. set on serialization
+	uint64_t origin_time = 0; // time of the request
+	uint64_t receive_time = 0; // when the request was received
 
 protected:
 	virtual Ref<StreamPeerBuffer> _get_data() override;
@@ -80,6 +98,10 @@ public:
 	virtual PacketType get_type() override { return PacketType::SyncTime; };
 
 	uint64_t get_time();
+	uint64_t get_origin_time();
+	void set_origin_time(uint64_t _time);
+	uint64_t get_receive_time();
+	void set_receive_time(uint64_t _time);
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -96,6 +118,16 @@ class GRPacketImageData : public GRPacket {
 	uint64_t frametime = 0;
 	bool is_empty = false;
 
+	// server times of the frame stages
+	uint64_t capture_time = 0;
+	uint64_t readback_time = 0;
+	uint64_t encode_start_time = 0;
+	uint64_t encode_end_time = 0;
+	// last input batch applied before the frame was drawn
+	uint32_t input_sequence = 0;
+	// client time, not sent
+	uint64_t receive_time = 0;
+
 protected:
 	virtual Ref<StreamPeerBuffer> _get_data() override;
 	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
@@ -118,6 +150,16 @@ public:
 	void set_start_time(uint64_t time);
 	void set_frametime(uint64_t _frametime);
 	void set_is_empty(bool _empty);
+
+	uint64_t get_capture_time();
+	uint64_t get_readback_time();
+	uint64_t get_encode_start_time();
+	uint64_t get_encode_end_time();
+	uint64_t get_receive_time();
+	void set_stage_times(uint64_t _capture, uint64_t _readback, uint64_t _encode_start, uint64_t _encode_end);
+	void set_receive_time(uint64_t _time);
+	uint32_t get_input_sequence();
+	void set_input_sequence(uint32_t _seq);
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -127,6 +169,10 @@ class GRPacketInputData : public GRPacket {
 	friend GRPacket;
 
 	std::vector<Ref<GRInputData>> inputs;
+	PoolByteArray input_batch;
+	int input_batch_count = 0;
+	int64_t time_offset = 0;
+	uint32_t input_sequence = 0;
 
 protected:
 	virtual Ref<StreamPeerBuffer> _get_data() override;
@@ -140,6 +186,17 @@ public:
 	void remove_input_data(int idx);
 	void add_input_data(Ref<GRInputData> &input);
 	void set_input_data(std::vector<Ref<GRInputData> > &_inputs);
+
+	// Packed events from GRInputBatchWriter
+	PoolByteArray get_input_batch();
+	int get_input_batch_count();
+	void set_input_batch(const PoolByteArray &_batch, int _count);
+	// difference between server and client clocks, added to batch timestamps
+	int64_t get_time_offset();
+	void set_time_offset(int64_t _offset);
+	// incremented by the client for every sent batch
+	uint32_t get_input_sequence();
+	void set_input_sequence(uint32_t _seq);
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -181,6 +238,34 @@ public:
 	void set_mouse_mode(Input::MouseMode _mode);
 };
 
+//////////////////////////////////////////////////////////////////////////
+// CURSOR SHAPE SYNC
+class GRPacketCursorShapeSync : public GRPacket {
+	GDCLASS(GRPacketCursorShapeSync, GRPacket);
+	friend GRPacket;
+
+	Input::CursorShape shape = Input::CURSOR_ARROW;
+	Vector2 hotspot;
+	Size2 screen_size; // server window size, the image is in its pixels
+	PoolByteArray image; // PNG, empty for the system cursor
+
+protected:
+	virtual Ref<StreamPeerBuffer> _get_data() override;
+	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
+
+public:
+	virtual PacketType get_type() override { return PacketType::CursorShapeSync; };
+
+	Input::CursorShape get_shape();
+	void set_shape(Input::CursorShape _shape);
+	Vector2 get_hotspot();
+	void set_hotspot(Vector2 _hotspot);
+	Size2 get_screen_size();
+	void set_screen_size(Size2 _size);
+	PoolByteArray get_image();
+	void set_image(PoolByteArray _image);
+};
+
 //////////////////////////////////////////////////////////////////////////
 // CUSTOM INPUT SCENE
 class GRPacketCustomInputScene : public GRPacket {
@@ -188,9 +273,10 @@ class GRPacketCustomInputScene : public GRPacket {
 	friend GRPacket;
 
 	String scene_path;
-	bool compressed;
-	int compression_type;
-	int original_data_size;
+	String scene_hash; // content hash, pack without data only announces it
+	bool compressed = false;
+	int compression_type = 0;
+	int original_data_size = 0;
 	PoolByteArray scene_data;
 
 protected:
@@ -202,6 +288,8 @@ public:
 
 	String get_scene_path();
 	void set_scene_path(String _path);
+	String get_scene_hash();
+	void set_scene_hash(String _hash);
 	PoolByteArray get_scene_data();
 	void set_scene_data(PoolByteArray _data);
 	bool is_compressed();
@@ -212,6 +300,49 @@ public:
 	void set_compression_type(int val);
 };
 
+// only files changed since the pack with base_hash
+class GRPacketCustomInputScenePatch : public GRPacketCustomInputScene {
+	GDCLASS(GRPacketCustomInputScenePatch, GRPacketCustomInputScene);
+	friend GRPacket;
+
+	String base_hash;
+	PoolStringArray changed_files;
+
+protected:
+	virtual Ref<StreamPeerBuffer> _get_data() override;
+	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
+
+public:
+	virtual PacketType get_type() override { return PacketType::CustomInputScenePatch; };
+
+	String get_base_hash();
+	void set_base_hash(String _hash);
+	PoolStringArray get_changed_files();
+	void set_changed_files(PoolStringArray _files);
+};
+
+// part of the pack. each chunk is compressed on its own,
+// original_size is the size of this chunk after decompression
+class GRPacketCustomInputSceneChunk : public GRPacketCustomInputScene {
+	GDCLASS(GRPacketCustomInputSceneChunk, GRPacketCustomInputScene);
+	friend GRPacket;
+
+	int offset = 0;
+	int total_size = 0;
+
+protected:
+	virtual Ref<StreamPeerBuffer> _get_data() override;
+	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
+
+public:
+	virtual PacketType get_type() override { return PacketType::CustomInputSceneChunk; };
+
+	int get_offset();
+	void set_offset(int _offset);
+	int get_total_size();
+	void set_total_size(int _size);
+};
+
 //////////////////////////////////////////////////////////////////////////
 // CLIENT DEVICE ROTATION
 class GRPacketClientStreamOrientation : public GRPacket {
@@ -259,6 +390,7 @@ class GRPacketCustomUserData : public GRPacket {
 	Variant packet_id;
 	bool full_objects = false;
 	Variant user_data;
+	int compression_type = -1; // -1 - not compressed, otherwise Compression::Mode
 
 protected:
 	virtual Ref<StreamPeerBuffer> _get_data() override;
@@ -273,6 +405,76 @@ public:
 	void set_send_full_objects(bool val);
 	Variant get_user_data();
 	void set_user_data(Variant val);
+	int get_compression_type();
+	void set_compression_type(int val);
+};
+
+//////////////////////////////////////////////////////////////////////////
+// BULK DATA
+// part of a stream opened with GRDevice::open_bulk_channel.
+// payload is written directly from the source array without extra copies
+class GRPacketBulkData : public GRPacket {
+	GDCLASS(GRPacketBulkData, GRPacket);
+	friend GRPacket;
+
+public:
+	enum Flags {
+		FLAG_OPEN = 1,
+		FLAG_CLOSE = 2,
+		FLAG_CANCEL = 4,
+	};
+
+private:
+	uint32_t channel = 0;
+	uint8_t flags = 0;
+	String name; // only with FLAG_OPEN
+	uint64_t total_size = 0; // only with FLAG_OPEN
+	uint64_t offset = 0;
+	PoolByteArray data;
+	int data_from = 0;
+	int data_size = 0;
+
+protected:
+	virtual Ref<StreamPeerBuffer> _get_data() override;
+	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
+
+public:
+	virtual PacketType get_type() override { return PacketType::BulkData; };
+
+	uint32_t get_channel();
+	void set_channel(uint32_t val);
+	uint8_t get_flags();
+	void set_flags(uint8_t val);
+	String get_name();
+	void set_name(String val);
+	uint64_t get_total_size();
+	void set_total_size(uint64_t val);
+	uint64_t get_offset();
+	void set_offset(uint64_t val);
+	PoolByteArray get_bulk_data();
+	void set_bulk_data(const PoolByteArray &_data, int from = 0, int size = -1);
+};
+
+//////////////////////////////////////////////////////////////////////////
+// BATCH
+// small packets of one loop iteration sent with a single write
+class GRPacketBatch : public GRPacket {
+	GDCLASS(GRPacketBatch, GRPacket);
+	friend GRPacket;
+
+	std::vector<PoolByteArray> packets;
+
+protected:
+	virtual Ref<StreamPeerBuffer> _get_data() override;
+	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
+
+public:
+	virtual PacketType get_type() override { return PacketType::Batch; };
+
+	void add_packet(const PoolByteArray &data);
+	int get_packets_count();
+	PoolByteArray get_packet_data(int idx);
+	void clear();
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -298,4 +500,48 @@ BASIC_PACKET(GRPacketPong, PacketType::Pong);
 
 #undef BASIC_PACKET
 
+// client asks for the pack data when it's not in the local cache
+class GRPacketCustomInputSceneRequest : public GRPacket {
+	GDCLASS(GRPacketCustomInputSceneRequest, GRPacket);
+	friend GRPacket;
+
+	String scene_hash;
+
+protected:
+	virtual Ref<StreamPeerBuffer> _get_data() override;
+	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
+
+public:
+	virtual PacketType get_type() override { return PacketType::CustomInputSceneRequest; };
+
+	String get_scene_hash();
+	void set_scene_hash(String _hash);
+};
+
+// receiver reports how many bytes of the channel it got
+class GRPacketBulkDataAck : public GRPacket {
+	GDCLASS(GRPacketBulkDataAck, GRPacket);
+	friend GRPacket;
+
+	uint32_t channel = 0;
+	uint64_t received = 0;
+	bool rejected = false;
+
+protected:
+	virtual Ref<StreamPeerBuffer> _get_data() override;
+	virtual bool _create(Ref<StreamPeerBuffer> buf) override;
+
+public:
+	virtual PacketType get_type() override { return PacketType::BulkDataAck; };
+
+	uint32_t get_channel();
+	void set_channel(uint32_t val);
+	// bytes read by the receiver
+	uint64_t get_received();
+	void set_received(uint64_t val);
+	// receiver dropped the channel
+	bool is_rejected();
+	void set_rejected(bool val);
+};
+
 VARIANT_ENUM_CAST(GRPacket::PacketType)
@@ -3,20 +3,25 @@
 #ifndef NO_GODOTREMOTE_SERVER
 
 #include "GRServer.h"
+#include "GRMetrics.h"
 #include "GRNotifications.h"
 #include "GRPacket.h"
 #include "GodotRemote.h"
+#include "core/crypto/crypto_core.h"
+#include "core/hashfuncs.h"
 #include "core/input_map.h"
-#include "core/io/pck_packer.h"
 #include "core/io/resource_loader.h"
 #include "core/os/dir_access.h"
 #include "core/os/file_access.h"
 #include "core/os/input_event.h"
 #include "core/os/thread_safe.h"
+#include "core/version.h"
 #include "main/input_default.h"
 #include "modules/regex/regex.h"
 #include "scene/main/node.h"
 #include "scene/main/scene_tree.h"
+#include "scene/resources/texture.h"
+#include "servers/visual_server.h"
 
 using namespace GRUtils;
 
@@ -33,9 +38,12 @@ void GRServer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_jpg_quality"), &GRServer::set_jpg_quality);
 	ClassDB::bind_method(D_METHOD("set_render_scale"), &GRServer::set_render_scale);
 	ClassDB::bind_method(D_METHOD("set_password", "password"), &GRServer::set_password);
+	ClassDB::bind_method(D_METHOD("set_accumulate_input", "accumulate"), &GRServer::set_accumulate_input);
+	ClassDB::bind_method(D_METHOD("set_custom_cursor", "cursor", "shape", "hotspot"), &GRServer::set_custom_cursor, DEFVAL(Input::CURSOR_ARROW), DEFVAL(Vector2()));
 	ClassDB::bind_method(D_METHOD("set_custom_input_scene", "_scn"), &GRServer::set_custom_input_scene);
 	ClassDB::bind_method(D_METHOD("set_custom_input_scene_compressed", "_is_compressed"), &GRServer::set_custom_input_scene_compressed);
 	ClassDB::bind_method(D_METHOD("set_custom_input_scene_compression_type", "_type"), &GRServer::set_custom_input_scene_compression_type);
+	ClassDB::bind_method(D_METHOD("set_custom_input_scene_live_sync", "_val"), &GRServer::set_custom_input_scene_live_sync);
 
 	ClassDB::bind_method(D_METHOD("is_video_stream_enabled"), &GRServer::is_video_stream_enabled);
 	ClassDB::bind_method(D_METHOD("get_skip_frames"), &GRServer::get_skip_frames);
@@ -43,9 +51,11 @@ void GRServer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_jpg_quality"), &GRServer::get_jpg_quality);
 	ClassDB::bind_method(D_METHOD("get_render_scale"), &GRServer::get_render_scale);
 	ClassDB::bind_method(D_METHOD("get_password"), &GRServer::get_password);
+	ClassDB::bind_method(D_METHOD("is_accumulate_input"), &GRServer::is_accumulate_input);
 	ClassDB::bind_method(D_METHOD("get_custom_input_scene"), &GRServer::get_custom_input_scene);
 	ClassDB::bind_method(D_METHOD("is_custom_input_scene_compressed"), &GRServer::is_custom_input_scene_compressed);
 	ClassDB::bind_method(D_METHOD("get_custom_input_scene_compression_type"), &GRServer::get_custom_input_scene_compression_type);
+	ClassDB::bind_method(D_METHOD("is_custom_input_scene_live_sync"), &GRServer::is_custom_input_scene_live_sync);
 
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "video_stream_enabled"), "set_video_stream_enabled", "is_video_stream_enabled");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "skip_frames"), "set_skip_frames", "get_skip_frames");
@@ -53,9 +63,11 @@ void GRServer::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "jpg_quality"), "set_jpg_quality", "get_jpg_quality");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "render_scale"), "set_render_scale", "get_render_scale");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "password"), "set_password", "get_password");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "accumulate_input"), "set_accumulate_input", "is_accumulate_input");
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "custom_input_scene"), "set_custom_input_scene", "get_custom_input_scene");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "custom_input_scene_compressed"), "set_custom_input_scene_compressed", "is_custom_input_scene_compressed");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "custom_input_scene_compression_type"), "set_custom_input_scene_compression_type", "get_custom_input_scene_compression_type");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "custom_input_scene_live_sync"), "set_custom_input_scene_live_sync", "is_custom_input_scene_live_sync");
 
 	ADD_SIGNAL(MethodInfo("client_connected", PropertyInfo(Variant::STRING, "device_id")));
 	ADD_SIGNAL(MethodInfo("client_disconnected", PropertyInfo(Variant::STRING, "device_id")));
@@ -77,6 +89,30 @@ void GRServer::_notification(int p_notification) {
 				_internal_call_only_deffered_stop();
 			}
 		} break;
+		// called before _process of other nodes
+		case NOTIFICATION_INTERNAL_PROCESS: {
+			_inject_queued_input();
+			_update_interpolated_sensors();
+			// Input must be used only by the main thread
+			current_cursor_shape = (int)Input::get_singleton()->get_current_cursor_shape();
+			current_mouse_mode = (int)Input::get_singleton()->get_mouse_mode();
+			// written only here, so it can be compared without the lock
+			if (cursor_screen_size != OS::get_singleton()->get_window_size()) {
+				cursor_mutex.lock();
+				cursor_screen_size = OS::get_singleton()->get_window_size();
+				custom_cursors_version++;
+				cursor_mutex.unlock();
+			}
+
+			// cheap check of modification times, pack is rebuilt only if files changed
+			if (custom_input_scene_live_sync && !custom_input_scene.empty()) {
+				uint64_t time = OS::get_singleton()->get_ticks_usec();
+				if (time - prev_live_sync_check_time > 1000_ms) {
+					prev_live_sync_check_time = time;
+					_request_custom_input_pack_build();
+				}
+			}
+		} break;
 		case NOTIFICATION_CRASH: {
 		} break;
 	}
@@ -174,9 +210,54 @@ String GRServer::get_password() {
 	return password;
 }
 
+void GRServer::set_accumulate_input(bool _val) {
+	accumulate_input = _val;
+}
+
+bool GRServer::is_accumulate_input() {
+	return accumulate_input;
+}
+
+void GRServer::set_custom_cursor(const Ref<Resource> &cursor, int shape, Vector2 hotspot) {
+	ERR_FAIL_INDEX(shape, Input::CURSOR_MAX);
+
+	PoolByteArray data;
+	if (cursor.is_valid()) {
+		Ref<Image> img = cursor;
+		Ref<Texture> tex = cursor;
+		if (img.is_null() && tex.is_valid()) {
+			img = tex->get_data();
+		}
+		ERR_FAIL_COND_MSG(img.is_null(), "Cursor must be an Image or a Texture.");
+
+		if (img->is_compressed()) {
+			img = img->duplicate();
+			img->decompress();
+		}
+		data = img->save_png_to_buffer();
+	}
+
+	// local cursor stays the same as on the client
+	Input::get_singleton()->set_custom_mouse_cursor(cursor, (Input::CursorShape)shape, hotspot);
+
+	cursor_mutex.lock();
+	if (data.size()) {
+		CustomCursor c;
+		c.image = data;
+		c.hotspot = hotspot;
+		custom_cursors[shape] = c;
+	} else {
+		custom_cursors.erase(shape);
+	}
+	custom_cursors_version++;
+	cursor_mutex.unlock();
+}
+
 void GRServer::set_custom_input_scene(String _scn) {
 	if (custom_input_scene != _scn) {
+		custom_input_pack_mutex.lock();
 		custom_input_scene = _scn;
+		custom_input_pack_mutex.unlock();
 		force_update_custom_input_scene();
 	}
 }
@@ -186,7 +267,10 @@ String GRServer::get_custom_input_scene() {
 }
 
 void GRServer::set_custom_input_scene_compressed(bool _is_compressed) {
-	custom_input_pck_compressed = _is_compressed;
+	if (custom_input_pck_compressed != _is_compressed) {
+		custom_input_pck_compressed = _is_compressed;
+		_request_custom_input_pack_build();
+	}
 }
 
 bool GRServer::is_custom_input_scene_compressed() {
@@ -194,19 +278,31 @@ bool GRServer::is_custom_input_scene_compressed() {
 }
 
 void GRServer::set_custom_input_scene_compression_type(int _type) {
-	custom_input_pck_compression_type = (Compression::Mode)_type;
+	if (custom_input_pck_compression_type != (Compression::Mode)_type) {
+		custom_input_pck_compression_type = (Compression::Mode)_type;
+		_request_custom_input_pack_build();
+	}
 }
 
 int GRServer::get_custom_input_scene_compression_type() {
 	return custom_input_pck_compression_type;
 }
 
+void GRServer::set_custom_input_scene_live_sync(bool _val) {
+	custom_input_pack_mutex.lock();
+	custom_input_scene_live_sync = _val;
+	custom_input_pack_mutex.unlock();
+}
+
+bool GRServer::is_custom_input_scene_live_sync() {
+	return custom_input_scene_live_sync;
+}
+
 void GRServer::_init() {
 	set_name("GodotRemoteServer");
 	LEAVE_IF_EDITOR();
 	tcp_server.instance();
-	custom_input_scene_regex_resource_finder.instance();
-	custom_input_scene_regex_resource_finder->compile(custom_input_scene_regex_resource_finder_pattern);
+	custom_input_dependency_index.init();
 	init_server_utils();
 }
 
@@ -216,7 +312,8 @@ void GRServer::_deinit() {
 		_internal_call_only_deffered_stop();
 	}
 	deinit_server_utils();
-	custom_input_scene_regex_resource_finder.unref();
+	_wait_custom_input_pack_build();
+	custom_input_dependency_index.deinit();
 	tcp_server.unref();
 }
 
@@ -249,7 +346,10 @@ void GRServer::_internal_call_only_deffered_start() {
 	server_thread_listen = memnew(ListenerThreadParamsServer(this));
 	server_thread_listen->thread.start(&_thread_listen, server_thread_listen);
 
+	set_process_internal(true);
 	set_status(WorkingStatus::STATUS_WORKING);
+	_start_metrics_server();
+	_request_custom_input_pack_build();
 	call_deferred("_load_settings");
 
 	GRNotifications::add_notification("Godot Remote Server Status", "Server started", GRNotifications::NotificationIcon::ICON_SUCCESS);
@@ -269,6 +369,7 @@ void GRServer::_internal_call_only_deffered_stop() {
 
 	set_status(WorkingStatus::STATUS_STOPPING);
 	_log("Stopping GodotRemote server", LogLevel::LL_NORMAL);
+	_stop_metrics_server();
 
 	if (server_thread_listen) {
 		server_thread_listen->close_thread();
@@ -281,7 +382,12 @@ void GRServer::_internal_call_only_deffered_stop() {
 	}
 	call_deferred("_remove_resize_viewport", resize_viewport);
 	resize_viewport = nullptr;
-	_send_queue_resize(0);
+	_send_queue_clear();
+	set_process_internal(false);
+	input_queue.clear();
+	sensors_samples.clear();
+	sensors_clock_synced = false;
+	_wait_custom_input_pack_build();
 	set_status(WorkingStatus::STATUS_STOPPED);
 
 	GRNotifications::add_notification("Godot Remote Server Status", "Server stopped", GRNotifications::NotificationIcon::ICON_FAIL);
@@ -300,12 +406,145 @@ void GRServer::_on_grviewport_deleting() {
 	resize_viewport = nullptr;
 }
 
+void GRServer::_inject_queued_input() {
+	GR_TRACE_SCOPE("inject_input");
+	Input *input = Input::get_singleton();
+	Ref<InputEvent> prev;
+	QueuedInput qi;
+
+	while (input_queue.pop(qi)) {
+		if (resize_viewport) {
+			resize_viewport->injected_input_sequence = qi.input_sequence;
+		}
+
+		if (qi.type == GRInputData::InputType::_InputDeviceSensors) {
+			_push_sensors_sample(qi);
+			continue;
+		}
+
+		if (qi.event.is_null())
+			continue;
+
+		// time of the event on the client converted to server ticks_usec
+		qi.event->set_meta("gr_time_usec", qi.time);
+
+		if (accumulate_input && prev.is_valid() && prev->accumulate(qi.event)) {
+			prev->set_meta("gr_time_usec", qi.time);
+			continue;
+		}
+
+		if (prev.is_valid()) {
+			input->parse_input_event(prev);
+		}
+		prev = qi.event;
+	}
+
+	if (prev.is_valid()) {
+		input->parse_input_event(prev);
+	}
+}
+
+static const int64_t sensors_playback_delay = 50_ms;
+
+void GRServer::_push_sensors_sample(const QueuedInput &qi) {
+	// samples are change-driven so the gaps between them can be long,
+	// but they must go in order
+	if (!sensors_samples.empty() && qi.time <= sensors_samples.back().time)
+		return;
+
+	// anchor playback to the new sample when client clock jumps or at start
+	int64_t now = (int64_t)OS::get_singleton()->get_ticks_usec();
+	int64_t play_time = now - sensors_clock_offset;
+	int64_t sample_time = (int64_t)qi.time;
+	if (!sensors_clock_synced || play_time > sample_time + sensors_playback_delay * 4 || play_time < sample_time - sensors_playback_delay * 4) {
+		sensors_clock_offset = now - sample_time + sensors_playback_delay;
+		sensors_clock_synced = true;
+	}
+	sensors_last_sample_applied = false;
+
+	SensorsSample s;
+	s.time = qi.time;
+	for (int i = 0; i < 4; i++) {
+		s.values[i] = qi.sensors[i];
+	}
+	sensors_samples.push_back(s);
+
+	while (sensors_samples.size() > 64) {
+		sensors_samples.pop_front();
+	}
+}
+
+void GRServer::_update_interpolated_sensors() {
+	// values of the last sample stay until a new one comes
+	if (sensors_samples.empty() || sensors_last_sample_applied)
+		return;
+
+	int64_t play_time = (int64_t)OS::get_singleton()->get_ticks_usec() - sensors_clock_offset;
+
+	while (sensors_samples.size() > 1 && (int64_t)sensors_samples[1].time <= play_time) {
+		sensors_samples.pop_front();
+	}
+
+	const SensorsSample &a = sensors_samples[0];
+	Vector3 s[4];
+	if (sensors_samples.size() == 1) {
+		for (int i = 0; i < 4; i++) {
+			s[i] = a.values[i];
+		}
+		sensors_last_sample_applied = true;
+	} else if (play_time <= (int64_t)a.time) {
+		for (int i = 0; i < 4; i++) {
+			s[i] = a.values[i];
+		}
+	} else {
+		const SensorsSample &b = sensors_samples[1];
+		float t = float(play_time - (int64_t)a.time) / float(b.time - a.time);
+		for (int i = 0; i < 4; i++) {
+			s[i] = a.values[i].linear_interpolate(b.values[i], t);
+		}
+	}
+
+	set_accelerometer(s[0]);
+	set_gravity(s[1]);
+	set_gyroscope(s[2]);
+	set_magnetometer(s[3]);
+}
+
 GRSViewport *GRServer::get_gr_viewport() {
 	return resize_viewport;
 }
 
 void GRServer::force_update_custom_input_scene() {
-	custom_input_scene_was_updated = false;
+	_request_custom_input_pack_build(true);
+}
+
+void GRServer::_request_custom_input_pack_build(bool force) {
+	if (get_status() != (int)WorkingStatus::STATUS_WORKING)
+		return;
+
+	custom_input_pack_mutex.lock();
+	custom_input_pack_dirty = true;
+	custom_input_pack_force |= force;
+	custom_input_pack_mutex.unlock();
+
+	if (!custom_input_pack_thread.is_started()) {
+		custom_input_pack_stop = false;
+		custom_input_pack_thread.start(&_thread_build_custom_input_pack, this);
+	}
+	custom_input_pack_semaphore.post();
+}
+
+void GRServer::_wait_custom_input_pack_build() {
+	if (!custom_input_pack_thread.is_started())
+		return;
+
+	custom_input_pack_mutex.lock();
+	custom_input_pack_dirty = false;
+	custom_input_pack_stop = true;
+	custom_input_pack_mutex.unlock();
+
+	custom_input_pack_semaphore.post();
+	custom_input_pack_thread.wait_to_finish();
 }
 
 void GRServer::_adjust_viewport_scale() {
@@ -326,7 +565,7 @@ void GRServer::_adjust_viewport_scale() {
 	} else {
 		prev_avg_fps = (prev_avg_fps * smooth) + (avg_fps * (1.f - smooth));
 	}
-	_log(prev_avg_fps, LogLevel::LL_NORMAL);
+	_log(prev_avg_fps, LogLevel::LL_DEBUG);
 
 	if (prev_avg_fps < resize_viewport->get_skip_frames() - 4) {
 		scale -= 0.001f;
@@ -353,9 +592,11 @@ void GRServer::_load_settings() {
 
 	// only updated by server itself
 	password = GET_PS(GodotRemote::ps_server_password_name);
+	accumulate_input = GET_PS(GodotRemote::ps_server_accumulate_input_name);
 	set_custom_input_scene(GET_PS(GodotRemote::ps_server_custom_input_scene_name));
 	set_custom_input_scene_compressed(GET_PS(GodotRemote::ps_server_custom_input_scene_compressed_name));
 	set_custom_input_scene_compression_type((int)GET_PS(GodotRemote::ps_server_custom_input_scene_compression_type_name));
+	set_custom_input_scene_live_sync(GET_PS(GodotRemote::ps_server_custom_input_scene_live_sync_name));
 
 	GRNotifications::add_notification_or_update_line(title, "cis", "Custom input scene: " + str(get_custom_input_scene()));
 	if (!get_custom_input_scene().empty()) {
@@ -467,12 +708,18 @@ void GRServer::_reset_counters() {
 	prev_avg_fps = 0;
 }
 
+void GRServer::_write_metrics(GRMetricsWriter &w) {
+	GRDevice::_write_metrics(w);
+	w.add_metric("godot_remote_connected_clients", "gauge", "Number of connected clients", client_connected.load());
+}
+
 //////////////////////////////////////////////
 ////////////////// STATIC ////////////////////
 //////////////////////////////////////////////
 
 void GRServer::_thread_listen(THREAD_DATA p_userdata) {
 	Thread::set_name("GR_listen_thread");
+	GR_THREAD_CPU_SCOPE("server_listen");
 	ListenerThreadParamsServer *this_thread_info = (ListenerThreadParamsServer *)p_userdata;
 	GRServer *dev = this_thread_info->dev;
 	Ref<TCP_Server> srv = dev->tcp_server;
@@ -575,7 +822,6 @@ void GRServer::_thread_listen(THREAD_DATA p_userdata) {
 						connection_thread_info->device_id = dev_id;
 						connection_thread_info->ppeer = ppeer;
 
-						dev->custom_input_scene_was_updated = false;
 						dev->client_connected++;
 
 						connection_thread_info->thread.start(&_thread_connection, connection_thread_info);
@@ -624,16 +870,27 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 	Ref<PacketPeerStream> ppeer = thread_info->ppeer;
 	GRServer *dev = thread_info->dev;
 	dev->_reset_counters();
-	dev->_send_queue_resize(0);
+	dev->_send_queue_clear();
+	dev->recv_batch.clear();
+
+	// sequences of the new client start from the beginning
+	dev->input_queue.push(QueuedInput());
 
 	// GodotRemote *gr = GodotRemote::get_singleton();
 	OS *os = OS::get_singleton();
-	Input *input = Input::get_singleton();
 	Error err = Error::OK;
 
 	Input::MouseMode mouse_mode = Input::MOUSE_MODE_VISIBLE;
+	Input::CursorShape cursor_shape = Input::CURSOR_ARROW;
+	uint32_t cursor_version = 0;
+	uint32_t custom_input_pack_version = 0;
+	std::vector<PoolByteArray> custom_input_pack_chunks;
+	int next_custom_input_pack_chunk = 0;
+	bool cursor_synced = false;
 	String address = CONNECTION_ADDRESS(connection);
 	Thread::set_name("GR_connection " + address);
+	GRUtils::trace_set_thread_name("server_connection");
+	GR_THREAD_CPU_SCOPE("server_connection");
 
 	uint64_t time64 = os->get_ticks_usec();
 	uint64_t prev_send_settings_time = time64;
@@ -645,6 +902,7 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 	bool ping_sended = false;
 	bool time_synced = false;
 
+	GRPacketWriter writer(ppeer, &dev->sent_traffic);
 	TimeCountInit();
 	while (!thread_info->break_connection && connection.is_valid() &&
 			!connection->is_queued_for_deletion() && connection->is_connected_to_host()) {
@@ -681,7 +939,7 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 			nothing_happens = false;
 			//prev_send_sync_time = time;
 			Ref<GRPacketSyncTime> pack(memnew(GRPacketSyncTime));
-			err = ppeer->put_var(pack->get_data());
+			err = writer.put(pack->get_data());
 			if (err) {
 				_log("Can't send sync time data! Code: " + str(err), LogLevel::LL_ERROR);
 				goto end_send;
@@ -694,11 +952,13 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 		// if image compressed and data is ready
 		if (dev->resize_viewport && !dev->resize_viewport->is_queued_for_deletion() &&
 				dev->resize_viewport->has_compressed_image_data()) {
+			GR_TRACE_SCOPE("send_image");
 			nothing_happens = false;
 
 			Ref<GRPacketImageData> pack(memnew(GRPacketImageData));
 
 			auto ips = dev->resize_viewport->get_last_compressed_image_data();
+			dev->dropped_frames += dev->resize_viewport->dropped_frames.exchange(0);
 
 			if (!(ips->ret_data.size() == 0) || ips->is_empty) { // if not broken image or force empty image :)
 				pack->set_is_empty(ips->is_empty);
@@ -708,8 +968,31 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 				pack->set_image_data(ips->ret_data);
 				pack->set_start_time(os->get_ticks_usec());
 				pack->set_frametime(send_data_time_us);
-
-				err = ppeer->put_var(pack->get_data());
+				pack->set_stage_times(ips->capture_time, ips->readback_time, ips->encode_start_time, ips->encode_end_time);
+				pack->set_input_sequence(ips->input_sequence);
+
+				err = writer.put(pack->get_data());
+
+				if (!ips->is_empty) {
+					uint64_t send_time = os->get_ticks_usec();
+					Dictionary lb;
+					lb["readback"] = (ips->readback_time - ips->capture_time) / 1000.0;
+					lb["encode_wait"] = (ips->encode_start_time - ips->readback_time) / 1000.0;
+					lb["encode"] = (ips->encode_end_time - ips->encode_start_time) / 1000.0;
+					lb["send_wait"] = (pack->get_start_time() - ips->encode_end_time) / 1000.0;
+					lb["send"] = (send_time - pack->get_start_time()) / 1000.0;
+					lb["total"] = (send_time - ips->capture_time) / 1000.0;
+					dev->_set_latency_breakdown(lb);
+
+					dev->_add_stage_time(STAGE_CAPTURE, ips->readback_time - ips->capture_time);
+					if (ips->convert_end_time) {
+						dev->_add_stage_time(STAGE_CONVERT, ips->convert_end_time - ips->encode_start_time);
+						dev->_add_stage_time(STAGE_ENCODE, ips->encode_end_time - ips->convert_end_time);
+					}
+					dev->_add_stage_time(STAGE_QUEUE_WAIT, pack->get_start_time() - ips->encode_end_time);
+					dev->_add_stage_time(STAGE_SEND, send_time - pack->get_start_time());
+					dev->_update_frame_stats(ips->ret_data.size(), ips->encode_end_time - ips->encode_start_time);
+				}
 
 				// avg fps
 				dev->_update_avg_fps(time64 - prev_send_image_time);
@@ -747,7 +1030,7 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 				pack->add_setting((int)TypesOfServerSettings::SERVER_SETTINGS_RENDER_SCALE, dev->get_render_scale());
 				pack->add_setting((int)TypesOfServerSettings::SERVER_SETTINGS_SKIP_FRAMES, dev->get_skip_frames());
 
-				err = ppeer->put_var(pack->get_data());
+				err = writer.put(pack->get_data());
 				if (err) {
 					_log("Send server settings failed with code: " + str(err), LogLevel::LL_ERROR);
 					goto end_send;
@@ -757,14 +1040,14 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 		}
 
 		// MOUSE MODE
-		if (input->get_mouse_mode() != mouse_mode) {
+		if ((Input::MouseMode)dev->current_mouse_mode.load() != mouse_mode) {
 			nothing_happens = false;
-			mouse_mode = input->get_mouse_mode();
+			mouse_mode = (Input::MouseMode)dev->current_mouse_mode.load();
 
 			Ref<GRPacketMouseModeSync> pack(memnew(GRPacketMouseModeSync));
 			pack->set_mouse_mode(mouse_mode);
 
-			err = ppeer->put_var(pack->get_data());
+			err = writer.put(pack->get_data());
 			if (err) {
 				_log("Send mouse mode sync failed with code: " + str(err), LogLevel::LL_ERROR);
 				goto end_send;
@@ -772,6 +1055,42 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 			TimeCount("Send image data");
 		}
 
+		// CURSOR
+		// client draws the cursor itself at its own pointer position
+		{
+			Input::CursorShape shape = (Input::CursorShape)dev->current_cursor_shape.load();
+
+			dev->cursor_mutex.lock();
+			uint32_t version = dev->custom_cursors_version;
+			bool changed = !cursor_synced || shape != cursor_shape || version != cursor_version;
+			Ref<GRPacketCursorShapeSync> pack;
+			if (changed) {
+				pack.instance();
+				pack->set_shape(shape);
+				pack->set_screen_size(dev->cursor_screen_size);
+				auto c = dev->custom_cursors.find((int)shape);
+				if (c != dev->custom_cursors.end()) {
+					pack->set_image(c->second.image);
+					pack->set_hotspot(c->second.hotspot);
+				}
+			}
+			dev->cursor_mutex.unlock();
+
+			if (changed) {
+				nothing_happens = false;
+				cursor_shape = shape;
+				cursor_version = version;
+				cursor_synced = true;
+
+				err = writer.put(pack->get_data());
+				if (err) {
+					_log("Send cursor shape failed with code: " + str(err), LogLevel::LL_ERROR);
+					goto end_send;
+				}
+				TimeCount("Send cursor shape");
+			}
+		}
+
 		// PING
 		time64 = os->get_ticks_usec();
 		if ((time64 - prev_ping_sending_time) > 100_ms && !ping_sended) {
@@ -779,7 +1098,7 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 			ping_sended = true;
 
 			Ref<GRPacketPing> pack(memnew(GRPacketPing));
-			err = ppeer->put_var(pack->get_data());
+			err = writer.put(pack->get_data());
 
 			prev_ping_sending_time = time64;
 			if (err) {
@@ -790,43 +1109,93 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 		}
 
 		// CUSTOM INPUT SCENE
-		if (!dev->custom_input_scene_was_updated) {
-			dev->custom_input_scene_was_updated = true;
+		// announce the prebuilt pack when a new version is ready
+		{
+			dev->custom_input_pack_mutex.lock();
+			PoolByteArray custom_input_pack_info;
+			if (custom_input_pack_version != dev->custom_input_pack_version) {
+				// this client has the previous version, so send only changed files
+				if (custom_input_pack_version && custom_input_pack_version == dev->custom_input_pack_patch_base_version &&
+						dev->custom_input_pack_patch_data.size()) {
+					custom_input_pack_info = dev->custom_input_pack_patch_data;
+				} else {
+					custom_input_pack_info = dev->custom_input_pack_info_data;
+				}
+				custom_input_pack_version = dev->custom_input_pack_version;
 
-			Ref<GRPacketCustomInputScene> pack;
-			if (!dev->custom_input_scene.empty()) {
-				pack = dev->_create_custom_input_pack(dev->custom_input_scene, dev->custom_input_pck_compressed, dev->custom_input_pck_compression_type);
-			} else {
-				pack.instance();
+				// transfer of the old version is useless now
+				custom_input_pack_chunks.clear();
+				next_custom_input_pack_chunk = 0;
+			}
+			dev->custom_input_pack_mutex.unlock();
+
+			if (custom_input_pack_info.size()) {
+				nothing_happens = false;
+				err = writer.put(custom_input_pack_info);
+
+				if (err) {
+					_log("Send custom input failed with code: " + str(err), LogLevel::LL_ERROR);
+					goto end_send;
+				}
+				TimeCount("Custom input");
 			}
 
-			err = ppeer->put_var(pack->get_data());
+			// one chunk per cycle so video and pings are not blocked
+			if (next_custom_input_pack_chunk < (int)custom_input_pack_chunks.size()) {
+				nothing_happens = false;
+				err = writer.put(custom_input_pack_chunks[next_custom_input_pack_chunk++]);
 
+				if (err) {
+					_log("Send custom input chunk failed with code: " + str(err), LogLevel::LL_ERROR);
+					goto end_send;
+				}
+				if (next_custom_input_pack_chunk == (int)custom_input_pack_chunks.size()) {
+					custom_input_pack_chunks.clear();
+					next_custom_input_pack_chunk = 0;
+				}
+				TimeCount("Custom input chunk");
+			}
+		}
+
+		// BULK DATA
+		// limited by the window of each channel and the bandwidth limit
+		{
+			bool bulk_sent = false;
+			err = dev->_bulk_send(writer, send_data_time_us / 4, bulk_sent);
+			if (bulk_sent) {
+				nothing_happens = false;
+			}
 			if (err) {
-				_log("Send custom input failed with code: " + str(err), LogLevel::LL_ERROR);
+				_log("Send bulk data failed with code: " + str(err), LogLevel::LL_ERROR);
 				goto end_send;
 			}
-			TimeCount("Custom input");
 		}
 
 		// SEND QUEUE
-		while (!dev->send_queue.empty() && (os->get_ticks_usec() - start_while_time) <= send_data_time_us / 2) {
-			is_queued_send = true;
+		while ((os->get_ticks_usec() - start_while_time) <= send_data_time_us / 2) {
 			Ref<GRPacket> packet = dev->_send_queue_pop_front();
+			if (packet.is_null())
+				break;
 
-			if (packet.is_valid()) {
-				err = ppeer->put_var(packet->get_data());
+			is_queued_send = true;
+			err = writer.put(packet->get_data());
 
-				if ((int)err) {
-					_log("Put data from queue failed with code: " + str((int)err), LogLevel::LL_ERROR);
-					goto end_send;
-				}
+			if ((int)err) {
+				_log("Put data from queue failed with code: " + str((int)err), LogLevel::LL_ERROR);
+				goto end_send;
 			}
 		}
 		if (is_queued_send)
 			TimeCount("Send queued data");
 
 	end_send:
+		// small packets of this iteration go out with one write
+		err = writer.flush();
+		if (err) {
+			_log("Can't send batched packets. Code: " + str(err), LogLevel::LL_ERROR);
+			thread_info->break_connection = true;
+			continue;
+		}
 
 		if (!connection->is_connected_to_host()) {
 			_log("Lost connection after sending!", LogLevel::LL_ERROR);
@@ -837,19 +1206,18 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 		///////////////////////////////////////////////////////////////////
 		// RECEIVING
 		uint64_t recv_start_time = os->get_ticks_usec();
-		while (connection->is_connected_to_host() && ppeer->get_available_packet_count() > 0 &&
+		while (connection->is_connected_to_host() && dev->_has_incoming_packets(ppeer) &&
 				(os->get_ticks_usec() - recv_start_time) < send_data_time_us / 2) {
+			GR_TRACE_SCOPE("receive_packet");
 			nothing_happens = false;
-			Variant res;
-			err = ppeer->get_var(res);
+			Ref<GRPacket> pack;
+			err = dev->_get_incoming_packet(ppeer, pack);
 
 			if (err) {
 				_log("Can't receive packet!", LogLevel::LL_ERROR);
 				continue;
 			}
 
-			//_log(str_arr((PoolByteArray)res, true));
-			Ref<GRPacket> pack = GRPacket::create(res);
 			if (pack.is_null()) {
 				_log("Received packet was NULL", LogLevel::LL_ERROR);
 				continue;
@@ -860,7 +1228,22 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 
 			switch (type) {
 				case GRPacket::PacketType::SyncTime: {
-					ERR_PRINT("NOT IMPLEMENTED");
+					Ref<GRPacketSyncTime> data = pack;
+					if (data.is_null()) {
+						_log("Incorrect GRPacketSyncTime", LogLevel::LL_ERROR);
+						break;
+					}
+
+					// reply for the clock estimation on the client
+					Ref<GRPacketSyncTime> reply = newref(GRPacketSyncTime);
+					reply->set_origin_time(data->get_time());
+					reply->set_receive_time(os->get_ticks_usec());
+					err = dev->_put_packet(ppeer, reply->get_data());
+
+					if (err) {
+						_log("Send sync time reply failed with code: " + str(err), LogLevel::LL_ERROR);
+						goto end_recv;
+					}
 					break;
 				}
 				case GRPacket::PacketType::ImageData: {
@@ -874,10 +1257,17 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 						break;
 					}
 
+					// events are injected on the main thread in _inject_queued_input
+					uint64_t recv_time = os->get_ticks_usec();
 					for (int i = 0; i < data->get_inputs_count(); i++) {
 						Ref<GRInputData> id = data->get_input_data(i);
 						GRInputData::InputType ev_type = id->get_type();
 
+						QueuedInput qi;
+						qi.type = ev_type;
+						qi.time = recv_time;
+						qi.input_sequence = data->get_input_sequence();
+
 						if (ev_type >= GRInputData::InputType::_InputEvent) {
 							Ref<GRInputDataEvent> ied = id;
 							if (ied.is_null()) {
@@ -885,9 +1275,9 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 								continue;
 							}
 
-							Ref<InputEvent> ev = ied->construct_event();
-							if (ev.is_valid()) {
-								Input::get_singleton()->call_deferred("parse_input_event", ev);
+							qi.event = ied->construct_event();
+							if (qi.event.is_valid()) {
+								dev->input_queue.push(qi);
 							}
 						} else {
 							switch (ev_type) {
@@ -903,10 +1293,10 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 									}
 
 									auto s = sd->get_sensors();
-									set_accelerometer(s[0]);
-									set_gravity(s[1]);
-									set_gyroscope(s[2]);
-									set_magnetometer(s[3]);
+									for (int j = 0; j < 4 && j < s.size(); j++) {
+										qi.sensors[j] = s[j];
+									}
+									dev->input_queue.push(qi);
 
 									break;
 								}
@@ -918,6 +1308,30 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 							}
 						}
 					}
+
+					PoolByteArray batch = data->get_input_batch();
+					if (batch.size()) {
+						auto r = batch.read();
+						GRInputBatchReader reader(r.ptr(), batch.size());
+						while (reader.read_next()) {
+							QueuedInput qi;
+							qi.type = reader.get_type();
+							qi.time = reader.get_time() + data->get_time_offset();
+							qi.input_sequence = data->get_input_sequence();
+							if (qi.type == GRInputData::InputType::_InputDeviceSensors) {
+								const Vector3 *s = reader.get_sensors();
+								for (int j = 0; j < 4; j++) {
+									qi.sensors[j] = s[j];
+								}
+							} else {
+								qi.event = reader.get_event();
+							}
+							dev->input_queue.push(qi);
+						}
+						if (reader.has_error()) {
+							_log("Malformed input batch", LogLevel::LL_ERROR);
+						}
+					}
 					break;
 				}
 				case GRPacket::PacketType::ServerSettings: {
@@ -958,7 +1372,7 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 				}
 				case GRPacket::PacketType::Ping: {
 					Ref<GRPacketPong> ppack(memnew(GRPacketPong));
-					err = ppeer->put_var(ppack->get_data());
+					err = dev->_put_packet(ppeer, ppack->get_data());
 
 					if (err) {
 						_log("Send pong failed with code: " + str(err), LogLevel::LL_ERROR);
@@ -966,6 +1380,32 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 					}
 					break;
 				}
+				case GRPacket::PacketType::CustomInputSceneRequest: {
+					Ref<GRPacketCustomInputSceneRequest> data = pack;
+					if (data.is_null()) {
+						_log("Incorrect GRPacketCustomInputSceneRequest", LogLevel::LL_ERROR);
+						break;
+					}
+
+					// outdated requests are ignored, client will get a new announcement.
+					// chunks are sent later together with other packets
+					dev->custom_input_pack_mutex.lock();
+					if (data->get_scene_hash() == dev->custom_input_pack_hash) {
+						custom_input_pack_chunks = dev->custom_input_pack_chunks;
+						next_custom_input_pack_chunk = 0;
+					}
+					dev->custom_input_pack_mutex.unlock();
+					break;
+				}
+				case GRPacket::PacketType::BulkData:
+				case GRPacket::PacketType::BulkDataAck: {
+					err = dev->_bulk_receive(pack);
+					if (err) {
+						_log("Incorrect bulk data packet", LogLevel::LL_ERROR);
+						err = Error::OK;
+					}
+					break;
+				}
 				case GRPacket::PacketType::Pong: {
 					dev->_update_avg_ping(os->get_ticks_usec() - prev_ping_sending_time);
 					ping_sended = false;
@@ -1007,7 +1447,9 @@ void GRServer::_thread_connection(THREAD_DATA p_userdata) {
 	thread_info->ppeer.unref();
 	thread_info->break_connection = true;
 	dev->client_connected--;
-	dev->_send_queue_resize(0);
+	dev->_send_queue_clear();
+	dev->recv_batch.clear();
+	dev->_bulk_reset();
 
 	dev->call_deferred("_load_settings");
 	dev->call_deferred("emit_signal", "client_disconnected", thread_info->device_id);
@@ -1118,167 +1560,433 @@ timeout:
 #undef packet_error_check
 }
 
-Ref<GRPacketCustomInputScene> GRServer::_create_custom_input_pack(String _scene_path, bool compress, Compression::Mode compression_type) {
-	Ref<GRPacketCustomInputScene> pack = memnew(GRPacketCustomInputScene);
-	std::vector<String> files;
-	_scan_resource_for_dependencies_recursive(_scene_path, files);
+void GRServer::_thread_build_custom_input_pack(THREAD_DATA p_userdata) {
+	GRServer *dev = (GRServer *)p_userdata;
+	CustomInputPackState &state = dev->custom_input_pack_state;
+	Thread::set_name("GR_custom_input_pack");
 
-	if (files.size()) {
-		String pck_file = _scene_path.get_base_dir() + "tmp.pck";
-		Ref<PCKPacker> pck = memnew(PCKPacker);
-		Error err = pck->pck_start(pck_file);
+	while (true) {
+		dev->custom_input_pack_semaphore.wait();
 
-		if (err) {
-			_log("Can't create PCK file. Code: " + str(err), LogLevel::LL_ERROR);
-		} else {
+		dev->custom_input_pack_mutex.lock();
+		if (dev->custom_input_pack_stop) {
+			dev->custom_input_pack_mutex.unlock();
+			break;
+		}
+		// several requests may be merged into one build
+		if (!dev->custom_input_pack_dirty) {
+			dev->custom_input_pack_mutex.unlock();
+			continue;
+		}
+		dev->custom_input_pack_dirty = false;
+		bool force = dev->custom_input_pack_force;
+		dev->custom_input_pack_force = false;
+		String scene_path = dev->custom_input_scene;
+		bool compress = dev->custom_input_pck_compressed;
+		Compression::Mode compression_type = dev->custom_input_pck_compression_type;
+		bool live_sync = dev->custom_input_scene_live_sync;
+		dev->custom_input_pack_mutex.unlock();
+
+		std::vector<String> files;
+		uint64_t signature = 0;
+		if (!scene_path.empty()) {
+			dev->custom_input_dependency_index.collect(scene_path, files, &signature);
+		}
 
-			Error add_err = Error::OK;
-			for (int i = 0; i < files.size(); i++) {
-				add_err = pck->add_file(files[i], files[i]);
-				if (add_err) {
-					_log("Can't add file to PCK. Code: " + str(add_err), LogLevel::LL_ERROR);
-					break;
-				}
-			}
+		// files were not touched, so don't even read them
+		bool same_settings = !state.hash.empty() && state.scene_path == scene_path &&
+							 state.compressed == compress && state.compression_type == (int)compression_type;
+		if (same_settings && state.files_signature == signature && !force)
+			continue;
 
-			if (!add_err) {
-				err = pck->flush();
+		String hash;
+		std::vector<Vector<uint8_t> > contents;
+		Ref<GRPacketCustomInputScene> pack = dev->_create_custom_input_pack(scene_path, compress, compression_type, files, state.hash, hash, contents);
 
-				if (err) {
-					_log("Can't flush PCK file. Code: " + str(err), LogLevel::LL_ERROR);
-				} else {
+		// clients keep the previous pack. signature is not stored, so the next check tries again
+		if (hash.empty())
+			continue;
+		state.files_signature = signature;
 
-					// if OK show which files added
-					_log("Files added to custom input PCK:\n" + str_arr(files, true, 0, ",\n"), LogLevel::LL_NORMAL);
+		// nothing changed since the last build. the hash doesn't include compression, clients store packs uncompressed
+		if (pack.is_null() && !force) {
+			state.compressed = compress;
+			state.compression_type = compression_type;
+			continue;
+		}
 
-					FileAccess *file = FileAccess::open(pck_file, FileAccess::ModeFlags::READ, &err);
-					if (err) {
-						_log("Can't open PCK file for reading. Code: " + str(err), LogLevel::LL_ERROR);
-					} else {
-						PoolByteArray arr;
-						err = arr.resize(file->get_len());
-						if (err) {
-							_log("Can't resize temp buffer array. Code: " + str(err), LogLevel::LL_ERROR);
-						} else {
-							auto w = arr.write();
-							int res = file->get_buffer(w.ptr(), arr.size());
-							w.release();
-							file->close();
-							if (res != arr.size()) {
-								_log("PCK was not fully read. " + str(res) + " of " + str(arr.size()), LogLevel::LL_ERROR);
-							} else {
+		std::vector<PoolByteArray> chunks;
+		PoolByteArray info_data;
+		PoolByteArray patch_data;
+		if (pack.is_valid()) {
+			pack->set_scene_hash(hash);
+			dev->_split_custom_input_pack(pack->get_scene_path(), hash, pack->get_scene_data(), compress, compression_type, chunks);
 
-								if (compress) {
-									PoolByteArray com;
-									err = compress_bytes(arr, com, compression_type);
-									if (err) {
-										_log("Can't compress PCK data. Code: " + str(err), LogLevel::LL_ERROR);
-									}
+			// clients request data only if they don't have this hash cached
+			Ref<GRPacketCustomInputScene> info(memnew(GRPacketCustomInputScene));
+			info->set_scene_path(pack->get_scene_path());
+			info->set_scene_hash(hash);
+			info_data = info->get_data();
 
-									pack->set_scene_path(_scene_path);
-									pack->set_scene_data(com);
-									pack->set_compressed(true);
-									pack->set_compression_type(compression_type);
-									pack->set_original_size(arr.size());
-								} else {
-									pack->set_scene_path(_scene_path);
-									pack->set_scene_data(arr);
-									pack->set_compressed(false);
-									pack->set_compression_type(0);
-								}
+			std::map<String, String> files_md5;
+			for (int i = 0; i < files.size(); i++) {
+				unsigned char md5[16];
+				CryptoCore::md5(contents[i].ptr(), contents[i].size(), md5);
+				files_md5[files[i]] = String::hex_encode_buffer(md5, 16);
+			}
 
-								DirAccess *dir = DirAccess::open(_scene_path.get_base_dir());
-								if (dir) {
-									dir->remove(pck_file);
-									memdelete(dir);
-								}
-							}
-						}
+			// clients with the previous pack get only changed files
+			if (live_sync && same_settings && !pack->get_scene_path().empty() && state.files_md5.size()) {
+				std::vector<String> changed;
+				std::vector<Vector<uint8_t> > changed_contents;
+				PoolStringArray changed_list;
+				for (int i = 0; i < files.size(); i++) {
+					auto prev = state.files_md5.find(files[i]);
+					if (prev == state.files_md5.end() || prev->second != files_md5[files[i]]) {
+						changed.push_back(files[i]);
+						changed_contents.push_back(contents[i]);
+						changed_list.push_back(files[i]);
 					}
-					memdelete(file);
+				}
+
+				PoolByteArray pck;
+				if (changed.size() && changed.size() < files.size() && dev->_write_pck(changed, changed_contents, pck) == Error::OK && pck.size() <= custom_input_pack_chunk_size) {
+					Ref<GRPacketCustomInputScenePatch> patch(memnew(GRPacketCustomInputScenePatch));
+					dev->_set_custom_input_pack_data(patch, scene_path, pck, compress, compression_type);
+					patch->set_scene_hash(hash);
+					patch->set_base_hash(state.hash);
+					patch->set_changed_files(changed_list);
+					patch_data = patch->get_data();
+					_log("Custom input scene files changed:\n" + str_arr(changed, true, 0, ",\n"), LogLevel::LL_NORMAL);
 				}
 			}
+
+			state.scene_path = scene_path;
+			state.compressed = compress;
+			state.compression_type = compression_type;
+			state.hash = hash;
+			state.files_md5 = files_md5;
 		}
-	} else {
+
+		dev->custom_input_pack_mutex.lock();
+		if (pack.is_valid()) {
+			dev->custom_input_pack_chunks = chunks;
+			dev->custom_input_pack_info_data = info_data;
+			dev->custom_input_pack_hash = hash;
+			dev->custom_input_pack_patch_data = patch_data;
+			dev->custom_input_pack_patch_base_version = dev->custom_input_pack_version;
+		} else {
+			dev->custom_input_pack_patch_data = PoolByteArray();
+		}
+		dev->custom_input_pack_version++;
+		dev->custom_input_pack_mutex.unlock();
+	}
+}
+
+// returns null if content hash is equal to _cached_hash.
+// also returns null with empty r_hash if the pack can't be built
+Ref<GRPacketCustomInputScene> GRServer::_create_custom_input_pack(String _scene_path, bool compress, Compression::Mode compression_type, std::vector<String> &_files, const String &_cached_hash, String &r_hash, std::vector<Vector<uint8_t> > &r_contents) {
+	Ref<GRPacketCustomInputScene> pack = memnew(GRPacketCustomInputScene);
+
+	for (int i = 0; i < _files.size(); i++) {
+		Error err = Error::OK;
+		Vector<uint8_t> d = FileAccess::get_file_as_array(_files[i], &err);
+		if (err) {
+			_log("Can't read file for PCK: " + _files[i] + ". Code: " + str(err), LogLevel::LL_ERROR);
+			r_contents.clear();
+			r_hash = "";
+			return Ref<GRPacketCustomInputScene>();
+		}
+		r_contents.push_back(d);
+	}
+
+	// clients check received and patched packs with the same function
+	r_hash = GRUtils::get_pck_content_hash(_scene_path, _files, r_contents);
+
+	if (r_hash == _cached_hash) {
+		return Ref<GRPacketCustomInputScene>();
+	}
+
+	if (_scene_path.empty()) {
+		return pack;
+	}
+
+	if (!_files.size()) {
 		_log("Files to pack not found! Scene path: " + _scene_path, LogLevel::LL_ERROR);
+		r_hash = "";
+		return Ref<GRPacketCustomInputScene>();
 	}
 
-	files.clear();
+	PoolByteArray arr;
+	Error err = _write_pck(_files, r_contents, arr);
+	if (err) {
+		_log("Can't create PCK data. Code: " + str(err), LogLevel::LL_ERROR);
+		r_hash = "";
+		return Ref<GRPacketCustomInputScene>();
+	}
+
+	// if OK show which files added
+	_log("Files added to custom input PCK:\n" + str_arr(_files, true, 0, ",\n"), LogLevel::LL_NORMAL);
+
+	// compressed later by chunks
+	_set_custom_input_pack_data(pack, _scene_path, arr, false, compression_type);
 	return pack;
 }
 
-void GRServer::_scan_resource_for_dependencies_recursive(String _d, std::vector<String> &_arr) {
-	if (!is_vector_contains(_arr, _d)) {
-		_arr.push_back(_d);
-	} else {
-		return;
+void GRServer::_split_custom_input_pack(const String &_scene_path, const String &_hash, const PoolByteArray &_pck, bool compress, Compression::Mode compression_type, std::vector<PoolByteArray> &r_chunks) {
+	const int chunk_size = custom_input_pack_chunk_size;
+	auto r = _pck.read();
+
+	for (int ofs = 0; ofs < _pck.size(); ofs += chunk_size) {
+		int size = _pck.size() - ofs < chunk_size ? _pck.size() - ofs : chunk_size;
+		PoolByteArray part;
+		part.resize(size);
+		auto w = part.write();
+		memcpy(w.ptr(), r.ptr() + ofs, size);
+		w.release();
+
+		Ref<GRPacketCustomInputSceneChunk> chunk(memnew(GRPacketCustomInputSceneChunk));
+		_set_custom_input_pack_data(chunk, _scene_path, part, compress, compression_type);
+		chunk->set_scene_hash(_hash);
+		chunk->set_original_size(size);
+		chunk->set_offset(ofs);
+		chunk->set_total_size(_pck.size());
+		r_chunks.push_back(chunk->get_data());
 	}
+}
 
-	Error err = Error::OK;
-	String text = FileAccess::get_file_as_string(_d, &err);
+void GRServer::_set_custom_input_pack_data(Ref<GRPacketCustomInputScene> pack, const String &_scene_path, const PoolByteArray &_pck, bool compress, Compression::Mode compression_type) {
+	if (compress) {
+		PoolByteArray com;
+		Error err = compress_bytes(_pck, com, compression_type);
+		if (err) {
+			_log("Can't compress PCK data. Code: " + str(err), LogLevel::LL_ERROR);
+		}
 
-	if (err) {
-		_log("Can't read file as text: " + _d, LogLevel::LL_ERROR);
+		pack->set_scene_path(_scene_path);
+		pack->set_scene_data(com);
+		pack->set_compressed(true);
+		pack->set_compression_type(compression_type);
+		pack->set_original_size(_pck.size());
 	} else {
-		String imp = _d + ".import";
-		text += FileAccess::get_file_as_string(imp, &err);
-		if (err) {
-			_log(".import file not found for " + imp, LogLevel::LL_DEBUG);
-		} else {
-			if (is_vector_contains(_arr, imp)) {
-				_arr.push_back(imp);
+		pack->set_scene_path(_scene_path);
+		pack->set_scene_data(_pck);
+		pack->set_compressed(false);
+		pack->set_compression_type(0);
+	}
+}
+
+// same layout as PCKPacker writes, but in memory
+Error GRServer::_write_pck(const std::vector<String> &_files, const std::vector<Vector<uint8_t> > &_contents, PoolByteArray &r_data) {
+	ERR_FAIL_COND_V(_files.size() != _contents.size(), ERR_INVALID_PARAMETER);
+
+	std::vector<CharString> paths;
+	uint64_t ofs = 4 * (5 + 16 + 1); // header, reserved and files count
+	for (int i = 0; i < _files.size(); i++) {
+		paths.push_back(_files[i].utf8());
+		ofs += 4 + paths[i].length() + 8 + 8 + 16;
+	}
+
+	Ref<StreamPeerBuffer> buf(memnew(StreamPeerBuffer));
+	buf->put_u32(0x43504447); // GDPC
+	buf->put_u32(1); // pack format version
+	buf->put_u32(VERSION_MAJOR);
+	buf->put_u32(VERSION_MINOR);
+	buf->put_u32(VERSION_PATCH);
+	for (int i = 0; i < 16; i++) {
+		buf->put_u32(0);
+	}
+
+	buf->put_u32(_files.size());
+	for (int i = 0; i < _files.size(); i++) {
+		const Vector<uint8_t> &d = _contents[i];
+		unsigned char md5[16];
+		CryptoCore::md5(d.ptr(), d.size(), md5);
+
+		buf->put_u32(paths[i].length());
+		buf->put_data((const uint8_t *)paths[i].get_data(), paths[i].length());
+		buf->put_u64(ofs);
+		buf->put_u64(d.size());
+		buf->put_data(md5, 16);
+		ofs += d.size();
+	}
+
+	for (int i = 0; i < _contents.size(); i++) {
+		if (_contents[i].size()) {
+			buf->put_data(_contents[i].ptr(), _contents[i].size());
+		}
+	}
+
+	r_data = buf->get_data_array();
+	return Error::OK;
+}
+
+//////////////////////////////////////////////
+/////////// GRSDependencyIndex ///////////////
+//////////////////////////////////////////////
+
+void GRSDependencyIndex::init() {
+	resource_finder.instance();
+	resource_finder->compile(resource_finder_pattern);
+}
+
+void GRSDependencyIndex::deinit() {
+	clear();
+	resource_finder.unref();
+}
+
+void GRSDependencyIndex::collect(const String &root, std::vector<String> &r_files, uint64_t *r_signature) {
+	uint64_t signature = 5381;
+	std::unordered_set<String, StringHasher> visited;
+	std::vector<String> stack;
+	stack.push_back(root);
+
+	while (!stack.empty()) {
+		String path = stack.back();
+		stack.pop_back();
+
+		if (!visited.insert(path).second)
+			continue;
+
+		const Entry &e = _get_entry(path);
+		signature = hash_djb2_one_64(path.hash(), signature);
+		signature = hash_djb2_one_64(e.modified_time, signature);
+		signature = hash_djb2_one_64(e.import_modified_time, signature);
+		if (!e.exists) {
+			_log("Can't find file: " + path, LogLevel::LL_ERROR);
+			continue;
+		}
+
+		r_files.push_back(path);
+		if (e.has_import) {
+			String imp = path + ".import";
+			if (visited.insert(imp).second) {
+				r_files.push_back(imp);
 			}
 		}
 
-		Array res = custom_input_scene_regex_resource_finder->search_all(text);
+		for (int i = (int)e.dependencies.size() - 1; i >= 0; i--) {
+			if (!visited.count(e.dependencies[i])) {
+				stack.push_back(e.dependencies[i]);
+			}
+		}
+	}
+
+	if (r_signature) {
+		*r_signature = signature;
+	}
+}
+
+void GRSDependencyIndex::invalidate(const String &path) {
+	entries.erase(path);
+}
+
+void GRSDependencyIndex::clear() {
+	entries.clear();
+}
+
+const GRSDependencyIndex::Entry &GRSDependencyIndex::_get_entry(const String &path) {
+	String imp = path + ".import";
+	bool exists = FileAccess::exists(path);
+	bool has_import = FileAccess::exists(imp);
+	uint64_t modified_time = exists ? FileAccess::get_modified_time(path) : 0;
+	uint64_t import_modified_time = has_import ? FileAccess::get_modified_time(imp) : 0;
+
+	auto it = entries.find(path);
+	if (it != entries.end()) {
+		Entry &e = it->second;
+		if (e.exists == exists && e.has_import == has_import &&
+				e.modified_time == modified_time && e.import_modified_time == import_modified_time) {
+			return e;
+		}
+	}
+
+	Entry &e = entries[path];
+	e.exists = exists;
+	e.has_import = has_import;
+	e.modified_time = modified_time;
+	e.import_modified_time = import_modified_time;
+	e.dependencies.clear();
+	if (exists) {
+		_parse(path, e);
+	}
+	return e;
+}
+
+void GRSDependencyIndex::_parse(const String &path, Entry &entry) {
+	String ext = path.get_extension().to_lower();
 
-		for (int i = 0; i < res.size(); i++) {
-			Ref<RegExMatch> rem = res[i];
-			String path = rem->get_string(1);
-			path = path.trim_suffix("\\"); // Needed for avoiding escape symbols in build-in scripts
+	// text formats can have paths in built-in scripts, so scan them as before
+	if (ext == "tscn" || ext == "tres" || ext == "gd" || ext == "shader" || ext == "cfg" || ext == "json") {
+		Error err = Error::OK;
+		String text = FileAccess::get_file_as_string(path, &err);
+		if (err) {
+			_log("Can't read file as text: " + path, LogLevel::LL_ERROR);
+		} else {
+			_find_in_text(text, entry.dependencies);
+		}
+	} else {
+		List<String> deps;
+		ResourceLoader::get_dependencies(path, &deps);
+		for (List<String>::Element *E = deps.front(); E; E = E->next()) {
+			entry.dependencies.push_back(E->get().get_slice("::", 0));
+		}
+	}
 
-			_scan_resource_for_dependencies_recursive(path, _arr);
+	// imported files are stored in .import folder
+	if (entry.has_import) {
+		Error err = Error::OK;
+		String text = FileAccess::get_file_as_string(path + ".import", &err);
+		if (err) {
+			_log("Can't read file as text: " + path + ".import", LogLevel::LL_ERROR);
+		} else {
+			_find_in_text(text, entry.dependencies);
 		}
 	}
 }
 
+void GRSDependencyIndex::_find_in_text(const String &text, std::vector<String> &r_deps) {
+	Array res = resource_finder->search_all(text);
+
+	for (int i = 0; i < res.size(); i++) {
+		Ref<RegExMatch> rem = res[i];
+		String path = rem->get_string(1);
+		path = path.trim_suffix("\\"); // Needed for avoiding escape symbols in build-in scripts
+		r_deps.push_back(path);
+	}
+}
+
 //////////////////////////////////////////////
 ////////////// GRSViewport ///////////////////
 //////////////////////////////////////////////
 
-void GRSViewport::_processing_thread(THREAD_DATA p_user) {
-	GRSViewport *vp = (GRSViewport *)p_user;
-	ImgProcessingStorageViewport *ips = memnew(ImgProcessingStorageViewport);
-	Ref<Image> img = vp->last_image;
-
+Error GRSViewport::encode_image(Ref<Image> img, ImgProcessingStorageViewport *ips, GRDevice::Subsampling subsampling, PoolByteArray *jpg_buffer) {
+	ERR_FAIL_COND_V(img.is_null() || !ips, Error::ERR_INVALID_PARAMETER);
 	TimeCountInit();
-	if (!ips) {
-		goto end;
-	}
 
 	ips->width = img->get_width();
 	ips->height = img->get_height();
-	ips->compression_type = vp->compression_type;
-	ips->jpg_quality = vp->jpg_quality;
-
 	ips->format = img->get_format();
+	ips->convert_end_time = 0;
 	if (!(ips->format == Image::FORMAT_RGBA8 || ips->format == Image::FORMAT_RGB8)) {
+		GR_TRACE_SCOPE("convert");
 		img->convert(Image::FORMAT_RGB8);
 		ips->format = img->get_format();
 
 		if (ips->format != Image::FORMAT_RGB8) {
-			_log("Can't convert stream image to RGB8.", LogLevel::LL_ERROR);
-			GRNotifications::add_notification("Stream Error", "Can't convert stream image to RGB8.", GRNotifications::NotificationIcon::ICON_ERROR);
-			goto end;
+			return Error::ERR_INVALID_DATA;
 		}
 
 		TimeCount("Image Convert");
 	}
 	ips->bytes_in_color = img->get_format() == Image::FORMAT_RGB8 ? 3 : 4;
+	ips->convert_end_time = OS::get_singleton()->get_ticks_usec();
 
+	// nothing to send, connection thread skips empty data
 	if (img->get_data().size() == 0)
-		goto end;
+		return Error::OK;
 
+	Error err = Error::OK;
 	switch (ips->compression_type) {
 		case GRDevice::ImageCompressionType::COMPRESSION_UNCOMPRESSED: {
 			ips->ret_data = img->get_data();
@@ -1286,36 +1994,82 @@ void GRSViewport::_processing_thread(THREAD_DATA p_user) {
 			break;
 		}
 		case GRDevice::ImageCompressionType::COMPRESSION_JPG: {
-			if (!img->empty()) {
-				Error err = compress_jpg(ips->ret_data, img->get_data(), ips->width, ips->height, ips->bytes_in_color, ips->jpg_quality, GRDevice::Subsampling::SUBSAMPLING_H2V2);
-				if (err) {
-					_log("Can't compress stream image JPG. Code: " + str(err), LogLevel::LL_ERROR);
-					GRNotifications::add_notification("Stream Error", "Can't compress stream image to JPG. Code: " + str(err), GRNotifications::NotificationIcon::ICON_ERROR);
-				}
+			GR_TRACE_SCOPE("encode_jpg");
+			if (jpg_buffer) {
+				err = compress_jpg(ips->ret_data, *jpg_buffer, img->get_data(), ips->width, ips->height, ips->bytes_in_color, ips->jpg_quality, subsampling);
+			} else {
+				err = compress_jpg(ips->ret_data, img->get_data(), ips->width, ips->height, ips->bytes_in_color, ips->jpg_quality, subsampling);
 			}
 			TimeCount("Image processed: JPG");
 			break;
 		}
 		case GRDevice::ImageCompressionType::COMPRESSION_PNG: {
+			GR_TRACE_SCOPE("encode_png");
 			ips->ret_data = img->save_png_to_buffer();
 			if (ips->ret_data.size() == 0) {
-				_log("Can't compress stream image to PNG.", LogLevel::LL_ERROR);
-				GRNotifications::add_notification("Stream Error", "Can't compress stream image to PNG.", GRNotifications::NotificationIcon::ICON_ERROR);
+				err = Error::ERR_CANT_CREATE;
 			}
 			TimeCount("Image processed: PNG");
 			break;
 		}
 		default:
-			_log("Not implemented compression type: " + str((int)ips->compression_type), LogLevel::LL_ERROR);
+			err = Error::ERR_UNAVAILABLE;
 			break;
 	}
-end:
+	return err;
+}
+
+void GRSViewport::_processing_thread(THREAD_DATA p_user) {
+	GRSViewport *vp = (GRSViewport *)p_user;
+	ImgProcessingStorageViewport *ips = memnew(ImgProcessingStorageViewport);
+	Ref<Image> img = vp->last_image;
+
+	GRUtils::trace_set_thread_name("encoder");
+	GR_THREAD_CPU_SCOPE("server_encoder");
+	if (!ips) {
+		vp->_set_img_data(ips);
+		return;
+	}
+
+	ips->capture_time = vp->capture_time;
+	ips->readback_time = vp->readback_time;
+	ips->input_sequence = vp->capture_input_sequence;
+	ips->encode_start_time = OS::get_singleton()->get_ticks_usec();
+	ips->compression_type = vp->compression_type;
+	ips->jpg_quality = vp->jpg_quality;
+
+	Error err = encode_image(img, ips);
+	if (err) {
+		if (!ips->convert_end_time) {
+			_log("Can't convert stream image to RGB8.", LogLevel::LL_ERROR);
+			GRNotifications::add_notification("Stream Error", "Can't convert stream image to RGB8.", GRNotifications::NotificationIcon::ICON_ERROR);
+		} else {
+			switch (ips->compression_type) {
+				case GRDevice::ImageCompressionType::COMPRESSION_JPG:
+					_log("Can't compress stream image JPG. Code: " + str(err), LogLevel::LL_ERROR);
+					GRNotifications::add_notification("Stream Error", "Can't compress stream image to JPG. Code: " + str(err), GRNotifications::NotificationIcon::ICON_ERROR);
+					break;
+				case GRDevice::ImageCompressionType::COMPRESSION_PNG:
+					_log("Can't compress stream image to PNG.", LogLevel::LL_ERROR);
+					GRNotifications::add_notification("Stream Error", "Can't compress stream image to PNG.", GRNotifications::NotificationIcon::ICON_ERROR);
+					break;
+				case GRDevice::ImageCompressionType::COMPRESSION_UNCOMPRESSED:
+					break;
+				default:
+					_log("Not implemented compression type: " + str((int)ips->compression_type), LogLevel::LL_ERROR);
+					break;
+			}
+		}
+	}
+
+	ips->encode_end_time = OS::get_singleton()->get_ticks_usec();
 	vp->_set_img_data(ips);
 }
 
 void GRSViewport::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("_update_size"), &GRSViewport::_update_size);
 	ClassDB::bind_method(D_METHOD("_on_renderer_deleting"), &GRSViewport::_on_renderer_deleting);
+	ClassDB::bind_method(D_METHOD("_on_frame_pre_draw"), &GRSViewport::_on_frame_pre_draw);
 	ClassDB::bind_method(D_METHOD("set_rendering_scale"), &GRSViewport::set_rendering_scale);
 	ClassDB::bind_method(D_METHOD("get_rendering_scale"), &GRSViewport::get_rendering_scale);
 
@@ -1328,8 +2082,12 @@ void GRSViewport::_close_thread() {
 
 void GRSViewport::_set_img_data(ImgProcessingStorageViewport *_data) {
 	_THREAD_SAFE_LOCK_;
-	if (last_image_data)
+	if (last_image_data) {
+		// previous frame was not sent yet
+		if (!last_image_data->is_empty)
+			dropped_frames++;
 		memdelete(last_image_data);
+	}
 
 	last_image_data = _data;
 	_THREAD_SAFE_UNLOCK_;
@@ -1338,6 +2096,10 @@ void GRSViewport::_on_renderer_deleting() {
 	renderer = nullptr;
 }
 
+void GRSViewport::_on_frame_pre_draw() {
+	drawn_input_sequence = injected_input_sequence;
+}
+
 void GRSViewport::_notification(int p_notification) {
 	TimeCountInit();
 	switch (p_notification) {
@@ -1370,14 +2132,23 @@ void GRSViewport::_notification(int p_notification) {
 
 			frames_from_prev_image++;
 			if (frames_from_prev_image > skip_frames) {
+				GR_TRACE_SCOPE("capture");
 				frames_from_prev_image = 0;
 
 				if (get_texture().is_null())
 					break;
 
+				uint64_t capture = OS::get_singleton()->get_ticks_usec();
+#ifdef GODOTREMOTE_BENCHMARK
+				Ref<Image> tmp_image = synthetic_frames.size() ? synthetic_frames[synthetic_frame_index++ % synthetic_frames.size()] : get_texture()->get_data();
+#else
 				auto tmp_image = get_texture()->get_data();
+#endif
 				_THREAD_SAFE_LOCK_;
 
+				capture_time = capture;
+				readback_time = OS::get_singleton()->get_ticks_usec();
+				capture_input_sequence = drawn_input_sequence;
 				last_image = tmp_image;
 				TimeCount("Get image data from VisualServer");
 
@@ -1400,6 +2171,8 @@ void GRSViewport::_notification(int p_notification) {
 			renderer->connect("tree_exiting", this, "_on_renderer_deleting");
 			add_child(renderer);
 
+			VisualServer::get_singleton()->connect("frame_pre_draw", this, "_on_frame_pre_draw");
+
 			break;
 		}
 		case NOTIFICATION_EXIT_TREE: {
@@ -1409,6 +2182,8 @@ void GRSViewport::_notification(int p_notification) {
 			}
 			main_vp->disconnect("size_changed", this, "_update_size");
 			main_vp = nullptr;
+
+			VisualServer::get_singleton()->disconnect("frame_pre_draw", this, "_on_frame_pre_draw");
 			break;
 		}
 		default:
@@ -1499,6 +2274,13 @@ int GRSViewport::get_skip_frames() {
 	return skip_frames;
 }
 
+#ifdef GODOTREMOTE_BENCHMARK
+void GRSViewport::set_synthetic_frames(const std::vector<Ref<Image> > &frames) {
+	synthetic_frames = frames;
+	synthetic_frame_index = 0;
+}
+#endif
+
 void GRSViewport::_init() {
 	set_name("GRSViewport");
 	LEAVE_IF_EDITOR();
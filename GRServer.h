@@ -3,14 +3,53 @@
 
 #ifndef NO_GODOTREMOTE_SERVER
 
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "GRDevice.h"
 #include "core/io/compression.h"
 #include "core/io/stream_peer_tcp.h"
 #include "core/io/tcp_server.h"
+#include "core/os/semaphore.h"
 #include "modules/regex/regex.h"
 #include "scene/gui/control.h"
 #include "scene/main/viewport.h"
 
+// Cached graph of res:// dependencies of the custom input scene.
+// Files are parsed again only when their modification time changes.
+class GRSDependencyIndex {
+	struct StringHasher {
+		size_t operator()(const String &s) const { return s.hash(); }
+	};
+
+	struct Entry {
+		uint64_t modified_time = 0;
+		uint64_t import_modified_time = 0;
+		bool exists = false;
+		bool has_import = false;
+		std::vector<String> dependencies;
+	};
+
+	std::unordered_map<String, Entry, StringHasher> entries;
+	const String resource_finder_pattern = "\\\"(res://.*?)\\\"";
+	Ref<class RegEx> resource_finder;
+
+	const Entry &_get_entry(const String &path);
+	void _parse(const String &path, Entry &entry);
+	void _find_in_text(const String &text, std::vector<String> &r_deps);
+
+public:
+	// scene itself, all its dependencies and their .import files.
+	// signature changes when any of them is modified
+	void collect(const String &root, std::vector<String> &r_files, uint64_t *r_signature = nullptr);
+	void invalidate(const String &path);
+	void clear();
+
+	void init();
+	void deinit();
+};
+
 class GRServer : public GRDevice {
 	GDCLASS(GRServer, GRDevice);
 
@@ -62,25 +101,89 @@ private:
 		}
 	};
 
+	// decoded input waiting to be injected on the main thread
+	struct QueuedInput {
+		GRInputData::InputType type = GRInputData::InputType::_NoneIT;
+		Ref<InputEvent> event;
+		uint64_t time = 0;
+		Vector3 sensors[4];
+		uint32_t input_sequence = 0;
+	};
+
+	struct CustomCursor {
+		PoolByteArray image;
+		Vector2 hotspot;
+	};
+
+	struct SensorsSample {
+		uint64_t time = 0;
+		Vector3 values[4];
+	};
+
 private:
 	Mutex connection_mutex;
 	ListenerThreadParamsServer *server_thread_listen = nullptr;
 	Ref<TCP_Server> tcp_server;
 	class GRSViewport *resize_viewport = nullptr;
-	int client_connected = 0;
+	std::atomic<int> client_connected = { 0 }; // also read by the metrics thread
 
 	bool using_client_settings = false;
 	bool using_client_settings_recently_updated = false;
 
 	String password;
 	String custom_input_scene;
-	bool custom_input_scene_was_updated = false;
 	bool auto_adjust_scale = false;
+	bool accumulate_input = false;
+
+	GRUtils::mpsc_queue<QueuedInput> input_queue;
+
+	// sensors are played back with a small delay and interpolated between samples
+	std::deque<SensorsSample> sensors_samples;
+	int64_t sensors_clock_offset = 0;
+	bool sensors_clock_synced = false;
+	bool sensors_last_sample_applied = false; // nothing to update until a new sample
+
+	// custom cursors streamed to the client, by Input::CursorShape
+	std::atomic<int> current_cursor_shape = { Input::CURSOR_ARROW }; // updated every frame
+	std::atomic<int> current_mouse_mode = { Input::MOUSE_MODE_VISIBLE }; // updated every frame
+	Mutex cursor_mutex;
+	std::map<int, CustomCursor> custom_cursors;
+	Size2 cursor_screen_size; // clients scale cursors to the stream size
+	uint32_t custom_cursors_version = 0;
 
 	bool custom_input_pck_compressed = true;
-	Compression::Mode custom_input_pck_compression_type = Compression::MODE_FASTLZ;
-	const String custom_input_scene_regex_resource_finder_pattern = "\\\"(res://.*?)\\\"";
-	Ref<class RegEx> custom_input_scene_regex_resource_finder;
+	Compression::Mode custom_input_pck_compression_type = Compression::MODE_ZSTD;
+	// pack is built on a worker thread and shared by all connections.
+	// the worker lives while the server works and sleeps on the semaphore between requests
+	Thread custom_input_pack_thread;
+	Semaphore custom_input_pack_semaphore;
+	Mutex custom_input_pack_mutex;
+	bool custom_input_pack_stop = false;
+	bool custom_input_pack_dirty = false;
+	bool custom_input_pack_force = false;
+	uint32_t custom_input_pack_version = 0;
+	std::vector<PoolByteArray> custom_input_pack_chunks; // serialized GRPacketCustomInputSceneChunk
+	PoolByteArray custom_input_pack_info_data; // same packet without scene data
+	String custom_input_pack_hash; // sha256 of the scene settings and all packed files
+	// changed files for clients with the previous version. sent as one packet,
+	// so bigger patches are replaced by the chunked full pack
+	PoolByteArray custom_input_pack_patch_data;
+	static const int custom_input_pack_chunk_size = 64 * 1024;
+	uint32_t custom_input_pack_patch_base_version = 0;
+	bool custom_input_scene_live_sync = true;
+	uint64_t prev_live_sync_check_time = 0;
+
+	// used only by the pack worker
+	struct CustomInputPackState {
+		String scene_path;
+		bool compressed = false;
+		int compression_type = 0;
+		String hash;
+		uint64_t files_signature = 0;
+		std::map<String, String> files_md5;
+	};
+	CustomInputPackState custom_input_pack_state;
+	GRSDependencyIndex custom_input_dependency_index;
 
 	float prev_avg_fps = 0;
 	void _adjust_viewport_scale();
@@ -89,15 +192,24 @@ private:
 	void _update_settings_from_client(const std::map<int, Variant> settings);
 	void _remove_resize_viewport(Node *vp);
 	void _on_grviewport_deleting();
+	void _inject_queued_input();
+	void _push_sensors_sample(const QueuedInput &qi);
+	void _update_interpolated_sensors();
 
 	virtual void _reset_counters() override;
+	virtual void _write_metrics(class GRMetricsWriter &w) override;
 
 	THREAD_FUNC void _thread_listen(THREAD_DATA p_userdata);
 	THREAD_FUNC void _thread_connection(THREAD_DATA p_userdata);
+	THREAD_FUNC void _thread_build_custom_input_pack(THREAD_DATA p_userdata);
 
 	static AuthResult _auth_client(GRServer *dev, Ref<PacketPeerStream> &ppeer, Dictionary &ret_data, bool refuse_connection = false);
-	Ref<GRPacketCustomInputScene> _create_custom_input_pack(String _scene_path, bool compress = true, Compression::Mode compression_type = Compression::MODE_FASTLZ);
-	void _scan_resource_for_dependencies_recursive(String _dir, std::vector<String> &_arr);
+	void _request_custom_input_pack_build(bool force = false);
+	void _wait_custom_input_pack_build();
+	Ref<GRPacketCustomInputScene> _create_custom_input_pack(String _scene_path, bool compress, Compression::Mode compression_type, std::vector<String> &_files, const String &_cached_hash, String &r_hash, std::vector<Vector<uint8_t> > &r_contents);
+	void _set_custom_input_pack_data(Ref<GRPacketCustomInputScene> pack, const String &_scene_path, const PoolByteArray &_pck, bool compress, Compression::Mode compression_type);
+	void _split_custom_input_pack(const String &_scene_path, const String &_hash, const PoolByteArray &_pck, bool compress, Compression::Mode compression_type, std::vector<PoolByteArray> &r_chunks);
+	Error _write_pck(const std::vector<String> &_files, const std::vector<Vector<uint8_t> > &_contents, PoolByteArray &r_data);
 
 protected:
 	virtual void _internal_call_only_deffered_start() override;
@@ -111,12 +223,17 @@ public:
 	bool is_auto_adjust_scale();
 	void set_password(String _pass);
 	String get_password();
+	void set_accumulate_input(bool _val);
+	bool is_accumulate_input();
+	void set_custom_cursor(const Ref<Resource> &cursor, int shape = Input::CURSOR_ARROW, Vector2 hotspot = Vector2());
 	void set_custom_input_scene(String _scn);
 	String get_custom_input_scene();
 	void set_custom_input_scene_compressed(bool _is_compressed);
 	bool is_custom_input_scene_compressed();
 	void set_custom_input_scene_compression_type(int _type);
 	int get_custom_input_scene_compression_type();
+	void set_custom_input_scene_live_sync(bool _val);
+	bool is_custom_input_scene_live_sync();
 
 	// VIEWPORT
 	bool set_video_stream_enabled(bool val);
@@ -154,6 +271,12 @@ public:
 		int width, height, format;
 		int bytes_in_color, jpg_quality;
 		bool is_empty = false;
+		uint64_t capture_time = 0;
+		uint64_t readback_time = 0;
+		uint64_t encode_start_time = 0;
+		uint64_t convert_end_time = 0;
+		uint64_t encode_end_time = 0;
+		uint32_t input_sequence = 0;
 
 		void _init() {
 			LEAVE_IF_EDITOR();
@@ -174,6 +297,7 @@ private:
 	void _close_thread();
 	void _set_img_data(ImgProcessingStorageViewport *_data);
 	void _on_renderer_deleting();
+	void _on_frame_pre_draw();
 
 	THREAD_FUNC void _processing_thread(THREAD_DATA p_user);
 
@@ -189,12 +313,33 @@ protected:
 
 	uint16_t frames_from_prev_image = 0;
 	bool is_empty_image_sended = false;
+	uint64_t capture_time = 0;
+	uint64_t readback_time = 0;
+
+	// input batches applied on the main thread, in the last drawn frame and in the captured one.
+	// capture reads the texture drawn in the previous frame
+	uint32_t injected_input_sequence = 0;
+	uint32_t drawn_input_sequence = 0;
+	uint32_t capture_input_sequence = 0;
+
+	// encoded frames replaced before the connection thread took them
+	std::atomic<uint32_t> dropped_frames = { 0 };
+
+#ifdef GODOTREMOTE_BENCHMARK
+	// captured in a loop instead of the viewport texture
+	std::vector<Ref<Image> > synthetic_frames;
+	uint32_t synthetic_frame_index = 0;
+#endif
 
 	static void _bind_methods();
 	void _notification(int p_notification);
 	void _update_size();
 
 public:
+	// converts img to RGB8 if needed and encodes it to ips->ret_data with ips->compression_type.
+	// shared by the stream and the encode benchmark. jpg_buffer is used instead of the server's one
+	static Error encode_image(Ref<Image> img, ImgProcessingStorageViewport *ips, GRDevice::Subsampling subsampling = GRDevice::Subsampling::SUBSAMPLING_H2V2, PoolByteArray *jpg_buffer = nullptr);
+
 	ImgProcessingStorageViewport *get_last_compressed_image_data();
 	bool has_compressed_image_data();
 	void force_get_image();
@@ -209,6 +354,9 @@ public:
 	int get_jpg_quality();
 	void set_skip_frames(int skip);
 	int get_skip_frames();
+#ifdef GODOTREMOTE_BENCHMARK
+	void set_synthetic_frames(const std::vector<Ref<Image> > &frames);
+#endif
 
 	void _init();
 	void _deinit();
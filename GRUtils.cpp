@@ -2,17 +2,38 @@
 
 #include "GRUtils.h"
 #include "GodotRemote.h"
+#include "core/crypto/crypto_core.h"
 #include "core/io/compression.h"
+#include "core/os/file_access.h"
+
+#ifndef NO_GODOTREMOTE_ZSTD
+#include <zstd.h>
+#endif
 
 #ifndef NO_GODOTREMOTE_SERVER
 // https://github.com/richgel999/jpeg-compressor
 #include "jpge.h"
 #endif
 
+#if defined(GODOTREMOTE_BENCHMARK) && defined(UNIX_ENABLED)
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+// cpu clocks of other threads, not available on macOS
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+#define GR_THREAD_CPU_CLOCK
+#endif
+#endif
+
 GRUtilsData *GRUtils::_grutils_data = nullptr;
 
 namespace GRUtils {
 
+static void _trace_free();
+static void _log_thread(void *p_userdata);
+static void _log_print(const String &text, int lvl);
+static void _log_flush(bool force = false);
+
 void init() {
 	LEAVE_IF_EDITOR();
 
@@ -23,17 +44,50 @@ void init() {
 # include "GRVersion.h"
 
 	GET_PS_SET(_grutils_data->current_loglevel, GodotRemote::ps_general_loglevel_name);
+	GET_PS_SET(_grutils_data->zstd_level, GodotRemote::ps_general_zstd_level_name);
+	trace_set_enabled(GET_PS(GodotRemote::ps_general_trace_enabled_name));
+
+#ifdef DEBUG_ENABLED
+	_grutils_data->log_thread_running = true;
+	_grutils_data->log_thread.start(&_log_thread, nullptr);
+#endif
+
+#ifndef NO_GODOTREMOTE_ZSTD
+	String dict_path = GET_PS(GodotRemote::ps_general_zstd_dictionary_name);
+	if (dict_path != "") {
+		Error err = Error::OK;
+		Vector<uint8_t> dict = FileAccess::get_file_as_array(dict_path, &err);
+		if (err == Error::OK && dict.size()) {
+			_grutils_data->zstd_cdict = ZSTD_createCDict(dict.ptr(), dict.size(), _grutils_data->zstd_level);
+			_grutils_data->zstd_ddict = ZSTD_createDDict(dict.ptr(), dict.size());
+		} else {
+			_log("Can't load zstd dictionary: " + dict_path, LogLevel::LL_ERROR);
+		}
+	}
+#endif
 }
 
 void deinit() {
 	LEAVE_IF_EDITOR();
 
 	if (_grutils_data) {
+		_grutils_data->log_thread_running = false;
+		_grutils_data->log_semaphore.post();
+		_grutils_data->log_thread.wait_to_finish();
+		_log_flush(true);
+
 		_grutils_data->internal_PACKET_HEADER.resize(0);
 		_grutils_data->internal_VERSION.resize(0);
+#ifndef NO_GODOTREMOTE_ZSTD
+		if (_grutils_data->zstd_cdict)
+			ZSTD_freeCDict(_grutils_data->zstd_cdict);
+		if (_grutils_data->zstd_ddict)
+			ZSTD_freeDDict(_grutils_data->zstd_ddict);
+#endif
 		memdelete(_grutils_data);
 		_grutils_data = nullptr;
 	}
+	_trace_free();
 }
 
 #ifndef NO_GODOTREMOTE_SERVER
@@ -54,28 +108,125 @@ void deinit_server_utils() {
 }
 #endif
 
-void log_str(const Variant &val, int lvl, String file, int line) {
+bool log_rate_limiter::allow(uint32_t &r_suppressed) {
+	uint64_t time = OS::get_singleton()->get_ticks_usec();
+	uint64_t start = window_start.load(std::memory_order_relaxed);
+	if (time - start > 1000_ms && window_start.compare_exchange_strong(start, time)) {
+		count.store(0);
+	}
+
+	if (count.fetch_add(1) < max_per_second) {
+		r_suppressed = suppressed.exchange(0);
+		return true;
+	}
+	suppressed.fetch_add(1);
+	last_suppressed_time.store(time);
+
+	// nothing else reports the count if the call site gets quiet
+	if (_grutils_data && _grutils_data->log_thread_running && !summary_queued.exchange(true)) {
+		_grutils_data->log_suppressed_queue.push(this);
+		_grutils_data->log_semaphore.post();
+	}
+	return false;
+}
+
+bool log_rate_limiter::flush_summary(bool force) {
+	if (!force && OS::get_singleton()->get_ticks_usec() - last_suppressed_time.load() < 1000_ms)
+		return false;
+
+	// cleared first, so the next suppressed message queues this call site again
+	summary_queued.store(false);
+	uint32_t n = suppressed.exchange(0);
+	if (n) {
+		_log_print(str((int64_t)n) + " similar messages suppressed\n    At: " + String(file).get_file() + ":" + str(line), level);
+	}
+	return true;
+}
+
+static void _log_print(const String &text, int lvl) {
+	if (lvl == LogLevel::LL_ERROR) {
+		print_error("[GodotRemote Error] " + text);
+	} else if (lvl == LogLevel::LL_WARNING) {
+		print_error("[GodotRemote Warning] " + text);
+	} else {
+		print_line("[GodotRemote] " + text);
+	}
+}
+
+// force prints all suppressed counts, even of call sites that are still active
+static void _log_flush(bool force) {
+	GRUtilsData::LogEntry e;
+	while (_grutils_data->log_queue.pop(e)) {
+		_grutils_data->log_queue_size--;
+		_log_print(e.text, e.level);
+	}
+
+	uint32_t dropped = _grutils_data->log_dropped.exchange(0);
+	if (dropped) {
+		_log_print(str((int64_t)dropped) + " messages were dropped, log queue is full", LogLevel::LL_WARNING);
+	}
+
+	std::vector<log_rate_limiter *> &sites = _grutils_data->log_suppressed_sites;
+	log_rate_limiter *site = nullptr;
+	while (_grutils_data->log_suppressed_queue.pop(site)) {
+		sites.push_back(site);
+	}
+	for (int i = (int)sites.size() - 1; i >= 0; i--) {
+		if (sites[i]->flush_summary(force)) {
+			sites.erase(sites.begin() + i);
+		}
+	}
+}
+
+static void _log_thread(void *p_userdata) {
+	Thread::set_name("GR_logger");
+	while (_grutils_data->log_thread_running) {
+		// sleeps until the next message. while some counts of suppressed messages
+		// are not printed, it wakes up every 100 ms, because no message comes when a storm stops
+		if (_grutils_data->log_suppressed_sites.empty()) {
+			_grutils_data->log_semaphore.wait();
+		} else if (!_grutils_data->log_semaphore.try_wait()) {
+			sleep_usec(100_ms);
+		}
+		_log_flush();
+	}
+}
+
+void log_str(const Variant &val, int lvl, String file, int line, uint32_t suppressed) {
 #ifdef DEBUG_ENABLED
-if ((_grutils_data && lvl >= _grutils_data->current_loglevel && lvl < LogLevel::LL_NONE) || (!_grutils_data && lvl > LogLevel::LL_DEBUG)) {
-	String file_line = "";
-	if (file != "") {
+	if (!is_log_level_enabled(lvl))
+		return;
+
+	String text = str(val);
+	if (suppressed) {
+		text += " (" + str((int64_t)suppressed) + " similar messages suppressed)";
+	}
+
+	if ((lvl == LogLevel::LL_ERROR || lvl == LogLevel::LL_WARNING) && file != "") {
 		const char *module = "gd_godot_remote";
 		int idx = file.find(module);
 		if (idx != -1) {
 			file = file.substr(file.find(module), file.length());
 		}
 
-		file_line = "\n    At: " + file + ":" + str(line);
+		text += "\n    At: " + file + ":" + str(line);
 	}
 
-	if (lvl == LogLevel::LL_ERROR) {
-		print_error("[GodotRemote Error] " + str(val) + file_line);
-	} else if (lvl == LogLevel::LL_WARNING) {
-		print_error("[GodotRemote Warning] " + str(val) + file_line);
+	// network threads must not wait for the console
+	if (_grutils_data && _grutils_data->log_thread_running) {
+		if (_grutils_data->log_queue_size.load() >= 1024) {
+			_grutils_data->log_dropped++;
+			return;
+		}
+		GRUtilsData::LogEntry e;
+		e.text = text;
+		e.level = lvl;
+		_grutils_data->log_queue_size++;
+		_grutils_data->log_queue.push(e);
+		_grutils_data->log_semaphore.post();
 	} else {
-		print_line("[GodotRemote] " + str(val));
+		_log_print(text, lvl);
 	}
-}
 #endif
 }
 
@@ -156,8 +307,14 @@ String str_arr(const uint8_t *data, const int size, const bool force_full, const
 
 #ifndef NO_GODOTREMOTE_SERVER
 Error compress_jpg(PoolByteArray &ret, const PoolByteArray &img_data, int width, int height, int bytes_for_color, int quality, int subsampling) {
+	ERR_FAIL_COND_V(!_grutils_data_server, Error::ERR_UNCONFIGURED);
+	return compress_jpg(ret, _grutils_data_server->compress_buffer, img_data, width, height, bytes_for_color, quality, subsampling);
+}
+
+Error compress_jpg(PoolByteArray &ret, PoolByteArray &out_buffer, const PoolByteArray &img_data, int width, int height, int bytes_for_color, int quality, int subsampling) {
 	PoolByteArray res;
 	ERR_FAIL_COND_V(img_data.size() == 0, Error::ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(out_buffer.size() == 0, Error::ERR_INVALID_PARAMETER);
 	ERR_FAIL_COND_V(quality < 1 || quality > 100, Error::ERR_INVALID_PARAMETER);
 
 	jpge::params params;
@@ -165,9 +322,9 @@ Error compress_jpg(PoolByteArray &ret, const PoolByteArray &img_data, int width,
 	params.m_subsampling = (jpge::subsampling_t)subsampling;
 
 	ERR_FAIL_COND_V(!params.check(), Error::ERR_INVALID_PARAMETER);
-	auto rb = _grutils_data_server->compress_buffer.read();
+	auto rb = out_buffer.read();
 	auto ri = img_data.read();
-	int size = _grutils_data_server->compress_buffer.size();
+	int size = out_buffer.size();
 
 	TimeCountInit();
 
@@ -199,8 +356,110 @@ Error compress_jpg(PoolByteArray &ret, const PoolByteArray &img_data, int width,
 }
 #endif
 
+#ifndef NO_GODOTREMOTE_ZSTD
+// streaming zstd with configurable level and optional dictionary.
+// output grows by ZSTD_CStreamOutSize() blocks instead of being allocated up front
+static Error zstd_compress(const PoolByteArray &bytes, PoolByteArray &res) {
+	ZSTD_CCtx *ctx = ZSTD_createCCtx();
+	ERR_FAIL_COND_V_MSG(!ctx, Error::ERR_OUT_OF_MEMORY, "Can't create zstd context");
+
+	if (_grutils_data && _grutils_data->zstd_cdict) {
+		ZSTD_CCtx_refCDict(ctx, _grutils_data->zstd_cdict);
+	} else {
+		ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, _grutils_data ? _grutils_data->zstd_level : ZSTD_CLEVEL_DEFAULT);
+	}
+	ZSTD_CCtx_setPledgedSrcSize(ctx, bytes.size());
+
+	Error err = Error::OK;
+	const size_t block_size = ZSTD_CStreamOutSize();
+	size_t written = 0;
+	size_t left = 0;
+
+	auto r = bytes.read();
+	ZSTD_inBuffer in = { r.ptr(), (size_t)bytes.size(), 0 };
+	do {
+		err = res.resize(written + block_size);
+		if (err)
+			break;
+
+		auto w = res.write();
+		ZSTD_outBuffer out = { w.ptr() + written, block_size, 0 };
+		left = ZSTD_compressStream2(ctx, &out, &in, ZSTD_e_end);
+		written += out.pos;
+
+		if (ZSTD_isError(left)) {
+			ERR_PRINT("Can't compress bytes: " + String(ZSTD_getErrorName(left)));
+			err = Error::FAILED;
+			break;
+		}
+	} while (left != 0);
+
+	ZSTD_freeCCtx(ctx);
+
+	if (err) {
+		res = PoolByteArray();
+	} else {
+		res.resize(written);
+	}
+	return err;
+}
+
+static Error zstd_decompress(const PoolByteArray &bytes, int output_size, PoolByteArray &res) {
+	ZSTD_DCtx *ctx = ZSTD_createDCtx();
+	ERR_FAIL_COND_V_MSG(!ctx, Error::ERR_OUT_OF_MEMORY, "Can't create zstd context");
+
+	if (_grutils_data && _grutils_data->zstd_ddict) {
+		ZSTD_DCtx_refDDict(ctx, _grutils_data->zstd_ddict);
+	}
+
+	Error err = res.resize(output_size);
+	if (!err) {
+		auto r = bytes.read();
+		auto w = res.write();
+		ZSTD_inBuffer in = { r.ptr(), (size_t)bytes.size(), 0 };
+		ZSTD_outBuffer out = { w.ptr(), (size_t)output_size, 0 };
+
+		size_t left = 1;
+		while (left != 0) {
+			left = ZSTD_decompressStream(ctx, &out, &in);
+			if (ZSTD_isError(left)) {
+				ERR_PRINT("Can't decompress bytes: " + String(ZSTD_getErrorName(left)));
+				err = Error::FAILED;
+				break;
+			}
+			// truncated input or output bigger than expected
+			if (left != 0 && (in.pos == in.size || out.pos == out.size)) {
+				ERR_PRINT("Desired size not equal to real size");
+				err = Error::FAILED;
+				break;
+			}
+		}
+
+		// frame ended before the desired size or something follows it
+		if (!err && (out.pos != (size_t)output_size || in.pos != in.size)) {
+			ERR_PRINT("Desired size not equal to real size");
+			err = Error::FAILED;
+		}
+	}
+
+	ZSTD_freeDCtx(ctx);
+
+	if (err) {
+		res = PoolByteArray();
+	}
+	return err;
+}
+#endif
+
 Error compress_bytes(const PoolByteArray &bytes, PoolByteArray &res, int type) {
-	Error err = res.resize(bytes.size());
+#ifndef NO_GODOTREMOTE_ZSTD
+	if (type == Compression::MODE_ZSTD) {
+		return zstd_compress(bytes, res);
+	}
+#endif
+
+	// incompressible data can be bigger than the input
+	Error err = res.resize(Compression::get_max_compressed_buffer_size(bytes.size(), (Compression::Mode)type));
 
 	ERR_FAIL_COND_V_MSG(err, err, "Can't resize output array");
 
@@ -211,7 +470,7 @@ Error compress_bytes(const PoolByteArray &bytes, PoolByteArray &res, int type) {
 		size = Compression::compress(w.ptr(), r.ptr(), bytes.size(), (Compression::Mode)type);
 	}
 
-	if (size) {
+	if (size > 0) {
 		res.resize(size);
 	} else {
 		ERR_PRINT("Can't resize output array after compression");
@@ -223,6 +482,12 @@ Error compress_bytes(const PoolByteArray &bytes, PoolByteArray &res, int type) {
 }
 
 Error decompress_bytes(const PoolByteArray &bytes, int output_size, PoolByteArray &res, int type) {
+#ifndef NO_GODOTREMOTE_ZSTD
+	if (type == Compression::MODE_ZSTD) {
+		return zstd_decompress(bytes, output_size, res);
+	}
+#endif
+
 	Error err = res.resize(output_size);
 	ERR_FAIL_COND_V_MSG(err, err, "Can't resize output array");
 
@@ -232,7 +497,7 @@ Error decompress_bytes(const PoolByteArray &bytes, int output_size, PoolByteArra
 		auto w = res.write();
 		size = Compression::decompress(w.ptr(), output_size, r.ptr(), bytes.size(), (Compression::Mode)type);
 	}
-	if (output_size == -1) {
+	if (size == -1) {
 		ERR_PRINT("Can't decompress bytes");
 		err = Error::FAILED;
 		res = PoolByteArray();
@@ -244,6 +509,562 @@ Error decompress_bytes(const PoolByteArray &bytes, int output_size, PoolByteArra
 	return err;
 }
 
+void clock_sync::add_sample(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3) {
+	if (t3 < t0)
+		return;
+
+	Sample smp;
+	smp.local_time = t0 + (t3 - t0) / 2;
+	smp.offset = ((int64_t)t1 - (int64_t)t0 + (int64_t)t2 - (int64_t)t3) / 2;
+	smp.rtt = max((int64_t)(t3 - t0) - ((int64_t)t2 - (int64_t)t1), (int64_t)0);
+
+	samples.push_back(smp);
+	while ((int)samples.size() > max_samples)
+		samples.pop_front();
+
+	const Sample *best = &samples.front();
+	for (auto it = samples.begin(); it != samples.end(); it++) {
+		if (it->rtt < best->rtt)
+			best = &(*it);
+	}
+
+	// least squares over samples not delayed much more than the best one
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	int n = 0;
+	const int64_t rtt_limit = best->rtt * 2 + 1000;
+	for (auto it = samples.begin(); it != samples.end(); it++) {
+		if (it->rtt > rtt_limit)
+			continue;
+		double x = ((int64_t)it->local_time - (int64_t)best->local_time) / 1000000.0;
+		double y = (double)(it->offset - best->offset);
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+		n++;
+	}
+
+	double den = n * sxx - sx * sx;
+	if (n >= 4 && (samples.back().local_time - samples.front().local_time) > 2000000 && den > 0) {
+		drift = (n * sxy - sx * sy) / den;
+	}
+
+	offset = best->offset;
+	offset_time = best->local_time;
+	rtt = best->rtt;
+	synced = true;
+}
+
+void clock_sync::set_offset(int64_t _offset, uint64_t local_time) {
+	if (synced)
+		return;
+	offset = _offset;
+	offset_time = local_time;
+}
+
+int64_t clock_sync::get_offset(uint64_t local_time) const {
+	return offset + (int64_t)(drift * (((int64_t)local_time - (int64_t)offset_time) / 1000000.0));
+}
+
+void clock_sync::reset() {
+	samples.clear();
+	offset = 0;
+	offset_time = 0;
+	rtt = 0;
+	drift = 0;
+	synced = false;
+}
+
+int log_buckets::_highest_bit(uint64_t value) {
+	int res = 0;
+	if (value >> 32) {
+		value >>= 32;
+		res += 32;
+	}
+	if (value >> 16) {
+		value >>= 16;
+		res += 16;
+	}
+	if (value >> 8) {
+		value >>= 8;
+		res += 8;
+	}
+	if (value >> 4) {
+		value >>= 4;
+		res += 4;
+	}
+	if (value >> 2) {
+		value >>= 2;
+		res += 2;
+	}
+	if (value >> 1) {
+		res += 1;
+	}
+	return res;
+}
+
+int log_buckets::get_index(uint64_t value) {
+	if (value < 8)
+		return (int)value;
+
+	// 3 bits after the highest one select the sub-bucket
+	int exp = _highest_bit(value);
+	return 8 + (exp - 3) * 8 + (int)((value >> (exp - 3)) & 7);
+}
+
+uint64_t log_buckets::get_lower_bound(int idx) {
+	if (idx < 8)
+		return idx;
+
+	int exp = (idx - 8) / 8 + 3;
+	uint64_t mantissa = 8 + (idx - 8) % 8;
+	return mantissa << (exp - 3);
+}
+
+uint64_t log_buckets::get_upper_bound(int idx) {
+	if (idx < 8)
+		return idx;
+
+	int exp = (idx - 8) / 8 + 3;
+	return get_lower_bound(idx) + (uint64_t(1) << (exp - 3)) - 1;
+}
+
+uint64_t log_buckets::get_middle(int idx) {
+	if (idx < 8)
+		return idx;
+
+	int exp = (idx - 8) / 8 + 3;
+	return get_lower_bound(idx) + ((uint64_t(1) << (exp - 3)) >> 1);
+}
+
+void window_stats::_pop_front() {
+	uint64_t v = values.front();
+	if (values.size() > 1) {
+		uint64_t next = values[1];
+		jitter_sum -= v > next ? v - next : next - v;
+	}
+	sum -= v;
+	sum_sq -= v * v;
+	buckets[log_buckets::get_index(v)]--;
+	if (min_candidates.front() == v)
+		min_candidates.pop_front();
+	if (max_candidates.front() == v)
+		max_candidates.pop_front();
+	values.pop_front();
+}
+
+void window_stats::add(uint64_t value, uint32_t limit) {
+	if (!values.empty()) {
+		uint64_t prev = values.back();
+		jitter_sum += value > prev ? value - prev : prev - value;
+	}
+	values.push_back(value);
+	sum += value;
+	sum_sq += value * value;
+	buckets[log_buckets::get_index(value)]++;
+
+	while (!min_candidates.empty() && min_candidates.back() > value)
+		min_candidates.pop_back();
+	min_candidates.push_back(value);
+	while (!max_candidates.empty() && max_candidates.back() < value)
+		max_candidates.pop_back();
+	max_candidates.push_back(value);
+
+	while (values.size() > limit) {
+		_pop_front();
+	}
+}
+
+void window_stats::clear() {
+	values.clear();
+	min_candidates.clear();
+	max_candidates.clear();
+	for (int i = 0; i < buckets_count; i++) {
+		buckets[i] = 0;
+	}
+	sum = sum_sq = jitter_sum = 0;
+}
+
+double window_stats::get_avg() const {
+	return values.empty() ? 0 : (double)sum / values.size();
+}
+
+double window_stats::get_stddev() const {
+	if (values.empty())
+		return 0;
+	double avg = get_avg();
+	double var = (double)sum_sq / values.size() - avg * avg;
+	return var > 0 ? Math::sqrt(var) : 0;
+}
+
+double window_stats::get_jitter() const {
+	return values.size() > 1 ? (double)jitter_sum / (values.size() - 1) : 0;
+}
+
+uint64_t window_stats::get_percentile(double p) const {
+	if (values.empty())
+		return 0;
+
+	uint64_t target = (uint64_t)Math::ceil(values.size() * p);
+	uint64_t acc = 0;
+	for (int i = 0; i < buckets_count; i++) {
+		acc += buckets[i];
+		if (acc >= target && buckets[i]) {
+			// bucket value can be outside of the real range
+			uint64_t v = log_buckets::get_middle(i);
+			return v < get_min() ? get_min() : (v > get_max() ? get_max() : v);
+		}
+	}
+	return get_max();
+}
+
+Dictionary window_stats::get_dictionary(double scale) const {
+	Dictionary res;
+	res["count"] = (int)values.size();
+	res["avg"] = get_avg() * scale;
+	res["min"] = get_min() * scale;
+	res["max"] = get_max() * scale;
+	res["p50"] = get_percentile(0.5) * scale;
+	res["p95"] = get_percentile(0.95) * scale;
+	res["p99"] = get_percentile(0.99) * scale;
+	res["stddev"] = get_stddev() * scale;
+	res["jitter"] = get_jitter() * scale;
+	return res;
+}
+
+void latency_histogram::add(uint64_t value) {
+	int idx = log_buckets::get_index(value);
+	buckets[idx < buckets_count ? idx : buckets_count - 1].fetch_add(1);
+	count.fetch_add(1);
+	sum.fetch_add(value);
+
+	uint64_t prev = max_value.load();
+	while (value > prev && !max_value.compare_exchange_weak(prev, value)) {
+	}
+}
+
+uint64_t latency_histogram::get_percentile(double p) const {
+	uint64_t total = count.load();
+	if (!total)
+		return 0;
+
+	uint64_t target = (uint64_t)Math::ceil(total * p);
+	uint64_t acc = 0;
+	uint64_t max_val = max_value.load();
+	for (int i = 0; i < buckets_count - 1; i++) {
+		acc += buckets[i].load();
+		if (acc >= target) {
+			uint64_t v = log_buckets::get_middle(i);
+			return v > max_val ? max_val : v;
+		}
+	}
+	return max_val;
+}
+
+Dictionary latency_histogram::get_dictionary() const {
+	Dictionary res;
+	uint64_t total = count.load();
+	res["count"] = (int64_t)total;
+	res["avg"] = total ? (sum.load() / (double)total) / 1000.0 : 0.0;
+	res["max"] = max_value.load() / 1000.0;
+	res["p50"] = get_percentile(0.5) / 1000.0;
+	res["p95"] = get_percentile(0.95) / 1000.0;
+	res["p99"] = get_percentile(0.99) / 1000.0;
+
+	PoolRealArray bounds;
+	PoolIntArray counts;
+	for (int i = 0; i < buckets_count; i++) {
+		uint32_t c = buckets[i].load();
+		if (c) {
+			bounds.push_back(log_buckets::get_upper_bound(i) / 1000.0f);
+			counts.push_back((int)c);
+		}
+	}
+	res["bucket_bounds"] = bounds;
+	res["bucket_counts"] = counts;
+	return res;
+}
+
+void latency_histogram::reset() {
+	for (int i = 0; i < buckets_count; i++) {
+		buckets[i].store(0);
+	}
+	count.store(0);
+	sum.store(0);
+	max_value.store(0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TRAFFIC COUNTERS
+
+void traffic_counters::reset() {
+	for (int i = 0; i < types_count; i++) {
+		bytes[i].store(0);
+		packets[i].store(0);
+	}
+}
+
+#ifdef GODOTREMOTE_BENCHMARK
+//////////////////////////////////////////////////////////////////////////
+// THREAD CPU
+
+struct ThreadCpuTotal {
+	uint64_t cpu = 0;
+	uint64_t wall = 0;
+	int threads = 0;
+};
+
+struct ThreadCpuRunning {
+	String name;
+	uint64_t cpu_start = 0;
+	uint64_t wall_start = 0;
+	bool has_clock = false;
+#ifdef GR_THREAD_CPU_CLOCK
+	clockid_t clock;
+#endif
+};
+
+static Mutex thread_cpu_mutex;
+static std::map<String, ThreadCpuTotal> thread_cpu_totals;
+static std::map<uint32_t, ThreadCpuRunning> thread_cpu_running;
+static uint32_t thread_cpu_next_id = 0;
+
+uint64_t thread_cpu_time() {
+#if defined(UNIX_ENABLED) && defined(CLOCK_THREAD_CPUTIME_ID)
+	timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+	return 0;
+}
+
+// cpu time of a running thread, read from any thread
+static uint64_t _thread_cpu_time(const ThreadCpuRunning &t) {
+#ifdef GR_THREAD_CPU_CLOCK
+	timespec ts;
+	if (t.has_clock && clock_gettime(t.clock, &ts) == 0)
+		return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+	return t.cpu_start;
+}
+
+void thread_cpu_add(const String &name, uint64_t cpu_time, uint64_t wall_time) {
+	thread_cpu_mutex.lock();
+	ThreadCpuTotal &t = thread_cpu_totals[name];
+	t.cpu += cpu_time;
+	t.wall += wall_time;
+	t.threads++;
+	thread_cpu_mutex.unlock();
+}
+
+uint32_t thread_cpu_begin(const String &name) {
+	ThreadCpuRunning t;
+	t.name = name;
+	t.cpu_start = thread_cpu_time();
+	t.wall_start = OS::get_singleton()->get_ticks_usec();
+#ifdef GR_THREAD_CPU_CLOCK
+	t.has_clock = pthread_getcpuclockid(pthread_self(), &t.clock) == 0;
+#endif
+
+	thread_cpu_mutex.lock();
+	uint32_t id = thread_cpu_next_id++;
+	thread_cpu_running[id] = t;
+	thread_cpu_mutex.unlock();
+	return id;
+}
+
+void thread_cpu_end(uint32_t id) {
+	uint64_t cpu = thread_cpu_time();
+	uint64_t wall = OS::get_singleton()->get_ticks_usec();
+
+	thread_cpu_mutex.lock();
+	auto it = thread_cpu_running.find(id);
+	if (it != thread_cpu_running.end()) {
+		ThreadCpuTotal &t = thread_cpu_totals[it->second.name];
+		t.cpu += cpu - it->second.cpu_start;
+		t.wall += wall - it->second.wall_start;
+		t.threads++;
+		thread_cpu_running.erase(it);
+	}
+	thread_cpu_mutex.unlock();
+}
+
+Dictionary thread_cpu_get_dictionary() {
+	Dictionary res;
+	uint64_t wall = OS::get_singleton()->get_ticks_usec();
+	thread_cpu_mutex.lock();
+	std::map<String, ThreadCpuTotal> totals = thread_cpu_totals;
+	for (auto p : thread_cpu_running) {
+		ThreadCpuTotal &t = totals[p.second.name];
+		t.cpu += _thread_cpu_time(p.second) - p.second.cpu_start;
+		t.wall += wall - p.second.wall_start;
+		t.threads++;
+	}
+	thread_cpu_mutex.unlock();
+
+	for (auto p : totals) {
+		Dictionary d;
+		d["cpu"] = p.second.cpu / 1000.0;
+		d["wall"] = p.second.wall / 1000.0;
+		d["threads"] = p.second.threads;
+		res[p.first] = d;
+	}
+	return res;
+}
+
+// running threads are counted from now
+void thread_cpu_reset() {
+	uint64_t wall = OS::get_singleton()->get_ticks_usec();
+	thread_cpu_mutex.lock();
+	thread_cpu_totals.clear();
+	for (auto &p : thread_cpu_running) {
+		p.second.cpu_start = _thread_cpu_time(p.second);
+		p.second.wall_start = wall;
+	}
+	thread_cpu_mutex.unlock();
+}
+#endif // GODOTREMOTE_BENCHMARK
+
+//////////////////////////////////////////////////////////////////////////
+// TRACE
+
+std::atomic<bool> _trace_enabled = { false };
+
+struct TraceEvent {
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+};
+
+struct TraceBuffer {
+	static const int size = 16384;
+	String name;
+	int tid = 0;
+	TraceEvent events[size];
+	std::atomic<uint32_t> written = { 0 };
+};
+
+static Mutex trace_mutex;
+static std::vector<TraceBuffer *> trace_buffers;
+// cached thread buffers are invalid after _trace_free
+static std::atomic<uint32_t> trace_generation = { 1 };
+static thread_local TraceBuffer *trace_thread_buffer = nullptr;
+static thread_local uint32_t trace_thread_generation = 0;
+static thread_local const char *trace_thread_name = nullptr;
+
+// must be called with trace_mutex locked
+static TraceBuffer *_trace_get_buffer(const String &name) {
+	for (TraceBuffer *b : trace_buffers) {
+		if (b->name == name)
+			return b;
+	}
+
+	TraceBuffer *b = memnew(TraceBuffer);
+	b->name = name;
+	b->tid = (int)trace_buffers.size() + 1;
+	trace_buffers.push_back(b);
+	return b;
+}
+
+static void _trace_bind_thread(const String &name) {
+	trace_mutex.lock();
+	trace_thread_buffer = _trace_get_buffer(name);
+	trace_thread_generation = trace_generation.load();
+	trace_mutex.unlock();
+}
+
+static void _trace_free() {
+	trace_mutex.lock();
+	trace_generation++;
+	for (TraceBuffer *b : trace_buffers) {
+		memdelete(b);
+	}
+	trace_buffers.clear();
+	trace_mutex.unlock();
+}
+
+void trace_set_enabled(bool enabled) {
+	_trace_enabled.store(enabled);
+}
+
+bool trace_is_enabled() {
+	return _trace_enabled.load();
+}
+
+void trace_set_thread_name(const char *name) {
+	// buffer is created on the first event
+	if (trace_thread_name != name) {
+		trace_thread_name = name;
+		trace_thread_buffer = nullptr;
+	}
+}
+
+void trace_add(const char *name, uint64_t start, uint64_t end) {
+	if (!trace_thread_buffer || trace_thread_generation != trace_generation.load()) {
+		if (trace_thread_name) {
+			_trace_bind_thread(trace_thread_name);
+		} else if (Thread::get_caller_id() == Thread::get_main_id()) {
+			_trace_bind_thread("main");
+		} else {
+			_trace_bind_thread("thread " + str((int64_t)Thread::get_caller_id()));
+		}
+	}
+
+	// only this thread writes to the buffer
+	TraceBuffer *b = trace_thread_buffer;
+	uint32_t idx = b->written.load(std::memory_order_relaxed);
+	TraceEvent &e = b->events[idx % TraceBuffer::size];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+	b->written.store(idx + 1, std::memory_order_release);
+}
+
+Error trace_dump(const String &path) {
+	Error err = Error::OK;
+	FileAccess *f = FileAccess::open(path, FileAccess::WRITE, &err);
+	if (err) {
+		_log("Can't open trace file " + path + ". Code: " + str(err), LogLevel::LL_ERROR);
+		return err;
+	}
+
+	String pid = str((int64_t)OS::get_singleton()->get_process_id());
+	bool first = true;
+	f->store_string("{\"traceEvents\":[\n");
+
+	trace_mutex.lock();
+	for (TraceBuffer *b : trace_buffers) {
+		String tid = str(b->tid);
+		f->store_string(String(first ? "" : ",\n") + "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":\"" + b->name + "\"}}");
+		first = false;
+
+		// events can be overwritten while dumping, it is not critical here
+		uint32_t written = b->written.load(std::memory_order_acquire);
+		uint32_t count = written > (uint32_t)TraceBuffer::size ? (uint32_t)TraceBuffer::size : written;
+		for (uint32_t i = written - count; i != written; i++) {
+			const TraceEvent &e = b->events[i % TraceBuffer::size];
+			f->store_string(",\n{\"name\":\"" + String(e.name) + "\",\"cat\":\"godot_remote\",\"ph\":\"X\",\"ts\":" + str((int64_t)e.start) +
+							",\"dur\":" + str((int64_t)(e.end - e.start)) + ",\"pid\":" + pid + ",\"tid\":" + tid + "}");
+		}
+	}
+	trace_mutex.unlock();
+
+	f->store_string("\n]}\n");
+	f->close();
+	memdelete(f);
+
+	_log("Trace saved to " + path, LogLevel::LL_NORMAL);
+	return err;
+}
+
+void trace_clear() {
+	trace_mutex.lock();
+	for (TraceBuffer *b : trace_buffers) {
+		b->written.store(0);
+	}
+	trace_mutex.unlock();
+}
+
 String str(const Variant &val) {
 	Variant::Type type = val.get_type();
 	switch (type) {
@@ -385,6 +1206,32 @@ bool compare_pool_byte_arrays(const PoolByteArray &a, const PoolByteArray &b) {
 	return true;
 }
 
+String get_pck_content_hash(const String &scene_path, const std::vector<String> &files, const std::vector<Vector<uint8_t> > &contents) {
+	ERR_FAIL_COND_V(files.size() != contents.size(), "");
+
+	CryptoCore::SHA256Context sha;
+	sha.start();
+	CharString key = scene_path.utf8();
+	sha.update((const uint8_t *)key.get_data(), key.size());
+
+	// patched packs on the client have files in another order
+	std::vector<int> order;
+	for (int i = 0; i < files.size(); i++) {
+		order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&files](int a, int b) { return files[a] < files[b]; });
+
+	for (int i = 0; i < order.size(); i++) {
+		CharString p = files[order[i]].utf8();
+		sha.update((const uint8_t *)p.get_data(), p.size());
+		sha.update(contents[order[i]].ptr(), contents[order[i]].size());
+	}
+
+	unsigned char hash[32];
+	sha.finish(hash);
+	return String::hex_encode_buffer(hash, 32);
+}
+
 void set_gravity(const Vector3 &p_gravity) {
 	auto *id = (InputDefault *)Input::get_singleton();
 	if (id)
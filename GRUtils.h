@@ -3,6 +3,7 @@
 #define GRUTILS_H
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <map>
 #include <queue>
@@ -15,17 +16,24 @@
 #include "core/variant.h"
 #include "core/io/marshalls.h"
 #include "core/os/os.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
 #include "main/input_default.h"
 
 #include "GRLiterals.h"
 
+#ifndef NO_GODOTREMOTE_ZSTD
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+#endif
+
 #ifdef DEBUG_ENABLED
 
 #define TimeCountInit() int simple_time_counter = OS::get_singleton()->get_ticks_usec()
 #define TimeCountReset() simple_time_counter = OS::get_singleton()->get_ticks_usec()
 // Shows delta between this and previous counter. Need to call TimeCountInit before
 #define TimeCount(str)                                                                                                                                      \
-	GRUtils::_log(str + String(": ") + String::num((OS::get_singleton()->get_ticks_usec() - simple_time_counter) / 1000.0, 3) + " ms", LogLevel::LL_DEBUG); \
+	_log(str + String(": ") + String::num((OS::get_singleton()->get_ticks_usec() - simple_time_counter) / 1000.0, 3) + " ms", LogLevel::LL_DEBUG); \
 	simple_time_counter = OS::get_singleton()->get_ticks_usec()
 
 // Bind constant with custom name
@@ -44,7 +52,24 @@
 
 #endif // DEBUG_ENABLED
 
-#if TOOLS_ENABLED
+// Records the rest of the current scope when the tracer is enabled.
+// must not be jumped over by goto
+#define GR_TRACE_SCOPE(name) GRUtils::trace_scope _gr_trace_scope(name)
+
+// Adds cpu and wall time of the rest of the thread function to the totals of this name.
+// only in benchmark builds
+#ifdef GODOTREMOTE_BENCHMARK
+#define GR_THREAD_CPU_SCOPE(name) GRUtils::thread_cpu_scope _gr_thread_cpu_scope(name)
+#else
+#define GR_THREAD_CPU_SCOPE(name)
+#endif
+
+#if TOOLS_ENABLED && defined(GODOTREMOTE_BENCHMARK)
+// benchmarks run devices with --no-window
+# define LEAVE_IF_EDITOR()                            \
+	if (Engine::get_singleton()->is_editor_hint())    \
+		return;
+#elif TOOLS_ENABLED
 # define LEAVE_IF_EDITOR()                                   \
 	if (Engine::get_singleton()->is_editor_hint()            \
 		|| OS::get_singleton()->is_no_window_mode_enabled()) \
@@ -56,7 +81,17 @@
 #define newref(_class) Ref<_class>(memnew(_class))
 #define max(x, y) (x > y ? x : y)
 #define min(x, y) (x < y ? x : y)
-#define _log(val, ll) log_str(val, ll, __FILE__, __LINE__)
+// Arguments are evaluated only if the level is enabled.
+// each call site prints at most log_rate_limiter::max_per_second messages
+#define _log(val, ll)                                                                 \
+	do {                                                                              \
+		if (GRUtils::is_log_level_enabled(ll)) {                                      \
+			static GRUtils::log_rate_limiter _gr_log_limiter(__FILE__, __LINE__, ll); \
+			uint32_t _gr_log_suppressed = 0;                                          \
+			if (_gr_log_limiter.allow(_gr_log_suppressed))                            \
+				GRUtils::log_str(val, ll, __FILE__, __LINE__, _gr_log_suppressed);    \
+		}                                                                             \
+	} while (0)
 #define is_vector_contains(vec, val) (std::find(vec.begin(), vec.end(), val) != vec.end())
 #define sleep_usec(usec) OS::get_singleton()->delay_usec(usec)
 
@@ -100,50 +135,237 @@ enum LogLevel {
 namespace GRUtils {
 // DEFINES
 
-template <typename T, typename Container = std::deque<T> >
-class iterable_queue : public std::queue<T, Container> {
+// Log-scale histogram buckets shared by window_stats and latency_histogram.
+// values below 8 have own buckets, others are split into 8 sub-buckets
+// for every power of two, so a bucket is within ~6% of its values
+class log_buckets {
+	static int _highest_bit(uint64_t value);
+
 public:
-	typedef typename Container::iterator iterator;
-	typedef typename Container::const_iterator const_iterator;
-
-	iterator begin() { return this->c.begin(); }
-	iterator end() { return this->c.end(); }
-	const_iterator begin() const { return this->c.begin(); }
-	const_iterator end() const { return this->c.end(); }
-	void add_value_limited(T value, uint32_t limit) {
-		if (value > 100000)
-			this->push(100000);
-		else
-			this->push(value);
-		while (this->size() > limit) {
-			this->pop();
-		}
-	}
+	// number of buckets for values below 2^bits
+	static constexpr int get_count(int bits) { return 8 + (bits - 3) * 8; }
+	static int get_index(uint64_t value);
+	static uint64_t get_lower_bound(int idx);
+	// last value of the bucket
+	static uint64_t get_upper_bound(int idx);
+	static uint64_t get_middle(int idx);
+};
+
+// Statistics of the last N values with O(1) updates.
+// percentiles come from a log-scale histogram of the window, so they are
+// rounded to ~6% of the value
+class window_stats {
+	static const int buckets_count = log_buckets::get_count(64);
+
+	std::deque<uint64_t> values;
+	// monotonic queues for the window minimum and maximum
+	std::deque<uint64_t> min_candidates;
+	std::deque<uint64_t> max_candidates;
+	uint32_t buckets[buckets_count];
+	uint64_t sum = 0;
+	uint64_t sum_sq = 0;
+	uint64_t jitter_sum = 0; // differences of consecutive values
+
+	void _pop_front();
+
+public:
+	void add(uint64_t value, uint32_t limit);
+	void clear();
+
+	uint32_t size() const { return (uint32_t)values.size(); }
+	double get_avg() const;
+	uint64_t get_min() const { return min_candidates.empty() ? 0 : min_candidates.front(); }
+	uint64_t get_max() const { return max_candidates.empty() ? 0 : max_candidates.front(); }
+	double get_stddev() const;
+	// mean absolute difference between consecutive values
+	double get_jitter() const;
+	uint64_t get_percentile(double p) const;
+	// all values are multiplied by scale
+	Dictionary get_dictionary(double scale = 1.0) const;
+
+	window_stats() { clear(); }
 };
 
+// Unbounded lock-free queue. Any thread can push, only one thread can pop.
+// nodes are taken from a preallocated pool, only the overflow is allocated
 template <typename T>
-inline void calculate_avg_min_max_values(const iterable_queue<T> &v, float *avg_val, float *min_val, float *max_val, float(modifier)(double)) {
-	if (v.size() > 0) {
-		double sum = 0;
-		*min_val = (float)v.back();
-		*max_val = (float)v.back();
-
-		for (T i : v) {
-			sum += i;
-			if (i < *min_val)
-				*min_val = (float)i;
-			else if (i > *max_val)
-				*max_val = (float)i;
+class mpsc_queue {
+	struct Node {
+		std::atomic<Node *> next;
+		std::atomic<uint32_t> free_next; // pool index of the next free node
+		int32_t pool_index = -1; // -1 if allocated when the pool was empty
+		T value;
+	};
+
+	static const uint32_t no_free_node = 0xFFFFFFFF;
+
+	std::atomic<Node *> head;
+	Node *tail;
+
+	Node *pool = nullptr;
+	// index of the first free node in the low half and counter
+	// of changes in the high half, so reused nodes don't break CAS
+	std::atomic<uint64_t> free_head;
+
+	Node *_acquire_node() {
+		uint64_t h = free_head.load(std::memory_order_acquire);
+		while ((uint32_t)h != no_free_node) {
+			Node *n = &pool[(uint32_t)h];
+			uint64_t new_h = (((h >> 32) + 1) << 32) | n->free_next.load(std::memory_order_relaxed);
+			if (free_head.compare_exchange_weak(h, new_h, std::memory_order_acquire, std::memory_order_acquire))
+				return n;
 		}
-		*avg_val = modifier(sum / v.size());
-		*min_val = modifier(*min_val);
-		*max_val = modifier(*max_val);
-	} else {
-		*avg_val = 0;
-		*min_val = 0;
-		*max_val = 0;
+		return memnew(Node);
 	}
-}
+
+	void _release_node(Node *n) {
+		if (n->pool_index < 0) {
+			memdelete(n);
+			return;
+		}
+
+		uint64_t h = free_head.load(std::memory_order_relaxed);
+		uint64_t new_h;
+		do {
+			n->free_next.store((uint32_t)h, std::memory_order_relaxed);
+			new_h = (((h >> 32) + 1) << 32) | (uint32_t)n->pool_index;
+		} while (!free_head.compare_exchange_weak(h, new_h, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+public:
+	void push(const T &value) {
+		Node *n = _acquire_node();
+		n->value = value;
+		n->next.store(nullptr, std::memory_order_relaxed);
+		Node *prev = head.exchange(n, std::memory_order_acq_rel);
+		prev->next.store(n, std::memory_order_release);
+	}
+
+	bool pop(T &r_value) {
+		Node *next = tail->next.load(std::memory_order_acquire);
+		if (!next)
+			return false;
+		r_value = next->value;
+		next->value = T(); // next becomes new stub
+		_release_node(tail);
+		tail = next;
+		return true;
+	}
+
+	bool empty() const {
+		return tail->next.load(std::memory_order_acquire) == nullptr;
+	}
+
+	// returns number of removed values
+	int clear() {
+		T tmp;
+		int count = 0;
+		while (pop(tmp)) {
+			count++;
+		}
+		return count;
+	}
+
+	mpsc_queue(int pool_size = 1024) {
+		pool = memnew_arr(Node, pool_size);
+		for (int i = 0; i < pool_size; i++) {
+			pool[i].pool_index = i;
+			pool[i].free_next.store(i + 1 < pool_size ? i + 1 : no_free_node, std::memory_order_relaxed);
+		}
+		free_head.store(pool_size ? 0 : no_free_node, std::memory_order_relaxed);
+
+		Node *stub = _acquire_node();
+		stub->next.store(nullptr, std::memory_order_relaxed);
+		head.store(stub, std::memory_order_relaxed);
+		tail = stub;
+	}
+
+	~mpsc_queue() {
+		clear();
+		_release_node(tail);
+		memdelete_arr(pool);
+	}
+};
+
+// NTP-style estimation of the offset between local and remote clocks.
+// offset comes from the sample with the lowest round trip, drift from a linear fit of the good samples
+class clock_sync {
+	struct Sample {
+		uint64_t local_time = 0;
+		int64_t offset = 0;
+		int64_t rtt = 0;
+	};
+
+	std::deque<Sample> samples;
+	int64_t offset = 0;
+	uint64_t offset_time = 0;
+	int64_t rtt = 0;
+	double drift = 0; // usec per sec
+	bool synced = false;
+
+public:
+	int max_samples = 16;
+
+	// t0 - request sent (local), t1 - request received (remote), t2 - reply sent (remote), t3 - reply received (local)
+	void add_sample(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3);
+	// rough value without round trip. ignored after the first sample
+	void set_offset(int64_t _offset, uint64_t local_time);
+	// remote time minus local time
+	int64_t get_offset(uint64_t local_time) const;
+	double get_drift_ppm() const { return drift; }
+	int64_t get_rtt() const { return rtt; }
+	bool is_synced() const { return synced; }
+	void reset();
+};
+
+// Latency histogram with log_buckets up to ~71 min, bigger values go to the last bucket.
+// can be updated from any thread, values are in usec
+class latency_histogram {
+public:
+	static const int buckets_count = log_buckets::get_count(32);
+
+private:
+	std::atomic<uint32_t> buckets[buckets_count];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> max_value;
+
+public:
+	void add(uint64_t value);
+	uint64_t get_count() const { return count.load(); }
+	uint64_t get_sum() const { return sum.load(); }
+	// middle of the bucket where the percentile falls, not more than max
+	uint64_t get_percentile(double p) const;
+	// count, avg, max, p50, p95, p99 in ms and upper bounds with counts of non-empty buckets
+	Dictionary get_dictionary() const;
+	void reset();
+
+	latency_histogram() { reset(); }
+};
+
+// Bytes and number of packets by type, the first byte of a packet.
+// can be updated from any thread
+class traffic_counters {
+public:
+	static const int types_count = 256;
+
+private:
+	std::atomic<uint64_t> bytes[types_count];
+	std::atomic<uint64_t> packets[types_count];
+
+public:
+	_FORCE_INLINE_ void add(uint8_t type, uint64_t size) {
+		bytes[type].fetch_add(size, std::memory_order_relaxed);
+		packets[type].fetch_add(1, std::memory_order_relaxed);
+	}
+	uint64_t get_bytes(int type) const { return bytes[type].load(std::memory_order_relaxed); }
+	uint64_t get_packets(int type) const { return packets[type].load(std::memory_order_relaxed); }
+	void reset();
+
+	traffic_counters() { reset(); }
+};
+
+class log_rate_limiter;
 
 class GRUtilsData : public Object {
 	GDCLASS(GRUtilsData, Object);
@@ -152,10 +374,66 @@ public:
 	int current_loglevel;
 	PoolByteArray internal_PACKET_HEADER;
 	PoolByteArray internal_VERSION;
+
+	int zstd_level = 3;
+#ifndef NO_GODOTREMOTE_ZSTD
+	// optional dictionary shared by both sides
+	ZSTD_CDict_s *zstd_cdict = nullptr;
+	ZSTD_DDict_s *zstd_ddict = nullptr;
+#endif
+
+	// messages are printed by the logger thread
+	struct LogEntry {
+		String text;
+		int level = 0;
+	};
+	mpsc_queue<LogEntry> log_queue;
+	std::atomic<int> log_queue_size = { 0 };
+	std::atomic<uint32_t> log_dropped = { 0 };
+	std::atomic<bool> log_thread_running = { false };
+	Semaphore log_semaphore; // posted for every message
+	Thread log_thread;
+	// call sites with suppressed messages. the logger thread prints their counts when they get quiet
+	mpsc_queue<log_rate_limiter *> log_suppressed_queue;
+	std::vector<log_rate_limiter *> log_suppressed_sites;
 };
 
 extern GRUtilsData *_grutils_data;
 
+static inline bool is_log_level_enabled(int lvl) {
+#ifdef DEBUG_ENABLED
+	if (_grutils_data)
+		return lvl >= _grutils_data->current_loglevel && lvl < LogLevel::LL_NONE;
+	return lvl > LogLevel::LL_DEBUG && lvl < LogLevel::LL_NONE;
+#else
+	return false;
+#endif
+}
+
+// Drops messages of one call site above the limit in the current second
+class log_rate_limiter {
+	std::atomic<uint64_t> window_start = { 0 };
+	std::atomic<uint32_t> count = { 0 };
+	std::atomic<uint32_t> suppressed = { 0 };
+	std::atomic<uint64_t> last_suppressed_time = { 0 };
+	std::atomic<bool> summary_queued = { false };
+	const char *file;
+	int line;
+	int level;
+
+public:
+	static const uint32_t max_per_second = 10;
+
+	// r_suppressed is the number of messages dropped since the last allowed one
+	bool allow(uint32_t &r_suppressed);
+	// prints the count of messages suppressed after the last allowed one,
+	// once the call site is quiet for a second. returns false if it must be checked later
+	bool flush_summary(bool force);
+
+	log_rate_limiter(const char *_file, int _line, int _level) :
+			file(_file), line(_line), level(_level) {}
+};
+
 extern void init();
 extern void deinit();
 
@@ -173,11 +451,13 @@ extern void deinit_server_utils();
 extern PoolByteArray compress_buffer;
 extern int compress_buffer_size_mb;
 extern Error compress_jpg(PoolByteArray &ret, const PoolByteArray &img_data, int width, int height, int bytes_for_color = 4, int quality = 75, int subsampling = __SUBSAMPLING_H2V2);
+// same with own output buffer, does not need server utils
+extern Error compress_jpg(PoolByteArray &ret, PoolByteArray &out_buffer, const PoolByteArray &img_data, int width, int height, int bytes_for_color = 4, int quality = 75, int subsampling = __SUBSAMPLING_H2V2);
 #endif
 
 extern Error compress_bytes(const PoolByteArray &bytes, PoolByteArray &res, int type);
 extern Error decompress_bytes(const PoolByteArray &bytes, int output_size, PoolByteArray &res, int type);
-extern void log_str(const Variant &val, int lvl = __LL_NORMAL, String file = "", int line = 0);
+extern void log_str(const Variant &val, int lvl = __LL_NORMAL, String file = "", int line = 0, uint32_t suppressed = 0);
 
 extern String str(const Variant &val);
 extern String str_arr(const Array arr, const bool force_full = false, const int max_shown_items = 32, String separator = ", ");
@@ -189,12 +469,72 @@ extern bool validate_version(const PoolByteArray &data);
 extern bool validate_version(const uint8_t *data);
 
 extern bool compare_pool_byte_arrays(const PoolByteArray &a, const PoolByteArray &b);
+// sha256 of the scene path and files sorted by path. compression is not included, packs are stored uncompressed
+extern String get_pck_content_hash(const String &scene_path, const std::vector<String> &files, const std::vector<Vector<uint8_t> > &contents);
 
 extern void set_gravity(const Vector3 &p_gravity);
 extern void set_accelerometer(const Vector3 &p_accel);
 extern void set_magnetometer(const Vector3 &p_magnetometer);
 extern void set_gyroscope(const Vector3 &p_gyroscope);
 
+// TRACE
+// Begin and end times of pipeline stages in per-thread ring buffers.
+// dumped as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+
+extern std::atomic<bool> _trace_enabled;
+
+extern void trace_set_enabled(bool enabled);
+extern bool trace_is_enabled();
+// threads with the same name share one buffer, so they must not run at the same time.
+// name must be a string literal
+extern void trace_set_thread_name(const char *name);
+// name must be a string literal
+extern void trace_add(const char *name, uint64_t start, uint64_t end);
+extern Error trace_dump(const String &path);
+extern void trace_clear();
+
+class trace_scope {
+	const char *name;
+	uint64_t start = 0;
+
+public:
+	_FORCE_INLINE_ trace_scope(const char *_name) :
+			name(_name) {
+		if (_trace_enabled.load(std::memory_order_relaxed))
+			start = OS::get_singleton()->get_ticks_usec();
+	}
+	_FORCE_INLINE_ ~trace_scope() {
+		if (start)
+			trace_add(name, start, OS::get_singleton()->get_ticks_usec());
+	}
+};
+
+#ifdef GODOTREMOTE_BENCHMARK
+// THREAD CPU
+// cpu time of the calling thread in usec. 0 where it is not supported
+extern uint64_t thread_cpu_time();
+extern void thread_cpu_add(const String &name, uint64_t cpu_time, uint64_t wall_time);
+// running threads are registered, so totals can be sampled before they end.
+// returns an id for thread_cpu_end
+extern uint32_t thread_cpu_begin(const String &name);
+extern void thread_cpu_end(uint32_t id);
+// name : { cpu, wall in ms, threads }. includes running threads where their cpu time can be read
+extern Dictionary thread_cpu_get_dictionary();
+extern void thread_cpu_reset();
+
+class thread_cpu_scope {
+	uint32_t id;
+
+public:
+	thread_cpu_scope(const char *_name) {
+		id = thread_cpu_begin(_name);
+	}
+	~thread_cpu_scope() {
+		thread_cpu_end(id);
+	}
+};
+#endif // GODOTREMOTE_BENCHMARK
+
 // LITERALS
 
 // conversion from usec to msec. most useful to OS::delay_usec()
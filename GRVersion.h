@@ -1 +1 @@
-GR_VERSION(1, 0, 2);
\ No newline at end of file
+GR_VERSION(1, 14, 0);
\ No newline at end of file
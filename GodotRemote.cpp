@@ -17,6 +17,13 @@ using namespace GRUtils;
 String GodotRemote::ps_general_autoload_name = "debug/godot_remote/general/autostart";
 String GodotRemote::ps_general_port_name = "debug/godot_remote/general/port";
 String GodotRemote::ps_general_loglevel_name = "debug/godot_remote/general/log_level";
+String GodotRemote::ps_general_zstd_level_name = "debug/godot_remote/general/zstd_compression_level";
+String GodotRemote::ps_general_zstd_dictionary_name = "debug/godot_remote/general/zstd_dictionary";
+String GodotRemote::ps_general_trace_enabled_name = "debug/godot_remote/general/trace_enabled";
+String GodotRemote::ps_general_trace_file_name = "debug/godot_remote/general/trace_file";
+String GodotRemote::ps_general_metrics_enabled_name = "debug/godot_remote/general/metrics_enabled";
+String GodotRemote::ps_general_metrics_address_name = "debug/godot_remote/general/metrics_address";
+String GodotRemote::ps_general_metrics_port_name = "debug/godot_remote/general/metrics_port";
 
 String GodotRemote::ps_notifications_enabled_name = "debug/godot_remote/notifications/notifications_enabled";
 String GodotRemote::ps_noticications_position_name = "debug/godot_remote/notifications/notifications_position";
@@ -31,10 +38,12 @@ String GodotRemote::ps_server_jpg_buffer_mb_size_name = "debug/godot_remote/serv
 String GodotRemote::ps_server_auto_adjust_scale_name = "debug/godot_remote/server/auto_adjust_scale";
 String GodotRemote::ps_server_scale_of_sending_stream_name = "debug/godot_remote/server/scale_of_sending_stream";
 String GodotRemote::ps_server_password_name = "debug/godot_remote/server/password";
+String GodotRemote::ps_server_accumulate_input_name = "debug/godot_remote/server/accumulate_input_per_frame";
 
 String GodotRemote::ps_server_custom_input_scene_name = "debug/godot_remote/server_custom_input_scene/custom_input_scene";
 String GodotRemote::ps_server_custom_input_scene_compressed_name = "debug/godot_remote/server_custom_input_scene/send_custom_input_scene_compressed";
 String GodotRemote::ps_server_custom_input_scene_compression_type_name = "debug/godot_remote/server_custom_input_scene/custom_input_scene_compression_type";
+String GodotRemote::ps_server_custom_input_scene_live_sync_name = "debug/godot_remote/server_custom_input_scene/live_sync_changed_files";
 
 GodotRemote *GodotRemote::get_singleton() {
 	return singleton;
@@ -141,6 +150,11 @@ void GodotRemote::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_accelerometer", "value"), &GodotRemote::set_accelerometer);
 	ClassDB::bind_method(D_METHOD("set_magnetometer", "value"), &GodotRemote::set_magnetometer);
 	ClassDB::bind_method(D_METHOD("set_gyroscope", "value"), &GodotRemote::set_gyroscope);
+
+	ClassDB::bind_method(D_METHOD("set_trace_enabled", "enabled"), &GodotRemote::set_trace_enabled);
+	ClassDB::bind_method(D_METHOD("is_trace_enabled"), &GodotRemote::is_trace_enabled);
+	ClassDB::bind_method(D_METHOD("dump_trace", "path"), &GodotRemote::dump_trace, DEFVAL(""));
+	ClassDB::bind_method(D_METHOD("clear_trace"), &GodotRemote::clear_trace);
 }
 
 void GodotRemote::_notification(int p_notification) {
@@ -222,6 +236,9 @@ bool GodotRemote::start_remote_device() {
 bool GodotRemote::remove_remote_device() {
 	if (device && !device->is_queued_for_deletion()) {
 		device->stop();
+		if (GRUtils::trace_is_enabled() && String(GET_PS(ps_general_trace_file_name)) != "") {
+			dump_trace();
+		}
 		if (ST()) {
 			device->queue_delete();
 		} else {
@@ -248,6 +265,16 @@ void GodotRemote::register_and_load_settings() {
 	DEF_SET(is_autostart, ps_general_autoload_name, false, Variant::BOOL, PROPERTY_HINT_NONE, "");
 	DEF_(ps_general_port_name, 51341, Variant::INT, PROPERTY_HINT_RANGE, "0,65535");
 	DEF_(ps_general_loglevel_name, LogLevel::LL_NORMAL, Variant::INT, PROPERTY_HINT_ENUM, "Debug,Normal,Warning,Error,None");
+	DEF_(ps_general_zstd_level_name, 3, Variant::INT, PROPERTY_HINT_RANGE, "1,22");
+	// must be the same file on the server and the client. can be trained with `zstd --train`
+	DEF_(ps_general_zstd_dictionary_name, "", Variant::STRING, PROPERTY_HINT_FILE, "*.dict,*.zdict");
+	DEF_(ps_general_trace_enabled_name, false, Variant::BOOL, PROPERTY_HINT_NONE, "");
+	// trace is saved here when the device is removed
+	DEF_(ps_general_trace_file_name, "user://godot_remote_trace.json", Variant::STRING, PROPERTY_HINT_NONE, "");
+	// prometheus text format on http://address:port/metrics. "*" listens on all interfaces
+	DEF_(ps_general_metrics_enabled_name, false, Variant::BOOL, PROPERTY_HINT_NONE, "");
+	DEF_(ps_general_metrics_address_name, "127.0.0.1", Variant::STRING, PROPERTY_HINT_NONE, "");
+	DEF_(ps_general_metrics_port_name, 51345, Variant::INT, PROPERTY_HINT_RANGE, "1,65535");
 
 	DEF_(ps_notifications_enabled_name, true, Variant::BOOL, PROPERTY_HINT_NONE, "");
 	DEF_(ps_noticications_position_name, GRNotifications::NotificationsPosition::TOP_CENTER, Variant::INT, PROPERTY_HINT_ENUM, "TopLeft,TopCenter,TopRight,BottomLeft,BottomCenter,BottomRight");
@@ -257,11 +284,13 @@ void GodotRemote::register_and_load_settings() {
 	DEF_(ps_server_config_adb_name, false, Variant::BOOL, PROPERTY_HINT_NONE, "");
 	DEF_(ps_server_custom_input_scene_name, "", Variant::STRING, PROPERTY_HINT_FILE, "*.tscn,*.scn");
 	DEF_(ps_server_custom_input_scene_compressed_name, true, Variant::BOOL, PROPERTY_HINT_NONE, "");
-	DEF_(ps_server_custom_input_scene_compression_type_name, 0, Variant::INT, PROPERTY_HINT_ENUM, "FastLZ,DEFLATE,zstd,gzip");
+	DEF_(ps_server_custom_input_scene_compression_type_name, 2, Variant::INT, PROPERTY_HINT_ENUM, "FastLZ,DEFLATE,zstd,gzip");
+	DEF_(ps_server_custom_input_scene_live_sync_name, true, Variant::BOOL, PROPERTY_HINT_NONE, "");
 	DEF_(ps_server_jpg_buffer_mb_size_name, 4, Variant::INT, PROPERTY_HINT_RANGE, "1,128");
 
 	// only server can change this settings
 	DEF_(ps_server_password_name, "", Variant::STRING, PROPERTY_HINT_NONE, "");
+	DEF_(ps_server_accumulate_input_name, false, Variant::BOOL, PROPERTY_HINT_NONE, "");
 
 	// client can change this settings
 	DEF_(ps_server_stream_enabled_name, true, Variant::BOOL, PROPERTY_HINT_NONE, "");
@@ -445,4 +474,19 @@ void GodotRemote::set_magnetometer(const Vector3 &p_magnetometer) const {
 void GodotRemote::set_gyroscope(const Vector3 &p_gyroscope) const {
 	GRUtils::set_gyroscope(p_gyroscope);
 }
+void GodotRemote::set_trace_enabled(bool enabled) const {
+	GRUtils::trace_set_enabled(enabled);
+}
+bool GodotRemote::is_trace_enabled() const {
+	return GRUtils::trace_is_enabled();
+}
+Error GodotRemote::dump_trace(String path) const {
+	if (path.empty()) {
+		path = GET_PS(ps_general_trace_file_name);
+	}
+	return GRUtils::trace_dump(path);
+}
+void GodotRemote::clear_trace() const {
+	GRUtils::trace_clear();
+}
 // GRUtils end
@@ -34,6 +34,13 @@ public:
 	static String ps_general_autoload_name;
 	static String ps_general_port_name;
 	static String ps_general_loglevel_name;
+	static String ps_general_zstd_level_name;
+	static String ps_general_zstd_dictionary_name;
+	static String ps_general_trace_enabled_name;
+	static String ps_general_trace_file_name;
+	static String ps_general_metrics_enabled_name;
+	static String ps_general_metrics_address_name;
+	static String ps_general_metrics_port_name;
 
 	static String ps_notifications_enabled_name;
 	static String ps_noticications_position_name;
@@ -48,10 +55,12 @@ public:
 	static String ps_server_auto_adjust_scale_name;
 	static String ps_server_scale_of_sending_stream_name;
 	static String ps_server_password_name;
+	static String ps_server_accumulate_input_name;
 
 	static String ps_server_custom_input_scene_name;
 	static String ps_server_custom_input_scene_compressed_name;
 	static String ps_server_custom_input_scene_compression_type_name;
+	static String ps_server_custom_input_scene_live_sync_name;
 
 private:
 	bool is_autostart = false;
@@ -113,6 +122,10 @@ public:
 	void set_accelerometer(const Vector3 &p_accel) const;
 	void set_magnetometer(const Vector3 &p_magnetometer) const;
 	void set_gyroscope(const Vector3 &p_gyroscope) const;
+	void set_trace_enabled(bool enabled) const;
+	bool is_trace_enabled() const;
+	Error dump_trace(String path = "") const;
+	void clear_trace() const;
 	// GRUtils end
 
 	class GRDevice *get_device() const;
@@ -0,0 +1,38 @@
+# encode_benchmark.gd
+# Headless benchmark of the stream encoder. Needs the engine built with godot_remote_benchmark=yes
+#   godot --no-window -s benchmark/encode_benchmark.gd --output=encode.json --frames=60 --label=baseline
+extends SceneTree
+
+func _init():
+	var output := "user://encode_benchmark.json"
+	var frames := 0
+	var label := ""
+	for arg in OS.get_cmdline_args():
+		if arg.begins_with("--output="):
+			output = arg.trim_prefix("--output=")
+		elif arg.begins_with("--frames="):
+			frames = int(arg.trim_prefix("--frames="))
+		elif arg.begins_with("--label="):
+			label = arg.trim_prefix("--label=")
+
+	if not ClassDB.class_exists("GRBenchmark"):
+		printerr("GRBenchmark is not available. Rebuild with godot_remote_benchmark=yes")
+		quit(1)
+		return
+
+	var bench = ClassDB.instance("GRBenchmark")
+	if frames > 0:
+		bench.frames_count = frames
+
+	var results : Array = bench.run()
+	print("%-10s %-10s %-4s %-5s %9s %8s %8s %8s %10s %7s" % ["pattern", "size", "q", "subs", "MB/s", "p50 ms", "p95 ms", "p99 ms", "bytes", "ratio"])
+	for r in results:
+		if r.has("error"):
+			print("%-10s %4dx%-5d error %d" % [r.pattern, r.width, r.height, r.error])
+			continue
+		print("%-10s %4dx%-5d %-4d %-5s %9.1f %8.2f %8.2f %8.2f %10d %7.1f" % [r.pattern, r.width, r.height, r.quality, r.subsampling, r.mb_per_sec, r.ms_p50, r.ms_p95, r.ms_p99, r.bytes_avg, r.compression_ratio])
+
+	var err = bench.save_results(output, results, {"label": label})
+	if err == OK:
+		print("Results saved to ", ProjectSettings.globalize_path(output))
+	quit(0 if err == OK else 1)
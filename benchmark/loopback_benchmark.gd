@@ -0,0 +1,60 @@
+# loopback_benchmark.gd
+# Server and client in one process streaming synthetic frames over 127.0.0.1.
+# Needs the engine built with godot_remote_benchmark=yes
+#   godot --no-window -s benchmark/loopback_benchmark.gd --duration=10 --width=1920 --height=1080 --quality=80 --output=loopback.json
+extends SceneTree
+
+var output := "user://loopback_benchmark.json"
+var label := ""
+var bench = null
+
+func _initialize():
+	if not ClassDB.class_exists("GRLoopbackBenchmark"):
+		printerr("GRLoopbackBenchmark is not available. Rebuild with godot_remote_benchmark=yes")
+		quit(1)
+		return
+
+	bench = ClassDB.instance("GRLoopbackBenchmark")
+	for arg in OS.get_cmdline_args():
+		var val = arg.get_slice("=", 1)
+		if arg.begins_with("--duration="):
+			bench.duration = float(val)
+		elif arg.begins_with("--warmup="):
+			bench.warmup = float(val)
+		elif arg.begins_with("--width="):
+			bench.width = int(val)
+		elif arg.begins_with("--height="):
+			bench.height = int(val)
+		elif arg.begins_with("--quality="):
+			bench.jpg_quality = int(val)
+		elif arg.begins_with("--pattern="):
+			bench.pattern = int(val)
+		elif arg.begins_with("--port="):
+			bench.port = int(val)
+		elif arg.begins_with("--output="):
+			output = val
+		elif arg.begins_with("--label="):
+			label = val
+
+	root.add_child(bench)
+	bench.connect("finished", self, "_on_finished")
+	if bench.start() != OK:
+		quit(1)
+
+func _on_finished(res : Dictionary):
+	if res.has("error"):
+		printerr("Benchmark failed: ", res.error)
+	else:
+		var lat : Dictionary = res.latency
+		print("%dx%d q%d %s, %.1f s" % [res.width, res.height, res.jpg_quality, res.pattern, res.seconds])
+		print("fps: %.1f  frames: %d  sent: %d  dropped: %d/%d" % [res.fps, res.frames, res.frames_sent, res.frames_dropped_server, res.frames_dropped_client])
+		print("latency ms: p50 %.2f  p95 %.2f  p99 %.2f  max %.2f" % [lat.get("p50", 0), lat.get("p95", 0), lat.get("p99", 0), lat.get("max", 0)])
+		print("traffic: %.2f Mbit/s  %d bytes/frame" % [res.mbit_per_sec, res.bytes_per_frame])
+		for name in res.cpu:
+			print("cpu %-18s %8.1f ms %6.1f%%" % [name, res.cpu[name].cpu, res.cpu[name].percent])
+
+	# same file layout as the encode benchmark
+	var err = ClassDB.instance("GRBenchmark").save_results(output, [res], {"label": label, "benchmark": "loopback"})
+	if err == OK:
+		print("Results saved to ", ProjectSettings.globalize_path(output))
+	quit(0 if err == OK and not res.has("error") else 1)
@@ -2,6 +2,7 @@
 
 #include "register_types.h"
 
+#include "GRBenchmark.h"
 #include "GRClient.h"
 #include "GRDevice.h"
 #include "GRNotifications.h"
@@ -34,6 +35,13 @@ void register_gd_godot_remote_types() {
 	ClassDB::register_class<GRSViewportRenderer>();
 #endif
 
+#if defined(GODOTREMOTE_BENCHMARK) && !defined(NO_GODOTREMOTE_SERVER)
+	ClassDB::register_class<GRBenchmark>();
+#ifndef NO_GODOTREMOTE_CLIENT
+	ClassDB::register_class<GRLoopbackBenchmark>();
+#endif
+#endif
+
 #ifndef NO_GODOTREMOTE_CLIENT
 	ClassDB::register_class<GRClient>();
 	ClassDB::register_class<GRInputCollector>();
@@ -44,16 +52,23 @@ void register_gd_godot_remote_types() {
 	ClassDB::register_virtual_class<GRPacket>();
 	ClassDB::register_class<GRPacketClientStreamAspect>();
 	ClassDB::register_class<GRPacketClientStreamOrientation>();
+	ClassDB::register_class<GRPacketCursorShapeSync>();
 	ClassDB::register_class<GRPacketCustomInputScene>();
+	ClassDB::register_class<GRPacketCustomInputScenePatch>();
+	ClassDB::register_class<GRPacketCustomInputSceneChunk>();
 	ClassDB::register_class<GRPacketImageData>();
 	ClassDB::register_class<GRPacketInputData>();
 	ClassDB::register_class<GRPacketMouseModeSync>();
 	ClassDB::register_class<GRPacketServerSettings>();
 	ClassDB::register_class<GRPacketSyncTime>();
 	ClassDB::register_class<GRPacketCustomUserData>();
+	ClassDB::register_class<GRPacketBulkData>();
+	ClassDB::register_class<GRPacketBatch>();
 
 	ClassDB::register_class<GRPacketPing>();
+	ClassDB::register_class<GRPacketCustomInputSceneRequest>();
 	ClassDB::register_class<GRPacketPong>();
+	ClassDB::register_class<GRPacketBulkDataAck>();
 
 	// Input Data
 	ClassDB::register_virtual_class<GRInputData>();